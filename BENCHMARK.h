@@ -0,0 +1,127 @@
+//**************************************************************************************
+// File BENCHMARK.h
+// Deterministic benchmark definitions: scripted camera/light paths, the full
+// matrix of shader toggles, and the JSON report. The paths are pure functions
+// of the normalized time t in [0,1), so every run renders exactly the same
+// sequence of views regardless of machine speed.
+//**************************************************************************************
+#ifndef __BENCHMARK_H__
+#define __BENCHMARK_H__
+
+#include <math.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include "JSON.h"
+#include "STATS.h"
+
+// Everything Handle_Motion can change
+struct BenchView {
+    float rotate;       // camera_rotate_angle
+    float elevate;      // camera_elevate_angle
+    float light[3];     // lightPosition
+};
+
+struct BenchPath {
+    const char* name;
+    void (*eval)(float t, BenchView& v);
+};
+
+// Slow orbit around the quad at moderate elevation
+static void Bench_Orbit(float t, BenchView& v) {
+    v.rotate = 60.0f * sinf(6.2831853f * t);
+    v.elevate = -20.0f + 10.0f * sinf(12.566371f * t);
+    v.light[0] = 0.0f; v.light[1] = 0.0f; v.light[2] = 8.0f;
+}
+
+// Tilt towards grazing angles, where the steep trace takes the most steps
+static void Bench_Grazing(float t, BenchView& v) {
+    v.rotate = 30.0f * t;
+    v.elevate = -20.0f - 60.0f * t;
+    v.light[0] = 0.0f; v.light[1] = 0.0f; v.light[2] = 8.0f;
+}
+
+// Fixed camera, light circling low over the surface (long shadow rays)
+static void Bench_LightSweep(float t, BenchView& v) {
+    float a = 6.2831853f * t;
+    v.rotate = 0.0f;
+    v.elevate = -20.0f;
+    v.light[0] = 8.0f * cosf(a);
+    v.light[1] = 8.0f * sinf(a);
+    v.light[2] = 3.0f;
+}
+
+static const BenchPath benchPaths[] = {
+    { "orbit",       Bench_Orbit },
+    { "grazing",     Bench_Grazing },
+    { "light_sweep", Bench_LightSweep },
+};
+static const int benchPathCount = sizeof(benchPaths) / sizeof(benchPaths[0]);
+
+// The Handle_Keyboard toggles; all 16 combinations are benchmarked
+struct BenchToggles {
+    bool bumpy;
+    bool selfShadowing;
+    bool multisampling;
+    bool parallaxEnabled;
+};
+static const int benchToggleCount = 16;
+
+static BenchToggles Bench_Toggles(int index) {
+    BenchToggles t;
+    t.bumpy = (index & 1) != 0;
+    t.selfShadowing = (index & 2) != 0;
+    t.multisampling = (index & 4) != 0;
+    t.parallaxEnabled = (index & 8) != 0;
+    return t;
+}
+
+// Results of one (path, toggles) configuration
+struct BenchResult {
+    const char*  path;
+    BenchToggles toggles;
+    StatSummary  frameMs;       // CPU wall time of the whole frame incl. glFinish
+    StatSummary  parallaxMs;    // GPU time, left viewport
+    StatSummary  steepMs;       // GPU time, right viewport
+    StatSummary  parallaxFetches;   // CPU reference texture fetches per covered pixel, path's middle view
+    StatSummary  steepFetches;
+    std::string  counters;      // optional JSON members (pipeline statistics)
+};
+
+// Write the whole run as machine-readable JSON
+// extra: further top-level members ("name": value, ...), or null
+static bool Bench_WriteJson(const char* path, const char* renderer, int width, int height,
+                            int warmup, int frames, const std::vector<BenchResult>& results,
+                            const char* extra = nullptr) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    fprintf(f, "{\n  \"renderer\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n"
+               "  \"warmup_frames\": %d,\n  \"measured_frames\": %d,\n",
+        Json_Escape(renderer).c_str(), width, height, warmup, frames);
+    if (extra) fprintf(f, "  %s,\n", extra);
+    fprintf(f, "  \"configs\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        fprintf(f, "    {\"path\":\"%s\",\"bumpy\":%s,\"selfShadowing\":%s,\"multisampling\":%s,\"parallaxEnabled\":%s,\n     ",
+            Json_Escape(r.path).c_str(),
+            r.toggles.bumpy ? "true" : "false",
+            r.toggles.selfShadowing ? "true" : "false",
+            r.toggles.multisampling ? "true" : "false",
+            r.toggles.parallaxEnabled ? "true" : "false");
+        Json_WriteStats(f, "frame_ms", r.frameMs);
+        fprintf(f, ",\n     ");
+        Json_WriteStats(f, "parallax_gpu_ms", r.parallaxMs);
+        fprintf(f, ",\n     ");
+        Json_WriteStats(f, "steep_gpu_ms", r.steepMs);
+        if (!r.counters.empty()) fprintf(f, ",\n     %s", r.counters.c_str());
+        fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+#endif //__BENCHMARK_H__
@@ -0,0 +1,391 @@
+//**************************************************************************************
+// File CAPTURE.h
+// Asynchronous frame capture. Capture_Frame() starts a glReadPixels into one
+// of CAPTURE_RING pixel-pack buffers and fences it; the copy is only mapped
+// when the fence has signalled, normally a frame or two later, so the render
+// loop never waits on the GPU. Mapped frames are handed to a background
+// writer thread (PPM, PNG or one raw RGB stream) and, optionally, to a sink
+// callback such as the golden-image comparison.
+//
+// The ring only blocks when all CAPTURE_RING readbacks are still in flight,
+// and the writer queue only when CAPTURE_QUEUE frames are waiting for the
+// disk; both cases are counted as stalls.
+//**************************************************************************************
+#ifndef __CAPTURE_H__
+#define __CAPTURE_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include "GL_DEBUG.h"
+#include "GPU_MEMORY.h"
+#include "PROFILER.h"
+
+#define CAPTURE_RING  3     // pixel-pack buffers in flight
+#define CAPTURE_QUEUE 16    // frames waiting for the writer before the renderer blocks
+
+enum CaptureFormat {
+    CAPTURE_PPM = 0,    // <prefix>_NNNN.ppm
+    CAPTURE_PNG,        // <prefix>_NNNN.png (uncompressed deflate)
+    CAPTURE_RAW,        // <prefix>.rgb, all frames appended, top-down RGB24
+    CAPTURE_NONE        // sink only, nothing written
+};
+
+// Called on the writer thread with every captured frame (rows bottom-up, as GL returns them)
+typedef std::function<void(int frame, const unsigned char* rgb, int width, int height)> CaptureSink;
+
+struct CaptureSlot {
+    GLuint pbo = 0;
+    GLsync fence = 0;
+    int    frame = -1;      // -1 = free
+};
+
+struct CaptureJob {
+    int frame;
+    std::vector<unsigned char> rgb;
+};
+
+struct CaptureState {
+    bool          active = false;
+    int           width = 0;
+    int           height = 0;
+    CaptureFormat format = CAPTURE_PPM;
+    std::string   prefix;
+    CaptureSink   sink;
+    CaptureSlot   slots[CAPTURE_RING];
+    int           next = 0;             // slot of the next readback
+    FILE*         raw = nullptr;
+
+    std::thread                 writer;
+    std::mutex                  mutex;
+    std::condition_variable     cv;
+    std::deque<CaptureJob>      queue;
+    std::vector<std::vector<unsigned char>> spare;  // recycled frame buffers
+    bool                        stop = false;
+
+    int    captured = 0;
+    int    written = 0;
+    int    ringStalls = 0;
+    int    queueStalls = 0;
+    size_t maxQueue = 0;
+    double bytes = 0.0;
+};
+
+static CaptureState capture;
+
+static bool Capture_ParseFormat(const char* name, CaptureFormat* format) {
+    static const char* names[] = { "ppm", "png", "raw", "none" };
+    for (int i = 0; i <= CAPTURE_NONE; ++i) {
+        if (!strcmp(name, names[i])) {
+            *format = (CaptureFormat)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// ---- PNG (stored deflate blocks, no compression) -------------------------------------
+static uint32_t Capture_Crc32(uint32_t crc, const unsigned char* p, size_t n) {
+    struct CrcTable {
+        uint32_t value[256];
+        CrcTable() {
+            for (uint32_t i = 0; i < 256; ++i) {
+                uint32_t c = i;
+                for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+                value[i] = c;
+            }
+        }
+    };
+    static const CrcTable table;        // built once, thread-safe, whichever thread gets here first
+    crc = ~crc;
+    for (size_t i = 0; i < n; ++i) crc = table.value[(crc ^ p[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void Capture_Put32(std::vector<unsigned char>& out, uint32_t v) {
+    out.push_back((unsigned char)(v >> 24));
+    out.push_back((unsigned char)(v >> 16));
+    out.push_back((unsigned char)(v >> 8));
+    out.push_back((unsigned char)v);
+}
+
+static void Capture_PngChunk(FILE* f, const char* type, const std::vector<unsigned char>& data) {
+    std::vector<unsigned char> head;
+    Capture_Put32(head, (uint32_t)data.size());
+    head.insert(head.end(), type, type + 4);
+    uint32_t crc = Capture_Crc32(0, head.data() + 4, 4);
+    crc = Capture_Crc32(crc, data.data(), data.size());
+    std::vector<unsigned char> tail;
+    Capture_Put32(tail, crc);
+    fwrite(head.data(), 1, head.size(), f);
+    fwrite(data.data(), 1, data.size(), f);
+    fwrite(tail.data(), 1, tail.size(), f);
+}
+
+static bool Capture_WritePNG(const char* path, const unsigned char* rgb, int width, int height) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+    fwrite(signature, 1, 8, f);
+
+    std::vector<unsigned char> ihdr;
+    Capture_Put32(ihdr, (uint32_t)width);
+    Capture_Put32(ihdr, (uint32_t)height);
+    const unsigned char rest[5] = { 8, 2, 0, 0, 0 };   // 8-bit RGB, no interlace
+    ihdr.insert(ihdr.end(), rest, rest + 5);
+    Capture_PngChunk(f, "IHDR", ihdr);
+
+    // Scanlines top-down, each with filter type 0
+    size_t stride = (size_t)width * 3;
+    std::vector<unsigned char> raw((stride + 1) * height);
+    for (int y = 0; y < height; ++y) {
+        raw[y * (stride + 1)] = 0;
+        memcpy(&raw[y * (stride + 1) + 1], rgb + (size_t)(height - 1 - y) * stride, stride);
+    }
+
+    // zlib stream of stored blocks
+    std::vector<unsigned char> z;
+    z.reserve(raw.size() + raw.size() / 65535 * 5 + 16);
+    z.push_back(0x78);
+    z.push_back(0x01);
+    uint32_t a = 1, b = 0;
+    for (size_t pos = 0; pos < raw.size() || raw.empty(); ) {
+        size_t n = raw.size() - pos < 65535 ? raw.size() - pos : 65535;
+        z.push_back(pos + n == raw.size() ? 1 : 0);
+        z.push_back((unsigned char)n);
+        z.push_back((unsigned char)(n >> 8));
+        z.push_back((unsigned char)~n);
+        z.push_back((unsigned char)(~n >> 8));
+        z.insert(z.end(), raw.begin() + pos, raw.begin() + pos + n);
+        for (size_t i = pos; i < pos + n; ++i) {
+            a = (a + raw[i]) % 65521;
+            b = (b + a) % 65521;
+        }
+        pos += n;
+        if (raw.empty()) break;
+    }
+    Capture_Put32(z, (b << 16) | a);
+    Capture_PngChunk(f, "IDAT", z);
+    Capture_PngChunk(f, "IEND", std::vector<unsigned char>());
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+static bool Capture_WritePPM(const char* path, const unsigned char* rgb, int width, int height) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    // GL rows are bottom-up, PPM rows are top-down
+    for (int y = height - 1; y >= 0; --y)
+        fwrite(rgb + (size_t)y * width * 3, 1, (size_t)width * 3, f);
+    bool ok = !ferror(f);
+    fclose(f);
+    return ok;
+}
+
+// ---- writer thread -------------------------------------------------------------------
+static void Capture_WriteJob(const CaptureJob& job) {
+    CaptureState& c = capture;
+    size_t stride = (size_t)c.width * 3;
+    char path[512];
+    switch (c.format) {
+    case CAPTURE_PPM:
+        snprintf(path, sizeof(path), "%s_%04d.ppm", c.prefix.c_str(), job.frame);
+        Capture_WritePPM(path, job.rgb.data(), c.width, c.height);
+        break;
+    case CAPTURE_PNG:
+        snprintf(path, sizeof(path), "%s_%04d.png", c.prefix.c_str(), job.frame);
+        Capture_WritePNG(path, job.rgb.data(), c.width, c.height);
+        break;
+    case CAPTURE_RAW:
+        for (int y = c.height - 1; y >= 0 && c.raw; --y)
+            fwrite(&job.rgb[y * stride], 1, stride, c.raw);
+        break;
+    case CAPTURE_NONE:
+        break;
+    }
+}
+
+static void Capture_WriterLoop() {
+    Profiler_SetThreadName("capture writer");
+    CaptureState& c = capture;
+    for (;;) {
+        CaptureJob job;
+        {
+            std::unique_lock<std::mutex> lock(c.mutex);
+            c.cv.wait(lock, [&] { return c.stop || !c.queue.empty(); });
+            if (c.queue.empty()) return;
+            job = std::move(c.queue.front());
+            c.queue.pop_front();
+        }
+        c.cv.notify_all();
+        {
+            PROFILE_SCOPE("capture write");
+            if (c.sink) c.sink(job.frame, job.rgb.data(), c.width, c.height);
+            Capture_WriteJob(job);
+        }
+        std::lock_guard<std::mutex> lock(c.mutex);
+        ++c.written;
+        c.bytes += (double)job.rgb.size();
+        c.spare.push_back(std::move(job.rgb));
+    }
+}
+
+// ---- render-thread side --------------------------------------------------------------
+// Copy a finished readback out of its buffer and queue it for the writer
+static void Capture_Harvest(CaptureSlot& s) {
+    CaptureState& c = capture;
+    PROFILE_SCOPE("capture map");
+    glDeleteSync(s.fence);
+    s.fence = 0;
+
+    std::vector<unsigned char> rgb;
+    {
+        std::unique_lock<std::mutex> lock(c.mutex);
+        if (c.queue.size() >= CAPTURE_QUEUE) {
+            ++c.queueStalls;
+            c.cv.wait(lock, [&] { return c.queue.size() < CAPTURE_QUEUE; });
+        }
+        if (!c.spare.empty()) {
+            rgb = std::move(c.spare.back());
+            c.spare.pop_back();
+        }
+    }
+    size_t size = (size_t)c.width * c.height * 3;
+    rgb.resize(size);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (data) {
+        memcpy(rgb.data(), data, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    int frame = s.frame;
+    s.frame = -1;
+    if (!data) {
+        fprintf(stderr, "ERROR: cannot map capture buffer of frame %d\n", frame);
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(c.mutex);
+        c.queue.push_back({ frame, std::move(rgb) });
+        if (c.queue.size() > c.maxQueue) c.maxQueue = c.queue.size();
+    }
+    c.cv.notify_all();
+}
+
+// Harvest every readback whose fence has signalled, without waiting
+static void Capture_Poll() {
+    if (!capture.active) return;
+    for (int k = 0; k < CAPTURE_RING; ++k) {
+        CaptureSlot& s = capture.slots[(capture.next + k) % CAPTURE_RING];
+        if (s.frame < 0) continue;
+        GLenum r = glClientWaitSync(s.fence, 0, 0);
+        if (r == GL_ALREADY_SIGNALED || r == GL_CONDITION_SATISFIED) Capture_Harvest(s);
+    }
+}
+
+static bool Capture_Init(int width, int height, CaptureFormat format, const char* prefix,
+                         CaptureSink sink = CaptureSink()) {
+    CaptureState& c = capture;
+    c.sink = sink;
+    c.width = width;
+    c.height = height;
+    c.format = format;
+    c.prefix = prefix ? prefix : "frame";
+    // Counters are per take: 'C' starts a new one on the same state
+    c.next = 0;
+    c.captured = c.written = c.ringStalls = c.queueStalls = 0;
+    c.maxQueue = 0;
+    c.bytes = 0.0;
+    if (format == CAPTURE_RAW) {
+        std::string path = c.prefix + ".rgb";
+        c.raw = fopen(path.c_str(), "wb");
+        if (!c.raw) {
+            fprintf(stderr, "ERROR: cannot write '%s'\n", path.c_str());
+            return false;
+        }
+    }
+    for (CaptureSlot& s : c.slots) {
+        glGenBuffers(1, &s.pbo);
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 3, nullptr, GL_STREAM_READ);
+        GpuMem_Track(GPUMEM_BUFFER, s.pbo, GPUMEM_STAGING, "capture ring", (size_t)width * height * 3);
+        GLDebug_Label(GL_BUFFER, s.pbo, "capture PBO");
+        s.frame = -1;
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    c.stop = false;
+    c.writer = std::thread(Capture_WriterLoop);
+    c.active = true;
+    return true;
+}
+
+// Queue a readback of the bound read framebuffer (rows bottom-up, like glReadPixels)
+static void Capture_Frame(int frame) {
+    CaptureState& c = capture;
+    if (!c.active) return;
+    PROFILE_SCOPE("capture");
+    Capture_Poll();
+    CaptureSlot& s = c.slots[c.next];
+    if (s.frame >= 0) {
+        // Every buffer is still in flight: wait for the oldest
+        ++c.ringStalls;
+        glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~(GLuint64)0);
+        Capture_Harvest(s);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, c.width, c.height, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    s.frame = frame;
+    c.next = (c.next + 1) % CAPTURE_RING;
+    ++c.captured;
+}
+
+// Drain the ring and the writer queue, stop the writer and report
+static void Capture_Shutdown() {
+    CaptureState& c = capture;
+    if (!c.active) return;
+    for (int k = 0; k < CAPTURE_RING; ++k) {
+        CaptureSlot& s = c.slots[(c.next + k) % CAPTURE_RING];
+        if (s.frame < 0) continue;
+        glClientWaitSync(s.fence, GL_SYNC_FLUSH_COMMANDS_BIT, ~(GLuint64)0);
+        Capture_Harvest(s);
+    }
+    {
+        std::lock_guard<std::mutex> lock(c.mutex);
+        c.stop = true;
+    }
+    c.cv.notify_all();
+    c.writer.join();
+    for (CaptureSlot& s : c.slots) {
+        GpuMem_Release(GPUMEM_BUFFER, s.pbo);
+        glDeleteBuffers(1, &s.pbo);
+    }
+    if (c.raw) {
+        fclose(c.raw);
+        c.raw = nullptr;
+        fprintf(stdout, "Raw RGB24 stream: %s.rgb (%dx%d, top-down)\n", c.prefix.c_str(), c.width, c.height);
+    }
+    fprintf(stdout, "Captured %d frames (%.1f MB), ring stalls %d, writer stalls %d, max queue %zu\n",
+        c.written, c.bytes / (1024.0 * 1024.0), c.ringStalls, c.queueStalls, c.maxQueue);
+    c.active = false;
+}
+
+#endif //__CAPTURE_H__
@@ -0,0 +1,517 @@
+//**************************************************************************************
+// File CPU_REFERENCE.h
+// CPU reference renderer. Re-implements vsParallax.glsl + psParallax.glsl and
+// vsParallax.glsl + psSteepParallax.glsl in plain C++ (same math, same
+// GL_REPEAT/GL_LINEAR bilinear fetches, same quirks) together with a small
+// perspective-correct triangle rasterizer, so GL output can be checked against
+// it and so quality can be measured against a high-sample "ground truth".
+//
+// Output is one square viewport of size x size pixels, RGB8, rows bottom-up
+// (the same layout glReadPixels returns), plus a coverage mask.
+//
+// Every texture() call is counted by stage of the steep shader (trace, albedo,
+// height normal, specular boost, AO ring, shadow PCF) and by map, per pixel,
+// so a frame carries an exact fetch cost model of psSteepParallax.glsl as
+// written; fetches the GLSL compiler may merge (the repeated center height)
+// are counted as the source issues them.
+//**************************************************************************************
+#ifndef __CPU_REFERENCE_H__
+#define __CPU_REFERENCE_H__
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "PARALLEL.h"
+#include "STATS.h"
+
+// ---- small vector helpers ------------------------------------------------------------
+struct Vec2 { float x, y; };
+struct Vec3 { float x, y, z; };
+
+static inline Vec2 v2(float x, float y) { return { x, y }; }
+static inline Vec3 v3(float x, float y, float z) { return { x, y, z }; }
+static inline Vec2 operator+(Vec2 a, Vec2 b) { return { a.x + b.x, a.y + b.y }; }
+static inline Vec2 operator*(Vec2 a, float s) { return { a.x * s, a.y * s }; }
+static inline Vec3 operator+(Vec3 a, Vec3 b) { return { a.x + b.x, a.y + b.y, a.z + b.z }; }
+static inline Vec3 operator-(Vec3 a, Vec3 b) { return { a.x - b.x, a.y - b.y, a.z - b.z }; }
+static inline Vec3 operator*(Vec3 a, float s) { return { a.x * s, a.y * s, a.z * s }; }
+static inline Vec3 operator*(Vec3 a, Vec3 b) { return { a.x * b.x, a.y * b.y, a.z * b.z }; }
+static inline float dot(Vec3 a, Vec3 b) { return a.x * b.x + a.y * b.y + a.z * b.z; }
+static inline Vec3 cross(Vec3 a, Vec3 b) { return { a.y * b.z - a.z * b.y, a.z * b.x - a.x * b.z, a.x * b.y - a.y * b.x }; }
+static inline Vec3 normalize(Vec3 a) { float l = sqrtf(dot(a, a)); return l > 0.0f ? a * (1.0f / l) : a; }
+static inline float saturatef(float x) { return x < 0.0f ? 0.0f : (x > 1.0f ? 1.0f : x); }
+static inline float lerpf(float a, float b, float t) { return a + t * (b - a); }
+static inline Vec2 mix2(Vec2 a, Vec2 b, float t) { return { a.x + t * (b.x - a.x), a.y + t * (b.y - a.y) }; }
+static inline Vec3 mix3(Vec3 a, Vec3 b, float t) { return { a.x + t * (b.x - a.x), a.y + t * (b.y - a.y), a.z + t * (b.z - a.z) }; }
+
+// ---- textures ------------------------------------------------------------------------
+// CPU copy of an uploaded RGB8 texture, texel (s,t) at rgb[(t*width+s)*3]
+struct CpuTexture {
+    int width = 0;
+    int height = 0;
+    std::vector<unsigned char> rgb;
+};
+
+struct CpuMaterial {
+    const CpuTexture* diffuse;
+    const CpuTexture* height;
+    const CpuTexture* normal;
+};
+
+// Stage of the fragment shader a fetch belongs to (psParallax: offset, normal, albedo)
+enum CpuFetchStage {
+    FETCH_TRACE = 0,        // parallaxTrace / the parallax offset height
+    FETCH_ALBEDO,           // diffuse at the final UV
+    FETCH_HEIGHT_NORMAL,    // computeHeightNormalTS and the normal map
+    FETCH_SPECULAR,         // height for the specular boost
+    FETCH_AO,               // ambient occlusion ring
+    FETCH_SHADOW,           // self-shadow PCF rays
+    FETCH_STAGE_COUNT
+};
+
+enum CpuFetchMap {
+    FETCH_HEIGHT = 0,
+    FETCH_NORMAL,
+    FETCH_DIFFUSE,
+    FETCH_MAP_COUNT
+};
+
+static const char* cpuFetchStageNames[FETCH_STAGE_COUNT] = {
+    "trace", "albedo", "height_normal", "specular", "ao", "shadow"
+};
+static const char* cpuFetchMapNames[FETCH_MAP_COUNT] = { "height", "normal", "diffuse" };
+
+// texture() calls of the pixel being shaded by the calling thread, by stage and map
+static thread_local unsigned cpuRefPixelFetches[FETCH_STAGE_COUNT][FETCH_MAP_COUNT];
+static thread_local int      cpuRefStage = FETCH_TRACE;
+
+static inline int CpuRef_Wrap(int i, int n) { i %= n; return i < 0 ? i + n : i; }
+
+// texture() with GL_REPEAT + GL_LINEAR (no mipmaps), all three channels
+static Vec3 CpuRef_Sample(const CpuTexture& t, Vec2 uv, CpuFetchMap map) {
+    ++cpuRefPixelFetches[cpuRefStage][map];
+    float x = uv.x * t.width - 0.5f;
+    float y = uv.y * t.height - 0.5f;
+    float fx = floorf(x), fy = floorf(y);
+    float ax = x - fx, ay = y - fy;
+    int x0 = CpuRef_Wrap((int)fx, t.width), x1 = CpuRef_Wrap((int)fx + 1, t.width);
+    int y0 = CpuRef_Wrap((int)fy, t.height), y1 = CpuRef_Wrap((int)fy + 1, t.height);
+    const unsigned char* p00 = &t.rgb[((size_t)y0 * t.width + x0) * 3];
+    const unsigned char* p10 = &t.rgb[((size_t)y0 * t.width + x1) * 3];
+    const unsigned char* p01 = &t.rgb[((size_t)y1 * t.width + x0) * 3];
+    const unsigned char* p11 = &t.rgb[((size_t)y1 * t.width + x1) * 3];
+    float c[3];
+    for (int k = 0; k < 3; ++k) {
+        float top = p00[k] + ax * (p10[k] - p00[k]);
+        float bot = p01[k] + ax * (p11[k] - p01[k]);
+        c[k] = (top + ay * (bot - top)) * (1.0f / 255.0f);
+    }
+    return { c[0], c[1], c[2] };
+}
+
+// texture().r only, for height lookups
+static float CpuRef_SampleR(const CpuTexture& t, Vec2 uv) {
+    ++cpuRefPixelFetches[cpuRefStage][FETCH_HEIGHT];
+    float x = uv.x * t.width - 0.5f;
+    float y = uv.y * t.height - 0.5f;
+    float fx = floorf(x), fy = floorf(y);
+    float ax = x - fx, ay = y - fy;
+    int x0 = CpuRef_Wrap((int)fx, t.width), x1 = CpuRef_Wrap((int)fx + 1, t.width);
+    int y0 = CpuRef_Wrap((int)fy, t.height), y1 = CpuRef_Wrap((int)fy + 1, t.height);
+    float p00 = t.rgb[((size_t)y0 * t.width + x0) * 3];
+    float p10 = t.rgb[((size_t)y0 * t.width + x1) * 3];
+    float p01 = t.rgb[((size_t)y1 * t.width + x0) * 3];
+    float p11 = t.rgb[((size_t)y1 * t.width + x1) * 3];
+    float top = p00 + ax * (p10 - p00);
+    float bot = p01 + ax * (p11 - p01);
+    return (top + ay * (bot - top)) * (1.0f / 255.0f);
+}
+
+// ---- shading settings ----------------------------------------------------------------
+enum ShadingTechnique {
+    TECH_PARALLAX = 0,  // psParallax.glsl
+    TECH_STEEP,         // psSteepParallax.glsl
+    TECH_COUNT
+};
+
+// The hand-picked constants of psSteepParallax.glsl
+struct SteepSettings {
+    float traceStepsGrazing = 72.0f;    // parallaxTrace: mix(72, 36, |viewDir.z|)
+    float traceStepsFacing = 36.0f;
+    int   aoSamples = 8;                // AO_SAMPLES
+    float aoRadius = 0.012f;            // AO_RADIUS
+    int   pcfRings = 3;                 // (2*rings+1)^2 shadow rays
+    float shadowStepsGrazing = 48.0f;   // lerp(48, 12, |light.z|)
+    float shadowStepsFacing = 12.0f;
+};
+
+// Far more samples than the shader uses: the ground truth for quality metrics
+static SteepSettings SteepSettings_Reference() {
+    SteepSettings s;
+    s.traceStepsGrazing = 512.0f;
+    s.traceStepsFacing = 256.0f;
+    s.aoSamples = 32;
+    s.shadowStepsGrazing = 384.0f;
+    s.shadowStepsFacing = 96.0f;
+    return s;
+}
+
+struct CpuShading {
+    ShadingTechnique technique = TECH_STEEP;
+    float bumpScale = 0.05f;        // bumpy ? 0.125 : 0.05
+    bool  parallax = true;          // psParallax "parralax" uniform
+    bool  selfShadow = true;        // psSteepParallax "selfShadowTest" uniform
+    SteepSettings steep;
+};
+
+// Interpolated vertex shader outputs
+struct CpuVaryings {
+    Vec2 uv;
+    Vec3 tanEye;
+    Vec3 tanLight;
+};
+
+// ---- fragment shaders ----------------------------------------------------------------
+// psParallax.glsl
+static Vec3 CpuRef_ShadeParallax(const CpuShading& s, const CpuMaterial& m, const CpuVaryings& in) {
+    cpuRefStage = FETCH_TRACE;
+    float height = CpuRef_SampleR(*m.height, in.uv);
+    height = height * 2.0f * s.bumpScale - s.bumpScale;
+    Vec3 E = normalize(in.tanEye);
+    Vec2 texUV = s.parallax ? in.uv + v2(E.y, E.x) * height : in.uv;
+
+    cpuRefStage = FETCH_HEIGHT_NORMAL;
+    Vec3 n = normalize((CpuRef_Sample(*m.normal, texUV, FETCH_NORMAL) - v3(0.5f, 0.5f, 0.5f)) * 2.0f);
+    Vec3 L = normalize(in.tanLight);
+    L.x = -L.x;
+
+    float diffuse = fmaxf(dot(L, n), 0.0f) * 0.7f;
+    Vec3 H = normalize(L + E);
+    float specular = powf(fmaxf(dot(H, n), 0.0f), 64.0f) * 0.6f;
+
+    Vec3 ambient = v3(0.4f, 0.4f, 0.6f) * 1.4f;
+    cpuRefStage = FETCH_ALBEDO;
+    Vec3 tex = CpuRef_Sample(*m.diffuse, texUV, FETCH_DIFFUSE);
+    Vec3 lightTint = v3(1.5f, 1.5f, 1.0f) * 0.7f;
+    return tex * (ambient + lightTint * diffuse) + lightTint * specular;
+}
+
+// parallaxTrace() of psSteepParallax.glsl
+static Vec2 CpuRef_ParallaxTrace(const CpuShading& s, const CpuTexture& heightMap, Vec2 uv, Vec3 viewDir) {
+    float numSteps = lerpf(s.steep.traceStepsGrazing, s.steep.traceStepsFacing, fabsf(viewDir.z));
+    Vec2 deltaUV = v2(-viewDir.y, -viewDir.x) * (s.bumpScale / (fabsf(viewDir.z) * numSteps));
+    float deltaH = 1.0f / numSteps;
+
+    Vec2 curUV = uv, prevUV = uv;
+    float heightRem = 1.0f;
+    float curSample = CpuRef_SampleR(heightMap, curUV);
+    float prevSample = heightRem;
+    while (heightRem > 0.0f && curSample < heightRem) {
+        heightRem -= deltaH;
+        prevUV = curUV;
+        prevSample = curSample;
+        curUV = curUV + deltaUV;
+        curSample = CpuRef_SampleR(heightMap, curUV);
+    }
+    float afterDepth = curSample - heightRem;
+    float beforeDepth = prevSample - (heightRem + deltaH);
+    float t = saturatef(beforeDepth / (beforeDepth + afterDepth));
+    return mix2(prevUV, curUV, t);
+}
+
+// psSteepParallax.glsl
+static Vec3 CpuRef_ShadeSteep(const CpuShading& s, const CpuMaterial& m, const CpuVaryings& in) {
+    const Vec3 lightColor = v3(1.0f, 1.0f, 0.65f);
+    const Vec3 ambientBase = v3(0.4f, 0.4f, 0.6f) * 1.4f;
+    const SteepSettings& q = s.steep;
+
+    Vec3 tanEyeN = normalize(in.tanEye);
+    cpuRefStage = FETCH_TRACE;
+    Vec2 finalUV = CpuRef_ParallaxTrace(s, *m.height, in.uv, tanEyeN);
+    cpuRefStage = FETCH_ALBEDO;
+    Vec3 albedo = CpuRef_Sample(*m.diffuse, finalUV, FETCH_DIFFUSE);
+
+    // computeHeightNormalTS
+    cpuRefStage = FETCH_HEIGHT_NORMAL;
+    Vec2 texel = v2(1.0f / m.height->width, 1.0f / m.height->height);
+    float hc = CpuRef_SampleR(*m.height, finalUV);
+    float hr = CpuRef_SampleR(*m.height, finalUV + v2(texel.x, 0.0f));
+    float hu = CpuRef_SampleR(*m.height, finalUV + v2(0.0f, texel.y));
+    Vec3 nH = normalize(v3(-(hr - hc) * s.bumpScale, -(hu - hc) * s.bumpScale, 1.0f));
+    Vec3 nM = normalize(CpuRef_Sample(*m.normal, finalUV, FETCH_NORMAL) * 2.0f - v3(1.0f, 1.0f, 1.0f));
+    Vec3 N = normalize(mix3(nM, nH, 0.5f));
+
+    Vec3 tanLightN = normalize(in.tanLight);
+    tanLightN.x = -tanLightN.x;
+    float NdotL = fmaxf(dot(N, tanLightN), 0.0f);
+    Vec3 halfVec = normalize(tanLightN + tanEyeN);
+    float NdotH = fmaxf(dot(N, halfVec), 0.0f);
+
+    cpuRefStage = FETCH_SPECULAR;
+    float hVal = CpuRef_SampleR(*m.height, finalUV);
+    float boost = lerpf(0.9f, 2.5f, powf(hVal, 2.5f));
+    float expo = lerpf(32.0f, 96.0f, hVal);
+    float specular = powf(NdotH, expo) * 0.6f * boost;
+
+    // Ambient occlusion ring
+    cpuRefStage = FETCH_AO;
+    float sumAO = 0.0f;
+    for (int i = 0; i < q.aoSamples; ++i) {
+        float ang = 6.2831853f * (float)i / (float)q.aoSamples;
+        Vec2 uvS = finalUV + v2(cosf(ang), sinf(ang)) * q.aoRadius;
+        float neighborH = CpuRef_SampleR(*m.height, uvS);
+        float rawAO = saturatef(hVal - neighborH + 0.03f);
+        Vec3 nS = normalize(CpuRef_Sample(*m.normal, uvS, FETCH_NORMAL) * 2.0f - v3(1.0f, 1.0f, 1.0f));
+        rawAO *= (0.4f + 0.6f * fmaxf(dot(N, nS), 0.0f));
+        sumAO += rawAO;
+    }
+    float ao = sumAO / (float)q.aoSamples;
+    ao = lerpf(ao, 1.0f, fabsf(N.z));
+    ao = lerpf(0.08f, 1.0f, ao);
+
+    // Self-shadowing with PCF (note: the shader's divisor starts at 4, kept as-is)
+    cpuRefStage = FETCH_SHADOW;
+    float shadow = 1.0f;
+    if (s.selfShadow && NdotL > 0.0f) {
+        int numShadowSteps = (int)lerpf(q.shadowStepsGrazing, q.shadowStepsFacing, fabsf(tanLightN.z));
+        float shadowDeltaH = 1.0f / (float)numShadowSteps;
+        Vec2 shadowDeltaUV = v2(tanLightN.y, tanLightN.x) * (s.bumpScale / (fabsf(tanLightN.z) * (float)numShadowSteps));
+        float shadowSum = 0.0f;
+        int pcfSamples = 4;
+        for (int dx = -q.pcfRings; dx <= q.pcfRings; ++dx)
+        for (int dy = -q.pcfRings; dy <= q.pcfRings; ++dy) {
+            Vec2 shadowUV = finalUV + v2((float)dx, (float)dy) * 0.0015f;
+            float shadowHeight = CpuRef_SampleR(*m.height, finalUV) + shadowDeltaH * 0.1f;
+            bool inShadow = false;
+            for (int i = 0; i < numShadowSteps && shadowHeight < 1.0f; ++i) {
+                if (CpuRef_SampleR(*m.height, shadowUV) > shadowHeight) {
+                    inShadow = true;
+                    break;
+                }
+                shadowHeight += shadowDeltaH;
+                shadowUV = shadowUV + shadowDeltaUV;
+            }
+            shadowSum += inShadow ? 0.1f : 1.0f;
+            pcfSamples++;
+        }
+        shadow = shadowSum / (float)pcfSamples;
+    }
+
+    return albedo * (ambientBase * ao + lightColor * (0.7f * NdotL * shadow)) + lightColor * (specular * shadow);
+}
+
+// ---- rasterizer ----------------------------------------------------------------------
+// Output of one reference render
+struct CpuFrame {
+    int size = 0;
+    std::vector<unsigned char> rgb;       // size*size*3, bottom-up rows
+    std::vector<unsigned char> coverage;  // 1 where the surface was drawn
+    unsigned long long fetches = 0;       // texture fetches of the shading pass
+    unsigned long long stageFetches[FETCH_STAGE_COUNT][FETCH_MAP_COUNT] = {};
+    std::vector<unsigned> pixelFetches;   // size*size*FETCH_STAGE_COUNT, per pixel and stage
+};
+
+// Post-vertex-shader data of one vertex
+struct CpuVertexOut {
+    float clip[4];
+    CpuVaryings v;
+};
+
+static void CpuRef_Transform(const float M[16], const float in[4], float out[4]) {
+    for (int r = 0; r < 4; ++r)
+        out[r] = M[r] * in[0] + M[4 + r] * in[1] + M[8 + r] * in[2] + M[12 + r] * in[3];
+}
+
+// vsParallax.glsl for one interleaved vertex (pos3 uv2 normal3 tangent4)
+static CpuVertexOut CpuRef_VertexShader(const float* vtx, const float MVP[16], const float invMV[16], const float lightEye[3]) {
+    CpuVertexOut o;
+    float pos[4] = { vtx[0], vtx[1], vtx[2], 1.0f };
+    CpuRef_Transform(MVP, pos, o.clip);
+
+    float origin[4] = { 0, 0, 0, 1 }, eye[4];
+    CpuRef_Transform(invMV, origin, eye);
+    float lightIn[4] = { lightEye[0], lightEye[1], lightEye[2], 1.0f }, light[4];
+    CpuRef_Transform(invMV, lightIn, light);
+
+    Vec3 P = v3(pos[0], pos[1], pos[2]);
+    Vec3 normal = normalize(v3(vtx[5], vtx[6], vtx[7]));
+    Vec3 tangent = normalize(v3(vtx[8], vtx[9], vtx[10]));
+    Vec3 bitangent = cross(normal, tangent) * vtx[11];
+    Vec3 eyeVec = normalize(v3(eye[0], eye[1], eye[2]) * (1.0f / eye[3]) - P);
+    Vec3 lightVec = normalize(v3(light[0], light[1], light[2]) * (1.0f / light[3]) - P);
+
+    // (dot(v, bitangent), dot(v, tangent), dot(v, normal)): .x along v, .y along u
+    o.v.uv = v2(vtx[3], vtx[4]);
+    o.v.tanEye = v3(dot(eyeVec, bitangent), dot(eyeVec, tangent), dot(eyeVec, normal));
+    o.v.tanLight = v3(dot(lightVec, bitangent), dot(lightVec, tangent), dot(lightVec, normal));
+    return o;
+}
+
+// Render indexed triangles (interleaved 12-float vertices) into a size x size viewport
+static void CpuRef_Render(const CpuShading& shading, const CpuMaterial& material,
+                          const float* vertices, const unsigned* indices, int indexCount,
+                          const float MVP[16], const float invMV[16], const float lightEye[3],
+                          int size, CpuFrame& out) {
+    int vertexCount = 0;
+    for (int i = 0; i < indexCount; ++i)
+        if ((int)indices[i] + 1 > vertexCount) vertexCount = indices[i] + 1;
+    std::vector<CpuVertexOut> vs(vertexCount);
+    for (int i = 0; i < vertexCount; ++i)
+        vs[i] = CpuRef_VertexShader(vertices + i * 12, MVP, invMV, lightEye);
+
+    // Visibility pass: nearest triangle and perspective-correct barycentrics per pixel
+    size_t pixels = (size_t)size * size;
+    std::vector<float> depth(pixels, 1.0f);
+    std::vector<int>   triOf(pixels, -1);
+    std::vector<float> bary(pixels * 3);
+    for (int t = 0; t + 2 < indexCount; t += 3) {
+        const CpuVertexOut* tv[3] = { &vs[indices[t]], &vs[indices[t + 1]], &vs[indices[t + 2]] };
+        float sx[3], sy[3], sz[3], invW[3];
+        bool behind = false;
+        for (int k = 0; k < 3; ++k) {
+            float w = tv[k]->clip[3];
+            if (w <= 0.0f) behind = true;
+            invW[k] = 1.0f / w;
+            sx[k] = (tv[k]->clip[0] * invW[k] * 0.5f + 0.5f) * size;
+            sy[k] = (tv[k]->clip[1] * invW[k] * 0.5f + 0.5f) * size;
+            sz[k] = tv[k]->clip[2] * invW[k] * 0.5f + 0.5f;
+        }
+        if (behind) continue;   // the demo never clips against the near plane
+        float area = (sx[1] - sx[0]) * (sy[2] - sy[0]) - (sx[2] - sx[0]) * (sy[1] - sy[0]);
+        if (fabsf(area) < 1e-12f) continue;
+
+        int x0 = (int)fmaxf(0.0f, floorf(fminf(sx[0], fminf(sx[1], sx[2]))));
+        int x1 = (int)fminf((float)size - 1, ceilf(fmaxf(sx[0], fmaxf(sx[1], sx[2]))));
+        int y0 = (int)fmaxf(0.0f, floorf(fminf(sy[0], fminf(sy[1], sy[2]))));
+        int y1 = (int)fminf((float)size - 1, ceilf(fmaxf(sy[0], fmaxf(sy[1], sy[2]))));
+        for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x) {
+            float px = x + 0.5f, py = y + 0.5f;
+            float l0 = ((sx[1] - px) * (sy[2] - py) - (sx[2] - px) * (sy[1] - py)) / area;
+            float l1 = ((sx[2] - px) * (sy[0] - py) - (sx[0] - px) * (sy[2] - py)) / area;
+            float l2 = 1.0f - l0 - l1;
+            if (l0 < 0.0f || l1 < 0.0f || l2 < 0.0f) continue;
+            float z = l0 * sz[0] + l1 * sz[1] + l2 * sz[2];
+            size_t i = (size_t)y * size + x;
+            if (z >= depth[i]) continue;
+            float p0 = l0 * invW[0], p1 = l1 * invW[1], p2 = l2 * invW[2];
+            float sum = p0 + p1 + p2;
+            depth[i] = z;
+            triOf[i] = t;
+            bary[i * 3 + 0] = p0 / sum;
+            bary[i * 3 + 1] = p1 / sum;
+            bary[i * 3 + 2] = p2 / sum;
+        }
+    }
+
+    // Shading pass, one fragment per covered pixel
+    out.size = size;
+    out.rgb.assign(pixels * 3, 0);
+    out.coverage.assign(pixels, 0);
+    out.pixelFetches.assign(pixels * FETCH_STAGE_COUNT, 0);
+    const int cells = FETCH_STAGE_COUNT * FETCH_MAP_COUNT;
+    std::vector<unsigned long long> rowFetches((size_t)size * cells, 0);
+    Parallel_Rows(size, [&](int y) {
+        unsigned long long* rowCounts = &rowFetches[(size_t)y * cells];
+        for (int x = 0; x < size; ++x) {
+            size_t i = (size_t)y * size + x;
+            int t = triOf[i];
+            if (t < 0) continue;
+            const CpuVaryings& a = vs[indices[t]].v;
+            const CpuVaryings& b = vs[indices[t + 1]].v;
+            const CpuVaryings& c = vs[indices[t + 2]].v;
+            float b0 = bary[i * 3], b1 = bary[i * 3 + 1], b2 = bary[i * 3 + 2];
+            CpuVaryings in;
+            in.uv = a.uv * b0 + b.uv * b1 + c.uv * b2;
+            in.tanEye = a.tanEye * b0 + b.tanEye * b1 + c.tanEye * b2;
+            in.tanLight = a.tanLight * b0 + b.tanLight * b1 + c.tanLight * b2;
+
+            memset(cpuRefPixelFetches, 0, sizeof(cpuRefPixelFetches));
+            Vec3 color = shading.technique == TECH_PARALLAX
+                ? CpuRef_ShadeParallax(shading, material, in)
+                : CpuRef_ShadeSteep(shading, material, in);
+            out.rgb[i * 3 + 0] = (unsigned char)(saturatef(color.x) * 255.0f + 0.5f);
+            out.rgb[i * 3 + 1] = (unsigned char)(saturatef(color.y) * 255.0f + 0.5f);
+            out.rgb[i * 3 + 2] = (unsigned char)(saturatef(color.z) * 255.0f + 0.5f);
+            out.coverage[i] = 1;
+            for (int st = 0; st < FETCH_STAGE_COUNT; ++st) {
+                unsigned stageTotal = 0;
+                for (int mp = 0; mp < FETCH_MAP_COUNT; ++mp) {
+                    rowCounts[st * FETCH_MAP_COUNT + mp] += cpuRefPixelFetches[st][mp];
+                    stageTotal += cpuRefPixelFetches[st][mp];
+                }
+                out.pixelFetches[i * FETCH_STAGE_COUNT + st] = stageTotal;
+            }
+        }
+    });
+    out.fetches = 0;
+    memset(out.stageFetches, 0, sizeof(out.stageFetches));
+    for (int y = 0; y < size; ++y)
+        for (int k = 0; k < cells; ++k) {
+            out.stageFetches[k / FETCH_MAP_COUNT][k % FETCH_MAP_COUNT] += rowFetches[(size_t)y * cells + k];
+            out.fetches += rowFetches[(size_t)y * cells + k];
+        }
+}
+
+// Distribution over the covered pixels of one stage's fetches, or of all stages (stage < 0)
+static StatSummary CpuRef_FetchDistribution(const CpuFrame& f, int stage) {
+    std::vector<double> perPixel;
+    for (size_t i = 0; i < f.coverage.size(); ++i) {
+        if (!f.coverage[i]) continue;
+        const unsigned* p = &f.pixelFetches[i * FETCH_STAGE_COUNT];
+        double n = 0.0;
+        for (int st = 0; st < FETCH_STAGE_COUNT; ++st)
+            if (stage < 0 || st == stage) n += p[st];
+        perPixel.push_back(n);
+    }
+    return summarize(perPixel);
+}
+
+static void CpuRef_FetchStatsJson(std::string& json, const StatSummary& s) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "{\"avg\":%.3f,\"p50\":%.0f,\"p95\":%.0f,\"p99\":%.0f,\"max\":%.0f}",
+        s.avg, s.p50, s.p95, s.p99, s.max);
+    json += buf;
+}
+
+// JSON object of a frame's fetches: totals by stage and map, per-pixel distributions
+static std::string CpuRef_FetchJson(const CpuFrame& f) {
+    std::string json;
+    char buf[160];
+    size_t covered = 0;
+    for (unsigned char c : f.coverage) covered += c;
+    snprintf(buf, sizeof(buf), "{\"pixels\":%zu,\"fetches\":%llu,\"per_pixel\":", covered, f.fetches);
+    json += buf;
+    CpuRef_FetchStatsJson(json, CpuRef_FetchDistribution(f, -1));
+    json += ",\"stages\":{";
+    for (int st = 0; st < FETCH_STAGE_COUNT; ++st) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":{", st ? "," : "", cpuFetchStageNames[st]);
+        json += buf;
+        for (int mp = 0; mp < FETCH_MAP_COUNT; ++mp) {
+            snprintf(buf, sizeof(buf), "\"%s\":%llu,", cpuFetchMapNames[mp], f.stageFetches[st][mp]);
+            json += buf;
+        }
+        json += "\"per_pixel\":";
+        CpuRef_FetchStatsJson(json, CpuRef_FetchDistribution(f, st));
+        json += "}";
+    }
+    json += "}}";
+    return json;
+}
+
+// One line per stage: share of the frame's fetches and the per-pixel distribution
+static void CpuRef_PrintFetches(FILE* out, const CpuFrame& f) {
+    for (int st = 0; st < FETCH_STAGE_COUNT; ++st) {
+        unsigned long long total = 0;
+        for (int mp = 0; mp < FETCH_MAP_COUNT; ++mp) total += f.stageFetches[st][mp];
+        if (!total) continue;
+        StatSummary s = CpuRef_FetchDistribution(f, st);
+        fprintf(out, "  %-14s %5.1f%%  per pixel avg %8.2f p50 %6.0f p95 %6.0f max %6.0f  (h %llu n %llu d %llu)\n",
+            cpuFetchStageNames[st], 100.0 * total / (f.fetches ? f.fetches : 1), s.avg, s.p50, s.p95, s.max,
+            f.stageFetches[st][FETCH_HEIGHT], f.stageFetches[st][FETCH_NORMAL], f.stageFetches[st][FETCH_DIFFUSE]);
+    }
+}
+
+#endif //__CPU_REFERENCE_H__
@@ -0,0 +1,168 @@
+//**************************************************************************************
+// File GL_DEBUG.h
+// KHR_debug support: debug groups around the phases of a frame, labels on the
+// GL objects, and a message callback that feeds driver output (performance
+// warnings, errors) into GLDebug_Log together with the demo's own messages.
+//
+// The log is rate limited per message: the first GL_DEBUG_BURST occurrences
+// within GL_DEBUG_WINDOW_MS are printed, the rest only counted and reported
+// when the window rolls over and at shutdown. Driver notifications are off
+// unless verbose. Without KHR_debug (GL < 4.3 and no extension) the groups and
+// labels do nothing and only the demo's messages are logged.
+//**************************************************************************************
+#ifndef __GL_DEBUG_H__
+#define __GL_DEBUG_H__
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <mutex>
+#include <unordered_map>
+
+#define GL_DEBUG_BURST     5        // messages of one kind printed per window
+#define GL_DEBUG_WINDOW_MS 1000
+
+#ifdef _WIN32
+#define GL_DEBUG_CALLBACK APIENTRY
+#else
+#define GL_DEBUG_CALLBACK
+#endif
+
+struct GLDebugCounter {
+    std::chrono::steady_clock::time_point windowStart;
+    int printed = 0;        // in the current window
+    int suppressed = 0;     // in the current window
+    int total = 0;
+    char sample[96] = "";   // text of the last suppressed message
+};
+
+struct GLDebugState {
+    bool       available = false;   // KHR_debug entry points usable
+    bool       verbose = false;
+    std::mutex lock;                // the driver may call back from its own threads
+    std::unordered_map<unsigned long long, GLDebugCounter> counters;
+    int        suppressedTotal = 0;
+};
+
+static GLDebugState glDebug;
+
+static const char* GLDebug_SourceName(GLenum source) {
+    switch (source) {
+    case GL_DEBUG_SOURCE_API:             return "api";
+    case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   return "window";
+    case GL_DEBUG_SOURCE_SHADER_COMPILER: return "compiler";
+    case GL_DEBUG_SOURCE_THIRD_PARTY:     return "third-party";
+    case GL_DEBUG_SOURCE_APPLICATION:     return "app";
+    default:                              return "other";
+    }
+}
+
+static const char* GLDebug_TypeName(GLenum type) {
+    switch (type) {
+    case GL_DEBUG_TYPE_ERROR:               return "error";
+    case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "deprecated";
+    case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR:  return "undefined";
+    case GL_DEBUG_TYPE_PORTABILITY:         return "portability";
+    case GL_DEBUG_TYPE_PERFORMANCE:         return "performance";
+    case GL_DEBUG_TYPE_MARKER:              return "marker";
+    default:                                return "other";
+    }
+}
+
+// Log a message once its kind is under the rate limit; key identifies the kind
+static void GLDebug_Write(unsigned long long key, GLenum source, GLenum type, GLenum severity, const char* message) {
+    std::lock_guard<std::mutex> guard(glDebug.lock);
+    auto now = std::chrono::steady_clock::now();
+    GLDebugCounter& c = glDebug.counters[key];
+    ++c.total;
+    if (c.total == 1 || now - c.windowStart > std::chrono::milliseconds(GL_DEBUG_WINDOW_MS)) {
+        if (c.suppressed)
+            fprintf(stderr, "GL %s %s: %d repeats suppressed, last: %s\n",
+                GLDebug_SourceName(source), GLDebug_TypeName(type), c.suppressed, c.sample);
+        c.windowStart = now;
+        c.printed = 0;
+        c.suppressed = 0;
+    }
+    if (c.printed >= GL_DEBUG_BURST) {
+        ++c.suppressed;
+        ++glDebug.suppressedTotal;
+        snprintf(c.sample, sizeof(c.sample), "%s", message);
+        return;
+    }
+    ++c.printed;
+    bool serious = type == GL_DEBUG_TYPE_ERROR || severity == GL_DEBUG_SEVERITY_HIGH;
+    fprintf(serious ? stderr : stdout, "GL %s %s: %s\n", GLDebug_SourceName(source), GLDebug_TypeName(type), message);
+}
+
+// The demo's own messages go through the same limiter, keyed by their text
+static void GLDebug_Log(GLenum type, const char* format, ...) {
+    char message[512];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(message, sizeof(message), format, args);
+    va_end(args);
+    unsigned long long key = 1469598103934665603ull;    // FNV-1a
+    for (const char* p = message; *p; ++p) key = (key ^ (unsigned char)*p) * 1099511628211ull;
+    GLDebug_Write(key, GL_DEBUG_SOURCE_APPLICATION, type, GL_DEBUG_SEVERITY_MEDIUM, message);
+}
+
+static void GL_DEBUG_CALLBACK GLDebug_Callback(GLenum source, GLenum type, GLuint id, GLenum severity,
+                                               GLsizei, const GLchar* message, const void*) {
+    if (type == GL_DEBUG_TYPE_PUSH_GROUP || type == GL_DEBUG_TYPE_POP_GROUP) return;
+    GLDebug_Write(((unsigned long long)source << 48) ^ ((unsigned long long)type << 32) ^ id,
+        source, type, severity, message);
+}
+
+// Install the callback when the context has KHR_debug; a debug context gets more output
+static void GLDebug_Init(bool verbose) {
+    GLint major = 0, minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    glDebug.available = major > 4 || (major == 4 && minor >= 3);
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count && !glDebug.available; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        glDebug.available = ext && !strcmp(ext, "GL_KHR_debug");
+    }
+    glDebug.verbose = verbose;
+    if (!glDebug.available) return;
+
+    GLint flags = 0;
+    glGetIntegerv(GL_CONTEXT_FLAGS, &flags);
+    glEnable(GL_DEBUG_OUTPUT);
+    if (verbose) glEnable(GL_DEBUG_OUTPUT_SYNCHRONOUS);     // messages at the call that caused them
+    glDebugMessageCallback(GLDebug_Callback, nullptr);
+    glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, nullptr,
+        verbose ? GL_TRUE : GL_FALSE);
+    fprintf(stdout, "KHR_debug: callback installed (%s context)\n",
+        flags & GL_CONTEXT_FLAG_DEBUG_BIT ? "debug" : "non-debug");
+}
+
+// identifier: GL_TEXTURE, GL_BUFFER, GL_PROGRAM, GL_VERTEX_ARRAY, GL_FRAMEBUFFER, ...
+static void GLDebug_Label(GLenum identifier, GLuint name, const char* label) {
+    if (glDebug.available && name) glObjectLabel(identifier, name, -1, label);
+}
+
+struct GLDebugGroup {
+    explicit GLDebugGroup(const char* name) {
+        if (glDebug.available) glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name);
+    }
+    ~GLDebugGroup() {
+        if (glDebug.available) glPopDebugGroup();
+    }
+};
+#define GL_DEBUG_CONCAT_(a, b) a##b
+#define GL_DEBUG_CONCAT(a, b) GL_DEBUG_CONCAT_(a, b)
+#define GL_DEBUG_GROUP(name) GLDebugGroup GL_DEBUG_CONCAT(glDebugGroup_, __LINE__)(name)
+
+static void GLDebug_Shutdown() {
+    if (glDebug.available) glDebugMessageCallback(nullptr, nullptr);
+    std::lock_guard<std::mutex> guard(glDebug.lock);
+    if (glDebug.suppressedTotal)
+        fprintf(stderr, "GL debug: %d repeated messages were suppressed\n", glDebug.suppressedTotal);
+    glDebug.available = false;
+}
+
+#endif //__GL_DEBUG_H__
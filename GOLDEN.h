@@ -0,0 +1,100 @@
+//**************************************************************************************
+// File GOLDEN.h
+// Golden-image regression cases: fixed camera/light/toggle states rendered
+// through the normal frame path (both viewports, as in the window) and
+// through the CPU reference at the same shader settings. Each viewport must
+// stay within an error budget of its reference; any new fast path (cheaper
+// shadows, baked AO, compressed textures) is gated on the same budget.
+// Only the surface is compared (the reference coverage mask), and the light
+// marker is hidden while the cases run.
+//**************************************************************************************
+#ifndef __GOLDEN_H__
+#define __GOLDEN_H__
+
+#include <stdio.h>
+#include <vector>
+#include "BENCHMARK.h"
+#include "CPU_REFERENCE.h"
+
+#define GOLDEN_MIN_PSNR 30.0    // dB, per viewport
+#define GOLDEN_MAX_FLIP 0.05    // mean FLIP-style error, per viewport
+
+struct GoldenCase {
+    const char* name;
+    int         path;       // benchPaths index
+    float       t;          // position on the path
+    int         toggles;    // Bench_Toggles index (1 B, 2 S, 4 M, 8 P)
+};
+
+static const GoldenCase goldenCases[] = {
+    { "orbit",                 0, 0.25f, 2 | 4 | 8 },
+    { "orbit_bumpy",           0, 0.60f, 1 | 2 | 4 | 8 },
+    { "orbit_flat",            0, 0.90f, 2 | 4 },
+    { "grazing",               1, 0.30f, 2 | 4 | 8 },
+    { "grazing_no_shadow",     1, 0.70f, 4 | 8 },
+    { "grazing_bumpy_no_msaa", 1, 0.50f, 1 | 2 | 8 },
+    { "light_sweep",           2, 0.20f, 2 | 4 | 8 },
+    { "light_sweep_bumpy",     2, 0.80f, 1 | 2 | 8 },
+};
+static const int goldenCaseCount = sizeof(goldenCases) / sizeof(goldenCases[0]);
+
+struct GoldenBudget {
+    double minPsnr = GOLDEN_MIN_PSNR;
+    double maxFlip = GOLDEN_MAX_FLIP;
+};
+
+struct GoldenScore {
+    double psnr = 0.0;
+    double ssim = 0.0;
+    double flip = 0.0;
+    bool   pass = false;
+};
+
+struct GoldenResult {
+    const GoldenCase* c = nullptr;
+    GoldenScore score[TECH_COUNT];
+    double      glMs = 0.0;         // best frame time, both viewports, with glFinish
+    double      cpuMs = 0.0;        // CPU reference, both viewports
+    bool        pass = false;
+};
+
+static bool Golden_Check(GoldenScore& s, const GoldenBudget& b) {
+    s.pass = s.psnr >= b.minPsnr && s.flip <= b.maxFlip;
+    return s.pass;
+}
+
+// JSON report; technique names come from the caller's table
+static bool Golden_WriteJson(const char* path, const char* renderer, int width, int height, const char* preset,
+                             const GoldenBudget& budget, const char* const* techniqueNames,
+                             const std::vector<GoldenResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    int failed = 0;
+    for (const GoldenResult& r : results) failed += r.pass ? 0 : 1;
+    fprintf(f, "{\n  \"renderer\": \"%s\",\n  \"width\": %d,\n  \"height\": %d,\n  \"preset\": \"%s\",\n"
+               "  \"min_psnr_db\": %.2f,\n  \"max_flip\": %.4f,\n  \"failed\": %d,\n  \"cases\": [\n",
+        Json_Escape(renderer).c_str(), width, height, preset, budget.minPsnr, budget.maxFlip, failed);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const GoldenResult& r = results[i];
+        BenchToggles t = Bench_Toggles(r.c->toggles);
+        fprintf(f, "    {\"name\":\"%s\",\"path\":\"%s\",\"t\":%.3f,\"bumpy\":%s,\"self_shadowing\":%s,"
+                   "\"multisampling\":%s,\"parallax\":%s,\"gl_ms\":%.4f,\"cpu_ms\":%.2f,\"pass\":%s,\"viewports\":{",
+            r.c->name, benchPaths[r.c->path].name, r.c->t, t.bumpy ? "true" : "false",
+            t.selfShadowing ? "true" : "false", t.multisampling ? "true" : "false",
+            t.parallaxEnabled ? "true" : "false", r.glMs, r.cpuMs, r.pass ? "true" : "false");
+        for (int k = 0; k < TECH_COUNT; ++k) {
+            const GoldenScore& s = r.score[k];
+            fprintf(f, "%s\"%s\":{\"psnr_db\":%.3f,\"ssim\":%.5f,\"flip\":%.5f,\"pass\":%s}", k ? "," : "",
+                techniqueNames[k], s.psnr, s.ssim, s.flip, s.pass ? "true" : "false");
+        }
+        fprintf(f, "}}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+#endif //__GOLDEN_H__
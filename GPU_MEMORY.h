@@ -0,0 +1,229 @@
+//**************************************************************************************
+// File GPU_MEMORY.h
+// Registry of the GPU memory the demo allocates: every texture, buffer and
+// renderbuffer is tracked with its size and a category. Sizes are computed
+// from the allocation (RGB8 counts as 4 bytes per texel, as drivers pad it).
+//
+// A budget caps the reducible allocations only, the textures whose owner
+// provides a reduce callback (the material maps); render targets, staging
+// buffers, geometry and caches of a fixed size are reported but cannot be
+// shrunk, so they do not count against it. GpuMem_Enforce() brings the
+// reducible total under the budget: the largest reducible texture loses its
+// top level, one at a time, down to 1/2^GPUMEM_MAX_DROP of its size. If
+// that is not enough it says so once. The registry never touches GL objects
+// itself.
+//**************************************************************************************
+#ifndef __GPU_MEMORY_H__
+#define __GPU_MEMORY_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+#define GPUMEM_MAX_DROP 4       // top levels a texture may lose to the budget
+
+#ifndef GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX
+#define GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX 0x9049
+#endif
+#ifndef GL_TEXTURE_FREE_MEMORY_ATI
+#define GL_TEXTURE_FREE_MEMORY_ATI 0x87FC
+#endif
+
+enum GpuMemCategory {
+    GPUMEM_MATERIAL = 0,    // color, height and normal maps
+    GPUMEM_DERIVED,         // maps built from them (cone, horizon, AO, shadow caches)
+    GPUMEM_GEOMETRY,        // vertex and index buffers
+    GPUMEM_RENDER_TARGET,   // offscreen color/depth
+    GPUMEM_STAGING,         // readback and upload buffers
+    GPUMEM_CATEGORY_COUNT
+};
+
+static const char* gpuMemCategoryNames[GPUMEM_CATEGORY_COUNT] = {
+    "material", "derived", "geometry", "render_target", "staging"
+};
+
+enum GpuMemKind {
+    GPUMEM_TEXTURE = 0,
+    GPUMEM_BUFFER,
+    GPUMEM_RENDERBUFFER
+};
+
+struct GpuMemEntry {
+    GpuMemKind     kind;
+    GLuint         id;
+    GpuMemCategory category;
+    std::string    name;
+    size_t         bytes = 0;
+    int            dropped = 0;     // top levels dropped for the budget
+    std::function<size_t(int)> reduce;  // re-upload without the top n levels, returns the new size
+};
+
+struct GpuMemRegistry {
+    std::vector<GpuMemEntry> entries;
+    size_t budget = 0;              // bytes of reducible allocations, 0 = unlimited
+    size_t peak = 0;
+    int    droppedLevels = 0;
+    bool   enforcing = false;
+    bool   unmet = false;           // reported that the budget cannot be met
+};
+
+static GpuMemRegistry gpuMem;
+
+// Bytes of a texture level 0 (and its mip chain)
+static size_t GpuMem_TextureBytes(int width, int height, int bytesPerTexel, bool mipmapped = false) {
+    size_t bytes = (size_t)width * height * bytesPerTexel;
+    return mipmapped ? bytes * 4 / 3 : bytes;
+}
+
+static size_t GpuMem_Total(int category = -1) {
+    size_t total = 0;
+    for (const GpuMemEntry& e : gpuMem.entries)
+        if (category < 0 || e.category == category) total += e.bytes;
+    return total;
+}
+
+// Bytes the budget applies to
+static size_t GpuMem_Reducible() {
+    size_t total = 0;
+    for (const GpuMemEntry& e : gpuMem.entries)
+        if (e.reduce) total += e.bytes;
+    return total;
+}
+
+static int GpuMem_Find(GpuMemKind kind, GLuint id) {
+    for (size_t i = 0; i < gpuMem.entries.size(); ++i)
+        if (gpuMem.entries[i].kind == kind && gpuMem.entries[i].id == id) return (int)i;
+    return -1;
+}
+
+static bool GpuMem_Enforce();
+
+// Add an allocation or update its size (re-specified texture, resized buffer)
+static void GpuMem_Track(GpuMemKind kind, GLuint id, GpuMemCategory category, const char* name, size_t bytes) {
+    int i = GpuMem_Find(kind, id);
+    if (i < 0) {
+        GpuMemEntry e;
+        e.kind = kind;
+        e.id = id;
+        e.category = category;
+        e.name = name;
+        gpuMem.entries.push_back(e);
+        i = (int)gpuMem.entries.size() - 1;
+    }
+    gpuMem.entries[i].bytes = bytes;
+    size_t total = GpuMem_Total();
+    if (total > gpuMem.peak) gpuMem.peak = total;
+    GpuMem_Enforce();
+}
+
+static void GpuMem_Release(GpuMemKind kind, GLuint id) {
+    int i = GpuMem_Find(kind, id);
+    if (i >= 0) gpuMem.entries.erase(gpuMem.entries.begin() + i);
+}
+
+static void GpuMem_SetReducer(GpuMemKind kind, GLuint id, std::function<size_t(int)> reduce) {
+    int i = GpuMem_Find(kind, id);
+    if (i < 0) return;
+    gpuMem.entries[i].reduce = reduce;
+    GpuMem_Enforce();
+}
+
+// Reduce until the reducible total fits the budget; false if it still does not
+static bool GpuMem_Enforce() {
+    if (gpuMem.budget == 0 || gpuMem.enforcing) return true;
+    gpuMem.enforcing = true;
+    while (GpuMem_Reducible() > gpuMem.budget) {
+        int victim = -1;
+        for (size_t i = 0; i < gpuMem.entries.size(); ++i) {
+            const GpuMemEntry& e = gpuMem.entries[i];
+            if (e.reduce && e.dropped < GPUMEM_MAX_DROP &&
+                (victim < 0 || e.bytes > gpuMem.entries[victim].bytes)) victim = (int)i;
+        }
+        if (victim < 0) break;
+        GpuMemEntry& e = gpuMem.entries[victim];
+        ++e.dropped;
+        ++gpuMem.droppedLevels;
+        std::function<size_t(int)> reduce = e.reduce;
+        size_t bytes = reduce(e.dropped);
+        gpuMem.entries[victim].bytes = bytes;
+        fprintf(stdout, "GPU memory: %s down %d level(s) (%.1f MB) for the budget\n",
+            gpuMem.entries[victim].name.c_str(), gpuMem.entries[victim].dropped, bytes / 1048576.0);
+    }
+    gpuMem.enforcing = false;
+    bool met = GpuMem_Reducible() <= gpuMem.budget;
+    if (!met && !gpuMem.unmet) {
+        fprintf(stderr, "WARNING: GPU memory budget of %.1f MB cannot be met: the reducible textures need %.1f MB "
+                        "at %d levels down\n", gpuMem.budget / 1048576.0, GpuMem_Reducible() / 1048576.0, GPUMEM_MAX_DROP);
+        gpuMem.unmet = true;
+    }
+    return met;
+}
+
+static void GpuMem_SetBudget(size_t bytes) {
+    gpuMem.budget = bytes;
+    GpuMem_Enforce();
+}
+
+// Free video memory as reported by the driver, in KB; -1 if it does not say
+static long GpuMem_DriverFreeKB() {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (!ext) continue;
+        GLint info[4] = { 0, 0, 0, 0 };
+        if (!strcmp(ext, "GL_NVX_gpu_memory_info")) {
+            glGetIntegerv(GL_GPU_MEMORY_INFO_CURRENT_AVAILABLE_VIDMEM_NVX, info);
+            return info[0];
+        }
+        if (!strcmp(ext, "GL_ATI_meminfo")) {
+            glGetIntegerv(GL_TEXTURE_FREE_MEMORY_ATI, info);
+            return info[0];
+        }
+    }
+    return -1;
+}
+
+// "mem 12.3 MB" or "mem 12.3 MB, reducible 8.0/16.0" for the title/HUD
+static void GpuMem_Format(char* buf, size_t size) {
+    if (gpuMem.budget)
+        snprintf(buf, size, "mem %.1f MB, reducible %.1f/%.1f", GpuMem_Total() / 1048576.0,
+            GpuMem_Reducible() / 1048576.0, gpuMem.budget / 1048576.0);
+    else
+        snprintf(buf, size, "mem %.1f MB", GpuMem_Total() / 1048576.0);
+}
+
+static void GpuMem_Print(FILE* f) {
+    fprintf(f, "GPU memory: %.1f MB (peak %.1f MB", GpuMem_Total() / 1048576.0, gpuMem.peak / 1048576.0);
+    if (gpuMem.budget)
+        fprintf(f, ", reducible %.1f MB of a %.1f MB budget%s", GpuMem_Reducible() / 1048576.0, gpuMem.budget / 1048576.0,
+            GpuMem_Reducible() > gpuMem.budget ? " EXCEEDED" : "");
+    fprintf(f, ")");
+    for (int c = 0; c < GPUMEM_CATEGORY_COUNT; ++c) {
+        size_t bytes = GpuMem_Total(c);
+        if (bytes) fprintf(f, " %s %.1f", gpuMemCategoryNames[c], bytes / 1048576.0);
+    }
+    if (gpuMem.droppedLevels) fprintf(f, ", %d levels dropped", gpuMem.droppedLevels);
+    long freeKB = GpuMem_DriverFreeKB();
+    if (freeKB >= 0) fprintf(f, ", driver reports %.1f MB free", freeKB / 1024.0);
+    fprintf(f, "\n");
+}
+
+// "gpu_memory" member for JSON reports
+static std::string GpuMem_Json() {
+    char buf[256];
+    snprintf(buf, sizeof(buf), "\"gpu_memory\": {\"total_mb\":%.3f,\"peak_mb\":%.3f,\"reducible_mb\":%.3f,"
+                               "\"budget_mb\":%.3f,\"dropped_levels\":%d,\"categories\":{",
+        GpuMem_Total() / 1048576.0, gpuMem.peak / 1048576.0, GpuMem_Reducible() / 1048576.0,
+        gpuMem.budget / 1048576.0, gpuMem.droppedLevels);
+    std::string json = buf;
+    for (int c = 0; c < GPUMEM_CATEGORY_COUNT; ++c) {
+        snprintf(buf, sizeof(buf), "%s\"%s\":%.3f", c ? "," : "", gpuMemCategoryNames[c], GpuMem_Total(c) / 1048576.0);
+        json += buf;
+    }
+    return json + "}}";
+}
+
+#endif //__GPU_MEMORY_H__
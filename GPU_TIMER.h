@@ -0,0 +1,161 @@
+//**************************************************************************************
+// File GPU_TIMER.h
+// Per-pass GPU timing with GL_TIME_ELAPSED queries. Every pass owns a ring of
+// GPU_TIMER_LATENCY query objects; a query is only read back when its slot
+// comes round again, i.e. GPU_TIMER_LATENCY frames later, and only if
+// GL_QUERY_RESULT_AVAILABLE says so. Nothing ever waits on the GPU; a result
+// that is still not ready is counted as dropped and the slot is reused.
+//**************************************************************************************
+#ifndef __GPU_TIMER_H__
+#define __GPU_TIMER_H__
+
+#include <stdio.h>
+#include "STATS.h"
+
+#define GPU_TIMER_LATENCY 3     // frames between issuing and reading a query
+#define GPU_TIMER_WINDOW  240   // samples kept for the rolling statistics
+
+// Timed passes of Handle_Display
+enum GpuPass {
+    PASS_PARALLAX = 0,  // left viewport, psProg
+    PASS_STEEP,         // right viewport, psSteepProg
+    PASS_COUNT
+};
+
+struct GpuPassTimer {
+    const char* name;
+    GLuint      queries[GPU_TIMER_LATENCY];
+    int         issuedFrame[GPU_TIMER_LATENCY];   // frame that used the slot, -1 if unused
+    RollingWindow<GPU_TIMER_WINDOW> window;
+    int         dropped;
+    int         resolved;           // samples read back so far
+    double      resolvedMs;         // their sum
+    std::vector<double> captured;   // every resolved sample while capturing
+};
+
+static GpuPassTimer gpuPasses[PASS_COUNT] = {
+    { "parallax", {}, {}, {}, 0, 0, 0.0, {} },
+    { "steep",    {}, {}, {}, 0, 0, 0.0, {} }
+};
+static int   gpuTimerFrame = 0;
+static bool  gpuTimerReady = false;
+static FILE* gpuTimerCsv = nullptr;
+static bool  gpuTimerCapturing = false;
+
+// Create the query objects; optionally stream every resolved sample to a CSV file
+static void GpuTimer_Init(const char* csvPath) {
+    for (GpuPassTimer& p : gpuPasses) {
+        glGenQueries(GPU_TIMER_LATENCY, p.queries);
+        for (int i = 0; i < GPU_TIMER_LATENCY; ++i) p.issuedFrame[i] = -1;
+        p.dropped = 0;
+        p.resolved = 0;
+        p.resolvedMs = 0.0;
+    }
+    if (csvPath) {
+        gpuTimerCsv = fopen(csvPath, "w");
+        if (gpuTimerCsv)
+            fprintf(gpuTimerCsv, "frame,pass,ms,min_ms,avg_ms,p95_ms,p99_ms\n");
+        else
+            fprintf(stderr, "ERROR: cannot write '%s'\n", csvPath);
+    }
+    gpuTimerReady = true;
+}
+
+// Harvest the slot about to be reused; without wait, only if its result is available
+static void GpuTimer_Collect(GpuPassTimer& p, int slot, bool wait = false) {
+    int frame = p.issuedFrame[slot];
+    if (frame < 0) return;
+    p.issuedFrame[slot] = -1;
+
+    GLint available = GL_TRUE;
+    if (!wait) glGetQueryObjectiv(p.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!available) {
+        ++p.dropped;
+        return;
+    }
+    GLuint64 ns = 0;
+    glGetQueryObjectui64v(p.queries[slot], GL_QUERY_RESULT, &ns);
+    double ms = (double)ns * 1e-6;
+    p.window.add(ms);
+    ++p.resolved;
+    p.resolvedMs += ms;
+    if (gpuTimerCapturing) p.captured.push_back(ms);
+
+    if (gpuTimerCsv) {
+        StatSummary s = p.window.summary();
+        fprintf(gpuTimerCsv, "%d,%s,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+            frame, p.name, ms, s.min, s.avg, s.p95, s.p99);
+    }
+}
+
+static void GpuTimer_BeginPass(GpuPass pass) {
+    if (!gpuTimerReady) return;
+    GpuPassTimer& p = gpuPasses[pass];
+    int slot = gpuTimerFrame % GPU_TIMER_LATENCY;
+    GpuTimer_Collect(p, slot);
+    glBeginQuery(GL_TIME_ELAPSED, p.queries[slot]);
+    p.issuedFrame[slot] = gpuTimerFrame;
+}
+
+static void GpuTimer_EndPass(GpuPass) {
+    if (!gpuTimerReady) return;
+    glEndQuery(GL_TIME_ELAPSED);
+}
+
+// Call once per frame after the last pass
+static void GpuTimer_EndFrame() {
+    if (gpuTimerReady) ++gpuTimerFrame;
+}
+
+// Block until every issued query has a result and fold it into the stats.
+// Only for use between measurement runs, never inside the frame loop.
+static void GpuTimer_Flush() {
+    if (!gpuTimerReady) return;
+    for (GpuPassTimer& p : gpuPasses) {
+        for (int k = 0; k < GPU_TIMER_LATENCY; ++k) {
+            GpuTimer_Collect(p, (gpuTimerFrame + k) % GPU_TIMER_LATENCY, true);
+        }
+    }
+}
+
+// Start collecting every resolved sample (for benchmarks)
+static void GpuTimer_BeginCapture() {
+    GpuTimer_Flush();
+    for (GpuPassTimer& p : gpuPasses) p.captured.clear();
+    gpuTimerCapturing = true;
+}
+
+// Stop collecting; returns the samples of one pass captured since BeginCapture
+static void GpuTimer_EndCapture(std::vector<double> out[PASS_COUNT]) {
+    GpuTimer_Flush();
+    gpuTimerCapturing = false;
+    for (int i = 0; i < PASS_COUNT; ++i) out[i].swap(gpuPasses[i].captured);
+}
+
+// Most recent resolved sample and rolling statistics of a pass
+static StatSummary GpuTimer_Summary(GpuPass pass) {
+    return gpuPasses[pass].window.summary();
+}
+
+// One-line report, e.g. for the window title or the console
+static void GpuTimer_Format(char* buf, size_t size) {
+    StatSummary a = GpuTimer_Summary(PASS_PARALLAX);
+    StatSummary b = GpuTimer_Summary(PASS_STEEP);
+    snprintf(buf, size,
+        "parallax %.2f ms (min %.2f p95 %.2f p99 %.2f) | steep %.2f ms (min %.2f p95 %.2f p99 %.2f)",
+        a.avg, a.min, a.p95, a.p99, b.avg, b.min, b.p95, b.p99);
+}
+
+static void GpuTimer_Shutdown() {
+    if (!gpuTimerReady) return;
+    for (GpuPassTimer& p : gpuPasses) {
+        glDeleteQueries(GPU_TIMER_LATENCY, p.queries);
+        if (p.dropped)
+            fprintf(stderr, "WARNING: %d GPU timer samples for '%s' were not ready in time\n", p.dropped, p.name);
+    }
+    if (gpuTimerCsv) fclose(gpuTimerCsv);
+    gpuTimerCsv = nullptr;
+    gpuTimerReady = false;
+}
+
+#endif //__GPU_TIMER_H__
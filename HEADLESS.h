@@ -0,0 +1,202 @@
+//**************************************************************************************
+// File HEADLESS.h
+// Offscreen rendering without a visible window. On Linux the context comes from
+// EGL (surfaceless platform, so Mesa llvmpipe works on hosts with no display);
+// on Windows a hidden GLUT window provides it. Either way the scene is drawn
+// into a (optionally multisampled) framebuffer object that can be resolved
+// and read back (CAPTURE.h writes the frames out).
+//**************************************************************************************
+#ifndef __HEADLESS_H__
+#define __HEADLESS_H__
+
+#include <stdio.h>
+#include "GL_DEBUG.h"
+#include "GPU_MEMORY.h"
+
+#ifndef _WIN32
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+// Offscreen render target
+struct HeadlessTarget {
+    GLuint fbo = 0;
+    GLuint color = 0;
+    GLuint depth = 0;
+    GLuint resolveFbo = 0;      // single-sample copy when samples > 0
+    GLuint resolveColor = 0;
+    int    width = 0;
+    int    height = 0;
+    int    samples = 0;
+};
+
+static HeadlessTarget headlessTarget;
+
+#ifndef _WIN32
+static EGLDisplay headlessDisplay = EGL_NO_DISPLAY;
+static EGLContext headlessContext = EGL_NO_CONTEXT;
+static EGLSurface headlessSurface = EGL_NO_SURFACE;
+#endif
+
+// Create and make current a GL context that has no window on screen; debug asks for a
+// KHR_debug debug context where the driver offers one
+static bool Headless_CreateContext(int* argc, char* argv[], bool debug) {
+#ifdef _WIN32
+    glutInit(argc, argv);
+    glutInitDisplayMode(GLUT_RGBA | GLUT_DEPTH);
+    if (debug) glutInitContextFlags(GLUT_DEBUG);
+    glutInitWindowSize(1, 1);
+    glutCreateWindow("Parallax Mapping GLSL (headless)");
+    glutHideWindow();
+    return true;
+#else
+    (void)argc; (void)argv;
+
+    // Prefer the surfaceless platform: it needs neither X11 nor a DRM device
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay =
+        (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        headlessDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+    if (headlessDisplay == EGL_NO_DISPLAY)
+        headlessDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major = 0, minor = 0;
+    if (headlessDisplay == EGL_NO_DISPLAY || !eglInitialize(headlessDisplay, &major, &minor)) {
+        fprintf(stderr, "ERROR: eglInitialize failed (0x%x)\n", eglGetError());
+        return false;
+    }
+    if (!eglBindAPI(EGL_OPENGL_API)) {
+        fprintf(stderr, "ERROR: EGL has no desktop OpenGL support\n");
+        return false;
+    }
+
+    const EGLint configAttribs[] = {
+        EGL_SURFACE_TYPE,    EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config = nullptr;
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(headlessDisplay, configAttribs, &config, 1, &numConfigs) || numConfigs < 1) {
+        fprintf(stderr, "ERROR: no suitable EGL config\n");
+        return false;
+    }
+
+    // Default (compatibility) profile: the scene still uses the matrix stack
+    const EGLint debugAttribs[] = { EGL_CONTEXT_OPENGL_DEBUG, EGL_TRUE, EGL_NONE };
+    if (debug) headlessContext = eglCreateContext(headlessDisplay, config, EGL_NO_CONTEXT, debugAttribs);
+    if (headlessContext == EGL_NO_CONTEXT)
+        headlessContext = eglCreateContext(headlessDisplay, config, EGL_NO_CONTEXT, nullptr);
+    if (headlessContext == EGL_NO_CONTEXT) {
+        fprintf(stderr, "ERROR: eglCreateContext failed (0x%x)\n", eglGetError());
+        return false;
+    }
+
+    // Surfaceless if the driver allows it, otherwise a dummy 1x1 pbuffer
+    if (!eglMakeCurrent(headlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, headlessContext)) {
+        const EGLint pbufferAttribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        headlessSurface = eglCreatePbufferSurface(headlessDisplay, config, pbufferAttribs);
+        if (headlessSurface == EGL_NO_SURFACE ||
+            !eglMakeCurrent(headlessDisplay, headlessSurface, headlessSurface, headlessContext)) {
+            fprintf(stderr, "ERROR: eglMakeCurrent failed (0x%x)\n", eglGetError());
+            return false;
+        }
+    }
+    fprintf(stdout, "EGL %d.%d: %s\n", major, minor, (const char*)glGetString(GL_RENDERER));
+    return true;
+#endif
+}
+
+// Allocate color + depth renderbuffers and leave the FBO bound for drawing.
+// samples > 0 gives a multisampled target, like the GLUT_MULTISAMPLE window.
+static bool Headless_CreateTarget(int w, int h, int samples) {
+    HeadlessTarget& t = headlessTarget;
+    t.width = w;
+    t.height = h;
+    t.samples = samples;
+
+    glGenRenderbuffers(1, &t.color);
+    glBindRenderbuffer(GL_RENDERBUFFER, t.color);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_RGBA8, w, h);
+
+    glGenRenderbuffers(1, &t.depth);
+    glBindRenderbuffer(GL_RENDERBUFFER, t.depth);
+    glRenderbufferStorageMultisample(GL_RENDERBUFFER, samples, GL_DEPTH24_STENCIL8, w, h);
+
+    size_t perSample = (size_t)w * h * 4 * (samples > 0 ? samples : 1);
+    GpuMem_Track(GPUMEM_RENDERBUFFER, t.color, GPUMEM_RENDER_TARGET, "offscreen color", perSample);
+    GpuMem_Track(GPUMEM_RENDERBUFFER, t.depth, GPUMEM_RENDER_TARGET, "offscreen depth", perSample);
+    GLDebug_Label(GL_RENDERBUFFER, t.color, "offscreen color");
+    GLDebug_Label(GL_RENDERBUFFER, t.depth, "offscreen depth");
+
+    if (samples > 0) {
+        glGenRenderbuffers(1, &t.resolveColor);
+        glBindRenderbuffer(GL_RENDERBUFFER, t.resolveColor);
+        glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, w, h);
+        GpuMem_Track(GPUMEM_RENDERBUFFER, t.resolveColor, GPUMEM_RENDER_TARGET, "offscreen resolve", (size_t)w * h * 4);
+
+        glGenFramebuffers(1, &t.resolveFbo);
+        glBindFramebuffer(GL_FRAMEBUFFER, t.resolveFbo);
+        glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t.resolveColor);
+        GLDebug_Label(GL_RENDERBUFFER, t.resolveColor, "offscreen resolve");
+        GLDebug_Label(GL_FRAMEBUFFER, t.resolveFbo, "resolve FBO");
+    }
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &t.fbo);
+    glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, t.color);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, t.depth);
+    GLDebug_Label(GL_FRAMEBUFFER, t.fbo, "offscreen FBO");
+
+    GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "ERROR: offscreen framebuffer incomplete (0x%x)\n", status);
+        return false;
+    }
+    glDrawBuffer(GL_COLOR_ATTACHMENT0);
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+    return true;
+}
+
+// Resolve (if multisampled) and bind the framebuffer that holds the final image for reading
+static void Headless_BindForRead() {
+    const HeadlessTarget& t = headlessTarget;
+    if (t.samples > 0) {
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, t.fbo);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, t.resolveFbo);
+        glBlitFramebuffer(0, 0, t.width, t.height, 0, 0, t.width, t.height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, t.fbo);
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, t.resolveFbo);
+    }
+    else {
+        glBindFramebuffer(GL_FRAMEBUFFER, t.fbo);
+    }
+    glReadBuffer(GL_COLOR_ATTACHMENT0);
+}
+
+// Release the offscreen target and the context
+static void Headless_Destroy() {
+    HeadlessTarget& t = headlessTarget;
+    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    glDeleteFramebuffers(1, &t.fbo);
+    glDeleteRenderbuffers(1, &t.color);
+    glDeleteRenderbuffers(1, &t.depth);
+    GpuMem_Release(GPUMEM_RENDERBUFFER, t.color);
+    GpuMem_Release(GPUMEM_RENDERBUFFER, t.depth);
+    if (t.resolveFbo) {
+        glDeleteFramebuffers(1, &t.resolveFbo);
+        glDeleteRenderbuffers(1, &t.resolveColor);
+        GpuMem_Release(GPUMEM_RENDERBUFFER, t.resolveColor);
+    }
+    t = HeadlessTarget();
+#ifndef _WIN32
+    eglMakeCurrent(headlessDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (headlessSurface != EGL_NO_SURFACE) eglDestroySurface(headlessDisplay, headlessSurface);
+    eglDestroyContext(headlessDisplay, headlessContext);
+    eglTerminate(headlessDisplay);
+#endif
+}
+
+#endif //__HEADLESS_H__
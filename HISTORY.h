@@ -0,0 +1,401 @@
+//**************************************************************************************
+// File HISTORY.h
+// Performance history. Every benchmark run appends one flat JSON object per
+// configuration to a local JSON-lines store (commit, machine fingerprint,
+// toggles, and n/mean/sd/p50/p95 of every timed metric and of the CPU
+// reference's texture fetches per pixel). History_Diff()
+// compares a run with another run, or with a rolling baseline pooled from
+// the previous runs on the same machine, and flags changes that are both
+// statistically significant (Welch's t-test) and larger than a threshold.
+//**************************************************************************************
+#ifndef __HISTORY_H__
+#define __HISTORY_H__
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "BENCHMARK.h"
+#include "JSON.h"
+
+#ifdef _WIN32
+#define popen  _popen
+#define pclose _pclose
+#endif
+
+#define HISTORY_MIN_DELTA_MS 0.01   // changes below this (ms, or fetches per pixel) are noise, never flagged
+
+// Metrics stored per configuration, as "<name>_n", "<name>_mean", ...
+static const char* historyMetrics[] = { "frame", "parallax", "steep", "parallax_fetches", "steep_fetches" };
+static const int   historyMetricCount = 5;
+
+struct HistoryRunInfo {
+    std::string run;            // unique id of this run
+    std::string time;           // ISO-8601 UTC
+    std::string commit;
+    std::string machine;        // fingerprint hash
+    std::string machineDesc;    // what went into the fingerprint
+    int width = 0;
+    int height = 0;
+};
+
+// One parsed line of the store: key -> raw value (strings unquoted)
+typedef std::map<std::string, std::string> HistoryRecord;
+
+// FNV-1a, good enough to tell machines apart
+static unsigned long long History_Hash(const std::string& s) {
+    unsigned long long h = 1469598103934665603ULL;
+    for (unsigned char c : s) { h ^= c; h *= 1099511628211ULL; }
+    return h;
+}
+
+// GPU, driver and CPU/OS description plus its hash
+static void History_Fingerprint(const char* renderer, const char* version, HistoryRunInfo& info) {
+    char desc[512];
+    snprintf(desc, sizeof(desc), "%s | %s | %u threads | %s",
+        renderer ? renderer : "?", version ? version : "?", std::thread::hardware_concurrency(),
+#ifdef _WIN32
+        "windows"
+#elif defined(__APPLE__)
+        "macos"
+#else
+        "linux"
+#endif
+    );
+    char hash[32];
+    snprintf(hash, sizeof(hash), "%016llx", History_Hash(desc));
+    info.machineDesc = desc;
+    info.machine = hash;
+}
+
+// Commit being measured: explicit, $GIT_COMMIT, or `git rev-parse` in the working directory
+static std::string History_Commit(const char* explicitCommit) {
+    if (explicitCommit && *explicitCommit) return explicitCommit;
+    const char* env = getenv("GIT_COMMIT");
+    if (env && *env) return env;
+    std::string commit = "unknown";
+#ifdef _WIN32
+    FILE* p = popen("git rev-parse --short HEAD 2>nul", "r");
+#else
+    FILE* p = popen("git rev-parse --short HEAD 2>/dev/null", "r");
+#endif
+    if (p) {
+        char buf[64];
+        if (fgets(buf, sizeof(buf), p)) {
+            buf[strcspn(buf, "\r\n")] = 0;
+            if (*buf) commit = buf;
+        }
+        pclose(p);
+    }
+    return commit;
+}
+
+static void History_Now(HistoryRunInfo& info) {
+    time_t now = time(nullptr);
+    struct tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &now);
+#else
+    gmtime_r(&now, &utc);
+#endif
+    char buf[64];
+    strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    info.time = buf;
+    strftime(buf, sizeof(buf), "%Y%m%d-%H%M%S", &utc);
+    char id[96];
+    snprintf(id, sizeof(id), "%s-%04x", buf, (unsigned)(History_Hash(info.machine + buf) & 0xffff));
+    info.run = id;
+}
+
+static void History_WriteMetric(FILE* f, const char* name, const StatSummary& s) {
+    fprintf(f, ",\"%s_n\":%d,\"%s_mean\":%.5f,\"%s_sd\":%.5f,\"%s_p50\":%.5f,\"%s_p95\":%.5f",
+        name, s.count, name, s.avg, name, s.stddev, name, s.p50, name, s.p95);
+}
+
+// Append one line per configuration of a benchmark run
+static bool History_Append(const char* path, const HistoryRunInfo& info, const std::vector<BenchResult>& results) {
+    FILE* f = fopen(path, "a");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot append to '%s'\n", path);
+        return false;
+    }
+    for (const BenchResult& r : results) {
+        fprintf(f, "{\"run\":\"%s\",\"time\":\"%s\",\"commit\":\"%s\",\"machine\":\"%s\",\"machine_desc\":\"%s\","
+                   "\"width\":%d,\"height\":%d,\"path\":\"%s\",\"bumpy\":%d,\"selfShadowing\":%d,\"multisampling\":%d,\"parallaxEnabled\":%d",
+            Json_Escape(info.run.c_str()).c_str(), Json_Escape(info.time.c_str()).c_str(), Json_Escape(info.commit.c_str()).c_str(),
+            Json_Escape(info.machine.c_str()).c_str(), Json_Escape(info.machineDesc.c_str()).c_str(), info.width, info.height,
+            Json_Escape(r.path).c_str(),
+            r.toggles.bumpy, r.toggles.selfShadowing, r.toggles.multisampling, r.toggles.parallaxEnabled);
+        History_WriteMetric(f, "frame", r.frameMs);
+        History_WriteMetric(f, "parallax", r.parallaxMs);
+        History_WriteMetric(f, "steep", r.steepMs);
+        if (r.parallaxFetches.count) History_WriteMetric(f, "parallax_fetches", r.parallaxFetches);
+        if (r.steepFetches.count) History_WriteMetric(f, "steep_fetches", r.steepFetches);
+        fprintf(f, "}\n");
+    }
+    fclose(f);
+    fprintf(stdout, "Appended run %s (%zu configurations) to '%s'\n", info.run.c_str(), results.size(), path);
+    return true;
+}
+
+// Parse one flat JSON object ({"key":value,...}; values are strings, numbers or literals)
+static bool History_ParseLine(const char* s, HistoryRecord& rec) {
+    rec.clear();
+    while (*s && *s != '{') ++s;
+    if (!*s) return false;
+    ++s;
+    for (;;) {
+        while (*s == ' ' || *s == ',' || *s == '\t') ++s;
+        if (*s == '}' || !*s) break;
+        if (*s != '"') return false;
+        std::string key;
+        for (++s; *s && *s != '"'; ++s) key += *s;
+        if (*s != '"') return false;
+        ++s;
+        while (*s == ' ' || *s == ':') ++s;
+        std::string value;
+        if (*s == '"') {
+            for (++s; *s && *s != '"'; ++s) {
+                if (*s != '\\' || !s[1]) {
+                    value += *s;
+                    continue;
+                }
+                // Undo Json_Escape()
+                ++s;
+                if (*s == 'n') value += '\n';
+                else if (*s == 'r') value += '\r';
+                else if (*s == 't') value += '\t';
+                else if (*s == 'u' && strlen(s) >= 5) {
+                    value += (char)strtol(std::string(s + 1, 4).c_str(), nullptr, 16);
+                    s += 4;
+                }
+                else value += *s;
+            }
+            if (*s == '"') ++s;
+        }
+        else {
+            while (*s && *s != ',' && *s != '}') value += *s++;
+        }
+        rec[key] = value;
+    }
+    return !rec.empty();
+}
+
+static double History_Num(const HistoryRecord& rec, const std::string& key) {
+    HistoryRecord::const_iterator it = rec.find(key);
+    return it == rec.end() ? 0.0 : atof(it->second.c_str());
+}
+
+static std::string History_Str(const HistoryRecord& rec, const std::string& key) {
+    HistoryRecord::const_iterator it = rec.find(key);
+    return it == rec.end() ? std::string() : it->second;
+}
+
+// Configuration identity: resolution, path and toggles
+static std::string History_ConfigKey(const HistoryRecord& r) {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "%sx%s %-11s B%s S%s M%s P%s",
+        History_Str(r, "width").c_str(), History_Str(r, "height").c_str(), History_Str(r, "path").c_str(),
+        History_Str(r, "bumpy").c_str(), History_Str(r, "selfShadowing").c_str(),
+        History_Str(r, "multisampling").c_str(), History_Str(r, "parallaxEnabled").c_str());
+    return buf;
+}
+
+// n / mean / sd of a metric, possibly pooled over several runs
+struct HistoryMoments {
+    double n = 0.0;
+    double mean = 0.0;
+    double sd = 0.0;
+};
+
+static HistoryMoments History_Moments(const HistoryRecord& r, const char* metric) {
+    std::string m = metric;
+    HistoryMoments s;
+    s.n = History_Num(r, m + "_n");
+    s.mean = History_Num(r, m + "_mean");
+    s.sd = History_Num(r, m + "_sd");
+    return s;
+}
+
+// Combine groups into one sample (exact pooled mean and variance)
+static HistoryMoments History_Pool(const std::vector<HistoryMoments>& groups) {
+    HistoryMoments p;
+    for (const HistoryMoments& g : groups) {
+        p.n += g.n;
+        p.mean += g.n * g.mean;
+    }
+    if (p.n <= 0.0) return p;
+    p.mean /= p.n;
+    double ss = 0.0;
+    for (const HistoryMoments& g : groups)
+        ss += (g.n - 1.0) * g.sd * g.sd + g.n * (g.mean - p.mean) * (g.mean - p.mean);
+    p.sd = p.n > 1.0 ? sqrt(ss / (p.n - 1.0)) : 0.0;
+    return p;
+}
+
+// Continued fraction for the regularized incomplete beta function
+static double History_BetaCF(double a, double b, double x) {
+    const double tiny = 1e-300;
+    double qab = a + b, qap = a + 1.0, qam = a - 1.0;
+    double c = 1.0, d = 1.0 - qab * x / qap;
+    if (fabs(d) < tiny) d = tiny;
+    d = 1.0 / d;
+    double h = d;
+    for (int m = 1; m <= 200; ++m) {
+        int m2 = 2 * m;
+        double aa = m * (b - m) * x / ((qam + m2) * (a + m2));
+        d = 1.0 + aa * d; if (fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c; if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d; h *= d * c;
+        aa = -(a + m) * (qab + m) * x / ((a + m2) * (qap + m2));
+        d = 1.0 + aa * d; if (fabs(d) < tiny) d = tiny;
+        c = 1.0 + aa / c; if (fabs(c) < tiny) c = tiny;
+        d = 1.0 / d;
+        double del = d * c;
+        h *= del;
+        if (fabs(del - 1.0) < 1e-12) break;
+    }
+    return h;
+}
+
+static double History_IncompleteBeta(double a, double b, double x) {
+    if (x <= 0.0) return 0.0;
+    if (x >= 1.0) return 1.0;
+    double front = exp(lgamma(a + b) - lgamma(a) - lgamma(b) + a * log(x) + b * log(1.0 - x));
+    if (x < (a + 1.0) / (a + b + 2.0)) return front * History_BetaCF(a, b, x) / a;
+    return 1.0 - front * History_BetaCF(b, a, 1.0 - x) / b;
+}
+
+// Two-sided p-value of Welch's unequal-variance t-test
+static double History_WelchP(const HistoryMoments& a, const HistoryMoments& b) {
+    if (a.n < 2.0 || b.n < 2.0) return 1.0;
+    double va = a.sd * a.sd / a.n, vb = b.sd * b.sd / b.n;
+    if (va + vb <= 0.0) return a.mean == b.mean ? 1.0 : 0.0;
+    double t = (b.mean - a.mean) / sqrt(va + vb);
+    double df = (va + vb) * (va + vb) / (va * va / (a.n - 1.0) + vb * vb / (b.n - 1.0));
+    return History_IncompleteBeta(0.5 * df, 0.5, df / (df + t * t));
+}
+
+// Load the store; runs are kept in file order
+static bool History_Load(const char* path, std::vector<HistoryRecord>& records, std::vector<std::string>& runs) {
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot open '%s'\n", path);
+        return false;
+    }
+    std::string line;
+    char buf[4096];
+    while (fgets(buf, sizeof(buf), f)) {
+        line += buf;
+        if (line.empty() || line.back() != '\n') continue;
+        HistoryRecord rec;
+        if (History_ParseLine(line.c_str(), rec) && rec.count("run")) {
+            if (runs.empty() || runs.back() != rec["run"]) {
+                bool seen = false;
+                for (const std::string& r : runs) seen = seen || r == rec["run"];
+                if (!seen) runs.push_back(rec["run"]);
+            }
+            records.push_back(rec);
+        }
+        line.clear();
+    }
+    fclose(f);
+    return true;
+}
+
+// Compare candidate (default: latest run) with another run or with the pooled previous
+// baselineRuns runs on the same machine and print the significant changes.
+// Returns the number of regressions, -1 on error.
+static int History_Diff(const char* path, const char* candidateRun, const char* againstRun,
+                        int baselineRuns, double alpha, double minChangePct) {
+    std::vector<HistoryRecord> records;
+    std::vector<std::string> runs;
+    if (!History_Load(path, records, runs)) return -1;
+    if (runs.empty()) {
+        fprintf(stderr, "ERROR: '%s' holds no runs\n", path);
+        return -1;
+    }
+    std::string cand = candidateRun ? candidateRun : runs.back();
+
+    std::string machine;
+    for (const HistoryRecord& r : records)
+        if (r.at("run") == cand) machine = History_Str(r, "machine");
+    if (machine.empty()) {
+        fprintf(stderr, "ERROR: run '%s' not found\n", cand.c_str());
+        return -1;
+    }
+
+    // Baseline runs: the explicit one, or the latest earlier runs from the same machine
+    std::vector<std::string> base;
+    if (againstRun) {
+        bool found = false;
+        for (const std::string& r : runs) found = found || r == againstRun;
+        if (!found) {
+            fprintf(stderr, "ERROR: baseline run '%s' not found\n", againstRun);
+            return -1;
+        }
+        base.push_back(againstRun);
+    }
+    else {
+        int candIndex = 0;
+        for (int i = 0; i < (int)runs.size(); ++i) if (runs[i] == cand) candIndex = i;
+        for (int i = candIndex - 1; i >= 0 && (int)base.size() < baselineRuns; --i) {
+            for (const HistoryRecord& r : records) {
+                if (r.at("run") == runs[i] && History_Str(r, "machine") == machine) {
+                    base.push_back(runs[i]);
+                    break;
+                }
+            }
+        }
+    }
+    if (base.empty()) {
+        fprintf(stderr, "ERROR: no baseline run to compare '%s' against\n", cand.c_str());
+        return -1;
+    }
+
+    fprintf(stdout, "Candidate %s vs %s%s (alpha %.3g, min change %.1f%%)\n",
+        cand.c_str(), againstRun ? "" : "rolling baseline of ", againstRun ? againstRun : std::to_string(base.size()).append(" runs").c_str(),
+        alpha, minChangePct);
+    fprintf(stdout, "%-40s %-16s %10s %10s %8s %9s  %s\n", "configuration", "metric", "base", "cand", "change", "p", "verdict");
+
+    int regressions = 0, improvements = 0, compared = 0;
+    for (const HistoryRecord& c : records) {
+        if (c.at("run") != cand) continue;
+        std::string key = History_ConfigKey(c);
+        for (int m = 0; m < historyMetricCount; ++m) {
+            std::vector<HistoryMoments> groups;
+            for (const HistoryRecord& b : records) {
+                bool inBase = false;
+                for (const std::string& id : base) inBase = inBase || b.at("run") == id;
+                if (inBase && History_ConfigKey(b) == key) groups.push_back(History_Moments(b, historyMetrics[m]));
+            }
+            if (groups.empty()) continue;
+            HistoryMoments a = History_Pool(groups);
+            HistoryMoments b = History_Moments(c, historyMetrics[m]);
+            if (a.n < 1.0 || b.n < 1.0 || a.mean <= 0.0) continue;
+
+            double change = (b.mean - a.mean) / a.mean * 100.0;
+            double p = History_WelchP(a, b);
+            ++compared;
+            if (p >= alpha || fabs(change) < minChangePct || fabs(b.mean - a.mean) < HISTORY_MIN_DELTA_MS) continue;
+            const char* verdict = change > 0.0 ? "REGRESSION" : "improved";
+            if (change > 0.0) ++regressions; else ++improvements;
+            fprintf(stdout, "%-40s %-16s %10.4f %10.4f %+7.2f%% %9.2g  %s\n",
+                key.c_str(), historyMetrics[m], a.mean, b.mean, change, p, verdict);
+        }
+    }
+    fprintf(stdout, "%d metrics compared: %d regressions, %d improvements\n", compared, regressions, improvements);
+    // Nothing in common with the baseline is a broken comparison, not a pass
+    if (compared == 0) {
+        fprintf(stderr, "ERROR: run '%s' shares no configurations with its baseline\n", cand.c_str());
+        return -1;
+    }
+    return regressions;
+}
+
+#endif //__HISTORY_H__
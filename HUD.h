@@ -0,0 +1,390 @@
+//**************************************************************************************
+// File HUD.h
+// Performance overlay: text and rectangles batched into one vertex buffer and
+// drawn with a single call of the vsHud/psHud program. Glyphs come from a
+// built-in 5x7 font (digits, capitals and some punctuation; lower case is
+// drawn as upper case) in a small R8 atlas whose first cell is solid, so
+// rectangles and text share the texture and the draw.
+//
+// The frame-time graph scrolls over the last HUD_GRAPH_FRAMES frames; a frame
+// over HUD_STUTTER_FACTOR times the window's median is drawn red and marked
+// above the graph. The overlay times itself: CPU time to build and submit,
+// GPU time with its own GL_TIME_ELAPSED ring (read back like GPU_TIMER.h).
+//
+// Quads are four vertices drawn through a fixed index buffer. The vertex
+// buffer is allocated once, one segment of HUD_MAX_QUADS per GPU time query;
+// each frame maps its segment unsynchronised (GL 3.3 has no persistent
+// mapping), the slot's resolved query standing in for a fence, so the upload
+// neither reallocates nor waits. The font sampler is set at init and the
+// viewport uniform only when the size changes.
+//**************************************************************************************
+#ifndef __HUD_H__
+#define __HUD_H__
+
+#include <ctype.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include "GL_DEBUG.h"
+#include "GPU_MEMORY.h"
+#include "GPU_TIMER.h"
+#include "STATS.h"
+
+#define HUD_GRAPH_FRAMES   120
+#define HUD_STUTTER_FACTOR 2.0
+#define HUD_CELL           8        // atlas cell, glyphs are 5x7 in its top left
+#define HUD_SCALE          2        // screen pixels per font pixel
+#define HUD_MAX_QUADS      2048     // per segment; a batch over it is cut
+
+struct HudGlyph {
+    char          c;
+    unsigned char rows[7];          // bit 4 is the leftmost column
+};
+
+static const HudGlyph hudGlyphs[] = {
+    { '0', { 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E } },
+    { '1', { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { '2', { 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F } },
+    { '3', { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E } },
+    { '4', { 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 } },
+    { '5', { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E } },
+    { '6', { 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E } },
+    { '7', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 } },
+    { '8', { 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E } },
+    { '9', { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C } },
+    { 'A', { 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'B', { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E } },
+    { 'C', { 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E } },
+    { 'D', { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C } },
+    { 'E', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F } },
+    { 'F', { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'G', { 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F } },
+    { 'H', { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 } },
+    { 'I', { 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E } },
+    { 'J', { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C } },
+    { 'K', { 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 } },
+    { 'L', { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F } },
+    { 'M', { 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 } },
+    { 'N', { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 } },
+    { 'O', { 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'P', { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 } },
+    { 'Q', { 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D } },
+    { 'R', { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 } },
+    { 'S', { 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E } },
+    { 'T', { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { 'U', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E } },
+    { 'V', { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 } },
+    { 'W', { 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A } },
+    { 'X', { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 } },
+    { 'Y', { 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 } },
+    { 'Z', { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F } },
+    { '.', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C } },
+    { ',', { 0x00, 0x00, 0x00, 0x00, 0x0C, 0x04, 0x08 } },
+    { ':', { 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 } },
+    { '/', { 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 } },
+    { '(', { 0x02, 0x04, 0x08, 0x08, 0x08, 0x04, 0x02 } },
+    { ')', { 0x08, 0x04, 0x02, 0x02, 0x02, 0x04, 0x08 } },
+    { '[', { 0x0E, 0x08, 0x08, 0x08, 0x08, 0x08, 0x0E } },
+    { ']', { 0x0E, 0x02, 0x02, 0x02, 0x02, 0x02, 0x0E } },
+    { '<', { 0x02, 0x04, 0x08, 0x10, 0x08, 0x04, 0x02 } },
+    { '>', { 0x08, 0x04, 0x02, 0x01, 0x02, 0x04, 0x08 } },
+    { '-', { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 } },
+    { '+', { 0x00, 0x04, 0x04, 0x1F, 0x04, 0x04, 0x00 } },
+    { '=', { 0x00, 0x00, 0x1F, 0x00, 0x1F, 0x00, 0x00 } },
+    { '_', { 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x1F } },
+    { '%', { 0x18, 0x19, 0x02, 0x04, 0x08, 0x13, 0x03 } },
+    { '|', { 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 } },
+    { '*', { 0x00, 0x04, 0x15, 0x0E, 0x15, 0x04, 0x00 } },
+};
+static const int hudGlyphCount = sizeof(hudGlyphs) / sizeof(hudGlyphs[0]);
+
+struct HudVertex {
+    float         x, y;             // window pixels, origin top left
+    float         u, v;
+    unsigned char color[4];
+};
+
+struct HudState {
+    bool                   ready = false;
+    bool                   visible = false;
+    GLuint                 program = 0, vao = 0, vbo = 0, ibo = 0, font = 0;
+    GLint                  uViewport = -1, uFont = -1;
+    int                    atlasWidth = 0;
+    signed char            cellOf[128];     // atlas cell per ASCII code, -1 if none
+    std::vector<HudVertex> vertices;
+    int                    viewWidth = 0, viewHeight = 0;   // last viewportSize set
+    RollingWindow<HUD_GRAPH_FRAMES> frameMs;
+    GLuint                 queries[GPU_TIMER_LATENCY];
+    int                    issuedFrame[GPU_TIMER_LATENCY];
+    int                    frame = 0;
+    double                 cpuMs = 0.0;     // last build + submit
+    double                 submitMs = 0.0;  // last upload + draw alone
+    RollingWindow<HUD_GRAPH_FRAMES> cpuWindow, submitWindow;
+    double                 gpuMs = 0.0;     // last resolved
+    std::chrono::steady_clock::time_point buildStart;
+};
+
+static HudState hud;
+
+// Font atlas, buffers and queries; program is the linked vsHud/psHud pair
+static bool Hud_Init(GLuint program) {
+    if (!program) return false;
+    hud.program = program;
+    hud.uViewport = glGetUniformLocation(program, "viewportSize");
+    hud.uFont = glGetUniformLocation(program, "fontTexture");
+    glUseProgram(program);
+    glUniform1i(hud.uFont, 0);
+    glUseProgram(0);
+
+    // Cell 0 solid, then one cell per glyph
+    hud.atlasWidth = (hudGlyphCount + 1) * HUD_CELL;
+    std::vector<unsigned char> atlas((size_t)hud.atlasWidth * HUD_CELL, 0);
+    for (int y = 0; y < HUD_CELL; ++y)
+        for (int x = 0; x < HUD_CELL; ++x) atlas[(size_t)y * hud.atlasWidth + x] = 255;
+    for (int c = 0; c < 128; ++c) hud.cellOf[c] = -1;
+    for (int g = 0; g < hudGlyphCount; ++g) {
+        hud.cellOf[(int)hudGlyphs[g].c] = (signed char)(g + 1);
+        for (int y = 0; y < 7; ++y)
+            for (int x = 0; x < 5; ++x)
+                if (hudGlyphs[g].rows[y] & (0x10 >> x))
+                    atlas[(size_t)y * hud.atlasWidth + (g + 1) * HUD_CELL + x] = 255;
+    }
+    glGenTextures(1, &hud.font);
+    glBindTexture(GL_TEXTURE_2D, hud.font);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, hud.atlasWidth, HUD_CELL, 0, GL_RED, GL_UNSIGNED_BYTE, atlas.data());
+    GpuMem_Track(GPUMEM_TEXTURE, hud.font, GPUMEM_MATERIAL, "hud font", atlas.size());
+    GLDebug_Label(GL_TEXTURE, hud.font, "hud font");
+
+    glGenVertexArrays(1, &hud.vao);
+    glGenBuffers(1, &hud.vbo);
+    glBindVertexArray(hud.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, hud.vbo);
+    size_t bytes = (size_t)GPU_TIMER_LATENCY * HUD_MAX_QUADS * 4 * sizeof(HudVertex);
+    glBufferData(GL_ARRAY_BUFFER, bytes, nullptr, GL_STREAM_DRAW);
+    GpuMem_Track(GPUMEM_BUFFER, hud.vbo, GPUMEM_STAGING, "hud vertices", bytes);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)0);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), (void*)(2 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), (void*)(4 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+
+    // Two triangles per quad, the same for every segment (drawn with a base vertex)
+    std::vector<unsigned short> indices((size_t)HUD_MAX_QUADS * 6);
+    static const int order[6] = { 0, 1, 2, 0, 2, 3 };
+    for (int q = 0; q < HUD_MAX_QUADS; ++q)
+        for (int i = 0; i < 6; ++i) indices[(size_t)q * 6 + i] = (unsigned short)(q * 4 + order[i]);
+    glGenBuffers(1, &hud.ibo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, hud.ibo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned short), indices.data(), GL_STATIC_DRAW);
+    GpuMem_Track(GPUMEM_BUFFER, hud.ibo, GPUMEM_GEOMETRY, "hud indices", indices.size() * sizeof(unsigned short));
+    glBindVertexArray(0);
+    GLDebug_Label(GL_VERTEX_ARRAY, hud.vao, "hud VAO");
+    GLDebug_Label(GL_BUFFER, hud.vbo, "hud VBO");
+    GLDebug_Label(GL_BUFFER, hud.ibo, "hud IBO");
+
+    glGenQueries(GPU_TIMER_LATENCY, hud.queries);
+    for (int i = 0; i < GPU_TIMER_LATENCY; ++i) hud.issuedFrame[i] = -1;
+    hud.vertices.reserve((size_t)HUD_MAX_QUADS * 4);
+    hud.ready = true;
+    return true;
+}
+
+// Wall time of a presented frame, for the graph
+static void Hud_AddFrame(double ms) {
+    hud.frameMs.add(ms);
+}
+
+static void Hud_Quad(float x, float y, float w, float h, int cell, const unsigned char color[4]) {
+    float du = 1.0f / (float)hud.atlasWidth;
+    float u0, v0, u1, v1;
+    if (cell == 0) {
+        u0 = u1 = 4.0f * du;                // centre of the solid cell
+        v0 = v1 = 0.5f;
+    }
+    else {
+        u0 = (float)(cell * HUD_CELL) * du;
+        u1 = u0 + 5.0f * du;
+        v0 = 0.0f;
+        v1 = 7.0f / (float)HUD_CELL;
+    }
+    HudVertex q[4] = {
+        { x,     y,     u0, v0, { color[0], color[1], color[2], color[3] } },
+        { x + w, y,     u1, v0, { color[0], color[1], color[2], color[3] } },
+        { x + w, y + h, u1, v1, { color[0], color[1], color[2], color[3] } },
+        { x,     y + h, u0, v1, { color[0], color[1], color[2], color[3] } },
+    };
+    hud.vertices.insert(hud.vertices.end(), q, q + 4);
+}
+
+// Backdrop behind everything added so far, with a margin of pad pixels
+static void Hud_Backdrop(float pad, unsigned int rgba) {
+    if (hud.vertices.empty()) return;
+    float x0 = 1e30f, y0 = 1e30f, x1 = -1e30f, y1 = -1e30f;
+    for (const HudVertex& v : hud.vertices) {
+        x0 = v.x < x0 ? v.x : x0;
+        y0 = v.y < y0 ? v.y : y0;
+        x1 = v.x > x1 ? v.x : x1;
+        y1 = v.y > y1 ? v.y : y1;
+    }
+    size_t n = hud.vertices.size();
+    unsigned char c[4] = { (unsigned char)(rgba >> 24), (unsigned char)(rgba >> 16),
+                           (unsigned char)(rgba >> 8), (unsigned char)rgba };
+    Hud_Quad(x0 - pad, y0 - pad, x1 - x0 + 2.0f * pad, y1 - y0 + 2.0f * pad, 0, c);
+    std::rotate(hud.vertices.begin(), hud.vertices.begin() + n, hud.vertices.end());    // drawn first
+}
+
+static void Hud_Rect(float x, float y, float w, float h, unsigned int rgba) {
+    unsigned char c[4] = { (unsigned char)(rgba >> 24), (unsigned char)(rgba >> 16),
+                           (unsigned char)(rgba >> 8), (unsigned char)rgba };
+    Hud_Quad(x, y, w, h, 0, c);
+}
+
+// One line of text at (x, y); returns the x after it
+static float Hud_Text(float x, float y, unsigned int rgba, const char* format, ...) {
+    char text[256];
+    va_list args;
+    va_start(args, format);
+    vsnprintf(text, sizeof(text), format, args);
+    va_end(args);
+    unsigned char c[4] = { (unsigned char)(rgba >> 24), (unsigned char)(rgba >> 16),
+                           (unsigned char)(rgba >> 8), (unsigned char)rgba };
+    for (const char* p = text; *p; ++p) {
+        int ch = toupper((unsigned char)*p);
+        int cell = ch < 128 ? hud.cellOf[ch] : -1;
+        if (cell > 0) Hud_Quad(x, y, 5.0f * HUD_SCALE, 7.0f * HUD_SCALE, cell, c);
+        x += 6.0f * HUD_SCALE;
+    }
+    return x;
+}
+
+// Line height of Hud_Text
+static float Hud_LineHeight() {
+    return 9.0f * HUD_SCALE;
+}
+
+// Scrolling frame-time graph, newest frame on the right; returns the number of stutters shown
+static int Hud_Graph(float x, float y, float w, float h) {
+    const RollingWindow<HUD_GRAPH_FRAMES>& f = hud.frameMs;
+    Hud_Rect(x, y, w, h, 0x00000090);
+    if (!f.count) return 0;
+    double median = f.summary().p50;
+    double scale = 33.3;
+    for (int i = 0; i < f.count; ++i) scale = f.samples[i] > scale ? f.samples[i] : scale;
+    // 60 and 30 Hz lines
+    Hud_Rect(x, y + h - (float)(16.7 / scale) * h, w, 1.0f, 0x40FF4080);
+    Hud_Rect(x, y + h - (float)(33.3 / scale) * h, w, 1.0f, 0xFFC04080);
+    float bar = w / (float)HUD_GRAPH_FRAMES;
+    int stutters = 0;
+    for (int i = 0; i < f.count; ++i) {
+        double ms = f.samples[(f.next + HUD_GRAPH_FRAMES - f.count + i) % HUD_GRAPH_FRAMES];
+        float bh = (float)(ms / scale) * h;
+        float bx = x + w - (float)(f.count - i) * bar;
+        bool stutter = f.count >= 8 && ms > HUD_STUTTER_FACTOR * median;
+        Hud_Rect(bx, y + h - bh, bar > 1.0f ? bar - 1.0f : bar, bh, stutter ? 0xFF3030FF : 0x60C0FFD0);
+        if (stutter) {
+            Hud_Rect(bx, y - 4.0f * HUD_SCALE, bar > 2.0f ? bar : 2.0f, 3.0f * HUD_SCALE, 0xFF3030FF);
+            ++stutters;
+        }
+    }
+    return stutters;
+}
+
+// Start a frame of the overlay; harvests the GPU time of an earlier one
+static void Hud_Begin() {
+    hud.buildStart = std::chrono::steady_clock::now();
+    hud.vertices.clear();
+    int slot = hud.frame % GPU_TIMER_LATENCY;
+    if (hud.issuedFrame[slot] >= 0) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(hud.queries[slot], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(hud.queries[slot], GL_QUERY_RESULT, &ns);
+            hud.gpuMs = (double)ns * 1e-6;
+            hud.issuedFrame[slot] = -1;
+        }
+    }
+}
+
+// Upload the batch into this frame's segment and draw it over the whole window in one call
+static void Hud_End(int width, int height) {
+    GL_DEBUG_GROUP("hud");
+    auto submitStart = std::chrono::steady_clock::now();
+    int slot = hud.frame % GPU_TIMER_LATENCY;
+
+    // The slot's query brackets the last draw from its segment: once it has a result the
+    // segment is free to overwrite. GPU_TIMER_LATENCY frames on, it nearly always has.
+    if (hud.issuedFrame[slot] >= 0) {
+        GLuint64 ns = 0;
+        glGetQueryObjectui64v(hud.queries[slot], GL_QUERY_RESULT, &ns);
+        hud.gpuMs = (double)ns * 1e-6;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, hud.queries[slot]);
+    hud.issuedFrame[slot] = hud.frame++;
+
+    GLsizei quads = (GLsizei)std::min(hud.vertices.size() / 4, (size_t)HUD_MAX_QUADS);
+    glBindBuffer(GL_ARRAY_BUFFER, hud.vbo);
+    void* dst = glMapBufferRange(GL_ARRAY_BUFFER, (GLintptr)slot * HUD_MAX_QUADS * 4 * sizeof(HudVertex),
+        quads * 4 * sizeof(HudVertex), GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+    if (dst) {
+        memcpy(dst, hud.vertices.data(), quads * 4 * sizeof(HudVertex));
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    else quads = 0;
+
+    glViewport(0, 0, width, height);
+    glDisable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glUseProgram(hud.program);
+    if (width != hud.viewWidth || height != hud.viewHeight) {
+        glUniform2f(hud.uViewport, (float)width, (float)height);
+        hud.viewWidth = width;
+        hud.viewHeight = height;
+    }
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, hud.font);
+    glBindVertexArray(hud.vao);
+    glDrawElementsBaseVertex(GL_TRIANGLES, quads * 6, GL_UNSIGNED_SHORT, nullptr, slot * HUD_MAX_QUADS * 4);
+    glBindVertexArray(0);
+    glUseProgram(0);
+    glEnable(GL_DEPTH_TEST);
+    glEndQuery(GL_TIME_ELAPSED);
+
+    auto end = std::chrono::steady_clock::now();
+    hud.submitMs = std::chrono::duration<double, std::milli>(end - submitStart).count();
+    hud.cpuMs = std::chrono::duration<double, std::milli>(end - hud.buildStart).count();
+    hud.cpuWindow.add(hud.cpuMs);
+    hud.submitWindow.add(hud.submitMs);
+}
+
+// Median overlay cost over the window, for the run summaries
+static void Hud_Print(FILE* out) {
+    if (!hud.cpuWindow.count) return;
+    fprintf(out, "HUD: cpu %.3f ms (submit %.3f ms), gpu %.3f ms, median of the last %d frames\n",
+        hud.cpuWindow.summary().p50, hud.submitWindow.summary().p50, hud.gpuMs, hud.cpuWindow.count);
+}
+
+static void Hud_Shutdown() {
+    if (!hud.ready) return;
+    glDeleteQueries(GPU_TIMER_LATENCY, hud.queries);
+    GpuMem_Release(GPUMEM_TEXTURE, hud.font);
+    GpuMem_Release(GPUMEM_BUFFER, hud.vbo);
+    GpuMem_Release(GPUMEM_BUFFER, hud.ibo);
+    glDeleteTextures(1, &hud.font);
+    glDeleteBuffers(1, &hud.vbo);
+    glDeleteBuffers(1, &hud.ibo);
+    glDeleteVertexArrays(1, &hud.vao);
+    hud.ready = false;
+}
+
+#endif //__HUD_H__
@@ -0,0 +1,413 @@
+//**************************************************************************************
+// File IMAGE_METRICS.h
+// Image difference metrics for comparing rendered frames. Images are tightly
+// packed 8-bit RGB; an optional coverage mask (non-zero = compare) restricts
+// the metric to the pixels the surface actually covers.
+//
+// All metrics split the image into rows for Parallel_Rows and use SSE2 for the
+// inner loops where it is available (x86-64 always has it):
+//   Image_MSE / Image_PSNR    - squared error, 16 bytes per step
+//   Image_SSIM                - 8x8 windows from 4-wide column sums
+//   Image_PerceptualDiff      - FLIP-style per-pixel error map in [0,1]
+//**************************************************************************************
+#ifndef __IMAGE_METRICS_H__
+#define __IMAGE_METRICS_H__
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <atomic>
+#include <vector>
+#include "PARALLEL.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define IMAGE_METRICS_SSE2 1
+#include <emmintrin.h>
+#else
+#define IMAGE_METRICS_SSE2 0
+#endif
+
+#define IMAGE_METRICS_CHUNK 16384   // pixels per work item of the pixel-wise metrics
+
+// Sum of squared differences of n bytes
+static uint64_t Image_SquaredDiff(const unsigned char* a, const unsigned char* b, size_t n) {
+    uint64_t sum = 0;
+    size_t i = 0;
+#if IMAGE_METRICS_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= n) {
+        // 32-bit lanes gain at most 4 * 255^2 per step: flush well before they overflow
+        __m128i acc = zero;
+        for (int k = 0; k < 4096 && i + 16 <= n; ++k, i += 16) {
+            __m128i va = _mm_loadu_si128((const __m128i*)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i*)(b + i));
+            __m128i dlo = _mm_sub_epi16(_mm_unpacklo_epi8(va, zero), _mm_unpacklo_epi8(vb, zero));
+            __m128i dhi = _mm_sub_epi16(_mm_unpackhi_epi8(va, zero), _mm_unpackhi_epi8(vb, zero));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(dlo, dlo));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(dhi, dhi));
+        }
+        uint32_t lanes[4];
+        _mm_storeu_si128((__m128i*)lanes, acc);
+        sum += (uint64_t)lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    }
+#endif
+    for (; i < n; ++i) {
+        int d = (int)a[i] - (int)b[i];
+        sum += (uint64_t)(d * d);
+    }
+    return sum;
+}
+
+// Mean squared error over RGB channels of the masked pixels
+static double Image_MSE(const unsigned char* a, const unsigned char* b, size_t pixels,
+                        const unsigned char* mask = nullptr) {
+    int chunks = (int)((pixels + IMAGE_METRICS_CHUNK - 1) / IMAGE_METRICS_CHUNK);
+    std::atomic<uint64_t> sum{ 0 }, counted{ 0 };
+    Parallel_Rows(chunks, [&](int c) {
+        size_t p0 = (size_t)c * IMAGE_METRICS_CHUNK;
+        size_t p1 = p0 + IMAGE_METRICS_CHUNK < pixels ? p0 + IMAGE_METRICS_CHUNK : pixels;
+        if (!mask) {
+            sum += Image_SquaredDiff(a + p0 * 3, b + p0 * 3, (p1 - p0) * 3);
+            counted += p1 - p0;
+            return;
+        }
+        // Covered pixels come in runs (scanline spans): one vector loop per run
+        uint64_t s = 0, n = 0;
+        for (size_t i = p0; i < p1; ) {
+            if (!mask[i]) { ++i; continue; }
+            size_t run = i;
+            while (run < p1 && mask[run]) ++run;
+            s += Image_SquaredDiff(a + i * 3, b + i * 3, (run - i) * 3);
+            n += run - i;
+            i = run;
+        }
+        sum += s;
+        counted += n;
+    });
+    return counted ? (double)sum / (double)(counted * 3) : 0.0;
+}
+
+// Peak signal-to-noise ratio in dB; identical images report 99 dB
+static double Image_PSNR(const unsigned char* a, const unsigned char* b, size_t pixels,
+                         const unsigned char* mask = nullptr) {
+    double mse = Image_MSE(a, b, pixels, mask);
+    if (mse <= 1e-10) return 99.0;
+    return 10.0 * log10(255.0 * 255.0 / mse);
+}
+
+// BT.601 luma plane
+static void Image_Luma(const unsigned char* rgb, int width, int height, std::vector<float>& out) {
+    out.resize((size_t)width * height);
+    Parallel_Rows(height, [&](int y) {
+        const unsigned char* p = rgb + (size_t)y * width * 3;
+        float* o = &out[(size_t)y * width];
+        for (int x = 0; x < width; ++x)
+            o[x] = 0.299f * p[x * 3] + 0.587f * p[x * 3 + 1] + 0.114f * p[x * 3 + 2];
+    });
+}
+
+// Structural similarity (Wang et al. 2004) of the BT.601 luma, averaged over 8x8
+// windows placed every 4 pixels; windows touching an unmasked pixel are skipped.
+// 1 means identical, images are width x height.
+static double Image_SSIM(const unsigned char* a, const unsigned char* b, int width, int height,
+                         const unsigned char* mask = nullptr) {
+    const int win = 8, stride = 4;
+    const double c1 = (0.01 * 255.0) * (0.01 * 255.0);
+    const double c2 = (0.03 * 255.0) * (0.03 * 255.0);
+    if (width < win || height < win) return 1.0;
+    std::vector<float> la, lb;
+    Image_Luma(a, width, height, la);
+    Image_Luma(b, width, height, lb);
+
+    int bands = (height - win) / stride + 1;
+    int quads = width / stride;
+    std::vector<double> bandSum(bands, 0.0);
+    std::vector<int> bandWindows(bands, 0);
+    Parallel_Rows(bands, [&](int band) {
+        // Column sums over the band's 8 rows: a, b, a^2, b^2, ab, and coverage
+        int y0 = band * stride;
+        std::vector<float> col(5 * (size_t)width, 0.0f);
+        std::vector<int> cov(width, 1);
+        float* sa = &col[0];
+        float* sb = sa + width;
+        float* saa = sb + width;
+        float* sbb = saa + width;
+        float* sab = sbb + width;
+        for (int y = y0; y < y0 + win; ++y) {
+            const float* ra = &la[(size_t)y * width];
+            const float* rb = &lb[(size_t)y * width];
+            int x = 0;
+#if IMAGE_METRICS_SSE2
+            for (; x + 4 <= width; x += 4) {
+                __m128 va = _mm_loadu_ps(ra + x), vb = _mm_loadu_ps(rb + x);
+                _mm_storeu_ps(sa + x, _mm_add_ps(_mm_loadu_ps(sa + x), va));
+                _mm_storeu_ps(sb + x, _mm_add_ps(_mm_loadu_ps(sb + x), vb));
+                _mm_storeu_ps(saa + x, _mm_add_ps(_mm_loadu_ps(saa + x), _mm_mul_ps(va, va)));
+                _mm_storeu_ps(sbb + x, _mm_add_ps(_mm_loadu_ps(sbb + x), _mm_mul_ps(vb, vb)));
+                _mm_storeu_ps(sab + x, _mm_add_ps(_mm_loadu_ps(sab + x), _mm_mul_ps(va, vb)));
+            }
+#endif
+            for (; x < width; ++x) {
+                sa[x] += ra[x]; sb[x] += rb[x];
+                saa[x] += ra[x] * ra[x]; sbb[x] += rb[x] * rb[x]; sab[x] += ra[x] * rb[x];
+            }
+            if (mask) {
+                const unsigned char* m = mask + (size_t)y * width;
+                for (x = 0; x < width; ++x) if (!m[x]) cov[x] = 0;
+            }
+        }
+
+        // Sums over 4 columns; a window is two neighbouring quads
+        std::vector<double> q(6 * (size_t)quads, 0.0);
+        for (int k = 0; k < quads; ++k) {
+            double* qk = &q[k * 6];
+            for (int x = k * stride; x < k * stride + stride; ++x) {
+                qk[0] += sa[x]; qk[1] += sb[x]; qk[2] += saa[x]; qk[3] += sbb[x]; qk[4] += sab[x];
+                qk[5] += cov[x];
+            }
+        }
+        const double n = win * win;
+        double sum = 0.0;
+        int windows = 0;
+        for (int k = 0; k + 1 < quads; ++k) {
+            const double* p = &q[k * 6];
+            const double* r = p + 6;
+            if (p[5] + r[5] < win) continue;
+            double ma = (p[0] + r[0]) / n, mb = (p[1] + r[1]) / n;
+            double va = (p[2] + r[2]) / n - ma * ma, vb = (p[3] + r[3]) / n - mb * mb;
+            double cv = (p[4] + r[4]) / n - ma * mb;
+            sum += ((2.0 * ma * mb + c1) * (2.0 * cv + c2)) / ((ma * ma + mb * mb + c1) * (va + vb + c2));
+            ++windows;
+        }
+        bandSum[band] = sum;
+        bandWindows[band] = windows;
+    });
+    double sum = 0.0;
+    size_t windows = 0;
+    for (int i = 0; i < bands; ++i) { sum += bandSum[i]; windows += bandWindows[i]; }
+    return windows ? sum / (double)windows : 1.0;
+}
+
+// ---- FLIP-style perceptual difference --------------------------------------------
+// After Andersson et al., "FLIP: A Difference Evaluator for Alternating Images"
+// (2020), simplified: both images go to the opponent space YCxCz, are blurred
+// with a narrow (luma) and a wider (chroma) Gaussian standing in for the
+// contrast sensitivity filters, and compared with the HyAB distance; luma edge
+// and point features (first and second Gaussian derivatives) then sharpen the
+// colour error as e = colour^(1 - feature).
+
+// Gaussian (order 0, sums to 1), first derivative (order 1, each lobe sums to 1)
+// or second derivative (order 2, zero mean, positive lobe sums to 1)
+static std::vector<float> Image_GaussianKernel(float sigma, int order) {
+    int radius = (int)ceilf(3.0f * sigma);
+    std::vector<float> k(2 * radius + 1);
+    float total = 0.0f;
+    for (int i = -radius; i <= radius; ++i) {
+        float g = expf(-0.5f * i * i / (sigma * sigma));
+        float v = order == 0 ? g : order == 1 ? -i * g : (i * i / (sigma * sigma) - 1.0f) * g;
+        k[i + radius] = v;
+        total += v;
+    }
+    if (order == 0) {
+        for (float& v : k) v /= total;
+        return k;
+    }
+    if (order == 2) for (float& v : k) v -= total / k.size();
+    float pos = 0.0f, neg = 0.0f;
+    for (float v : k) { if (v > 0.0f) pos += v; else neg -= v; }
+    for (float& v : k) v /= (v > 0.0f || order == 2) ? pos : neg;
+    return k;
+}
+
+// Separable convolution with edge clamping; the vertical pass runs 4 pixels wide
+static void Image_Convolve(const std::vector<float>& src, std::vector<float>& dst, int width, int height,
+                           const std::vector<float>& kx, const std::vector<float>& ky) {
+    std::vector<float> tmp((size_t)width * height);
+    dst.resize((size_t)width * height);
+    int rx = (int)kx.size() / 2, ry = (int)ky.size() / 2;
+    Parallel_Rows(height, [&](int y) {
+        const float* s = &src[(size_t)y * width];
+        float* t = &tmp[(size_t)y * width];
+        auto clamped = [&](int x) {
+            float v = 0.0f;
+            for (int i = -rx; i <= rx; ++i) {
+                int xi = x + i < 0 ? 0 : (x + i >= width ? width - 1 : x + i);
+                v += kx[i + rx] * s[xi];
+            }
+            return v;
+        };
+        int x = 0;
+        for (; x < rx && x < width; ++x) t[x] = clamped(x);
+#if IMAGE_METRICS_SSE2
+        for (; x + 4 + rx <= width; x += 4) {
+            __m128 v = _mm_setzero_ps();
+            for (int i = -rx; i <= rx; ++i)
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(kx[i + rx]), _mm_loadu_ps(s + x + i)));
+            _mm_storeu_ps(t + x, v);
+        }
+#endif
+        for (; x < width; ++x) t[x] = clamped(x);
+    });
+    Parallel_Rows(height, [&](int y) {
+        float* d = &dst[(size_t)y * width];
+        int x = 0;
+#if IMAGE_METRICS_SSE2
+        for (; x + 4 <= width; x += 4) {
+            __m128 v = _mm_setzero_ps();
+            for (int i = -ry; i <= ry; ++i) {
+                int yi = y + i < 0 ? 0 : (y + i >= height ? height - 1 : y + i);
+                v = _mm_add_ps(v, _mm_mul_ps(_mm_set1_ps(ky[i + ry]), _mm_loadu_ps(&tmp[(size_t)yi * width + x])));
+            }
+            _mm_storeu_ps(d + x, v);
+        }
+#endif
+        for (; x < width; ++x) {
+            float v = 0.0f;
+            for (int i = -ry; i <= ry; ++i) {
+                int yi = y + i < 0 ? 0 : (y + i >= height ? height - 1 : y + i);
+                v += ky[i + ry] * tmp[(size_t)yi * width + x];
+            }
+            d[x] = v;
+        }
+    });
+}
+
+// sRGB 8-bit to YCxCz planes (Y in [-16,100], D65 white)
+static void Image_ToYCxCz(const unsigned char* rgb, int width, int height, std::vector<float> plane[3]) {
+    struct LinearTable {
+        float value[256];
+        LinearTable() {
+            for (int i = 0; i < 256; ++i) {
+                float c = i / 255.0f;
+                value[i] = c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+            }
+        }
+    };
+    static const LinearTable table;     // built once, thread-safe, before any worker reads it
+    const float* linear = table.value;
+    for (int c = 0; c < 3; ++c) plane[c].resize((size_t)width * height);
+    Parallel_Rows(height, [&](int y) {
+        for (int x = 0; x < width; ++x) {
+            size_t i = (size_t)y * width + x;
+            float r = linear[rgb[i * 3]], g = linear[rgb[i * 3 + 1]], b = linear[rgb[i * 3 + 2]];
+            float X = (0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.9505f;
+            float Y = 0.2126f * r + 0.7152f * g + 0.0722f * b;
+            float Z = (0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.0890f;
+            plane[0][i] = 116.0f * Y - 16.0f;
+            plane[1][i] = 500.0f * (X - Y);
+            plane[2][i] = 200.0f * (Y - Z);
+        }
+    });
+}
+
+// Per-pixel perceptual error in [0,1] (0 outside the mask); returns its mean over the mask
+static double Image_PerceptualDiff(const unsigned char* a, const unsigned char* b, int width, int height,
+                                   std::vector<float>& map, const unsigned char* mask = nullptr) {
+    const float sigmaLuma = 0.5f, sigmaChroma = 1.5f, sigmaFeature = 1.0f;
+    std::vector<float> pa[3], pb[3], fa[3], fb[3];
+    Image_ToYCxCz(a, width, height, pa);
+    Image_ToYCxCz(b, width, height, pb);
+    std::vector<float> gLuma = Image_GaussianKernel(sigmaLuma, 0);
+    std::vector<float> gChroma = Image_GaussianKernel(sigmaChroma, 0);
+    for (int c = 0; c < 3; ++c) {
+        const std::vector<float>& g = c ? gChroma : gLuma;
+        Image_Convolve(pa[c], fa[c], width, height, g, g);
+        Image_Convolve(pb[c], fb[c], width, height, g, g);
+    }
+
+    // Luma features on [0,1] luma: edges (first derivative) and points (second)
+    std::vector<float> g0 = Image_GaussianKernel(sigmaFeature, 0);
+    std::vector<float> g1 = Image_GaussianKernel(sigmaFeature, 1);
+    std::vector<float> g2 = Image_GaussianKernel(sigmaFeature, 2);
+    std::vector<float> edge[2], point[2];
+    for (int k = 0; k < 2; ++k) {
+        std::vector<float>& y = k ? pb[0] : pa[0];
+        for (float& v : y) v = (v + 16.0f) / 116.0f;
+        std::vector<float> dx, dy, px, py;
+        Image_Convolve(y, dx, width, height, g1, g0);
+        Image_Convolve(y, dy, width, height, g0, g1);
+        Image_Convolve(y, px, width, height, g2, g0);
+        Image_Convolve(y, py, width, height, g0, g2);
+        edge[k].resize(dx.size());
+        point[k].resize(dx.size());
+        for (size_t i = 0; i < dx.size(); ++i) {
+            edge[k][i] = sqrtf(dx[i] * dx[i] + dy[i] * dy[i]);
+            point[k][i] = sqrtf(px[i] * px[i] + py[i] * py[i]);
+        }
+    }
+
+    // HyAB distance of pure green and pure blue normalizes the colour error
+    const unsigned char greenBlue[6] = { 0, 255, 0, 0, 0, 255 };
+    std::vector<float> gb[3];
+    Image_ToYCxCz(greenBlue, 2, 1, gb);
+    float da = gb[1][0] - gb[1][1], db = gb[2][0] - gb[2][1];
+    float hyabMax = fabsf(gb[0][0] - gb[0][1]) + sqrtf(da * da + db * db);
+
+    map.assign((size_t)width * height, 0.0f);
+    std::vector<double> rowSum(height, 0.0);
+    std::vector<size_t> rowCount(height, 0);
+    Parallel_Rows(height, [&](int y) {
+        for (int x = 0; x < width; ++x) {
+            size_t i = (size_t)y * width + x;
+            if (mask && !mask[i]) continue;
+            float dA = fa[1][i] - fb[1][i], dB = fa[2][i] - fb[2][i];
+            float hyab = fabsf(fa[0][i] - fb[0][i]) + sqrtf(dA * dA + dB * dB);
+            float feature = fmaxf(fabsf(edge[0][i] - edge[1][i]), fabsf(point[0][i] - point[1][i]));
+            feature = sqrtf(fminf(feature * 0.70710678f, 1.0f));
+            // colour = (hyab / hyabMax)^0.7, e = colour^(1 - feature), in one powf
+            float e = hyab > 0.0f ? powf(fminf(hyab / hyabMax, 1.0f), 0.7f * (1.0f - feature)) : 0.0f;
+            map[i] = e;
+            rowSum[y] += e;
+            ++rowCount[y];
+        }
+    });
+    double sum = 0.0;
+    size_t count = 0;
+    for (int y = 0; y < height; ++y) { sum += rowSum[y]; count += rowCount[y]; }
+    return count ? sum / (double)count : 0.0;
+}
+
+// Write an error map as a PPM heat map (black - red - yellow - white)
+static bool Image_WriteHeatmap(const char* path, const std::vector<float>& map, int width, int height, bool bottomUp) {
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    fprintf(f, "P6\n%d %d\n255\n", width, height);
+    std::vector<unsigned char> row((size_t)width * 3);
+    for (int r = 0; r < height; ++r) {
+        int y = bottomUp ? height - 1 - r : r;
+        for (int x = 0; x < width; ++x) {
+            float e = map[(size_t)y * width + x] * 3.0f;
+            row[x * 3 + 0] = (unsigned char)(fminf(e, 1.0f) * 255.0f);
+            row[x * 3 + 1] = (unsigned char)(fminf(fmaxf(e - 1.0f, 0.0f), 1.0f) * 255.0f);
+            row[x * 3 + 2] = (unsigned char)(fminf(fmaxf(e - 2.0f, 0.0f), 1.0f) * 255.0f);
+        }
+        fwrite(row.data(), 1, row.size(), f);
+    }
+    fclose(f);
+    return true;
+}
+
+// Read a binary PPM (P6, maxval 255) into top-down RGB
+static bool Image_ReadPPM(const char* path, std::vector<unsigned char>& rgb, int& width, int& height) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot open '%s'\n", path);
+        return false;
+    }
+    int maxval = 0;
+    bool ok = fscanf(f, "P6 %d %d %d", &width, &height, &maxval) == 3 && maxval == 255 && width > 0 && height > 0;
+    if (ok) {
+        fgetc(f);   // the single whitespace before the pixels
+        rgb.resize((size_t)width * height * 3);
+        ok = fread(rgb.data(), 1, rgb.size(), f) == rgb.size();
+    }
+    fclose(f);
+    if (!ok) fprintf(stderr, "ERROR: '%s' is not an 8-bit binary PPM\n", path);
+    return ok;
+}
+
+#endif //__IMAGE_METRICS_H__
@@ -0,0 +1,152 @@
+//**************************************************************************************
+// File INPUT_LOG.h
+// Binary log of the interactive input (keys, mouse buttons, drags, window
+// size and auto-tuner switches) for reproducible sessions. Every event is
+// stamped with the frame it was applied before and the time since the start
+// of the recording; replay dispatches the events before the same frame
+// indices, so a session plays back frame-exact in the window or headless.
+//
+// Layout: one InputLogHeader (the scene state when recording started), then
+// fixed-size InputEvent records, closed by an INPUT_END event carrying the
+// frame count. Fields are little-endian, as written by x86/ARM hosts.
+//**************************************************************************************
+#ifndef __INPUT_LOG_H__
+#define __INPUT_LOG_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+
+#define INPUT_LOG_VERSION 1
+
+enum InputEventType {
+    INPUT_KEY = 1,      // a = key
+    INPUT_MOUSE,        // a = button, b = state, x/y
+    INPUT_MOTION,       // x/y
+    INPUT_RESHAPE,      // x/y = width/height
+    INPUT_PRESET,       // a = preset chosen by the auto-tuner
+    INPUT_END           // frame = frames recorded
+};
+
+#pragma pack(push, 1)
+struct InputLogHeader {
+    char     magic[4];          // "SPIN"
+    uint16_t version;
+    uint16_t eventSize;
+    int32_t  width;
+    int32_t  height;
+    float    rotate;
+    float    elevate;
+    float    light[3];
+    uint8_t  toggles;           // Bench_Toggles bits: 1 B, 2 S, 4 M, 8 P
+    uint8_t  preset;
+    uint8_t  autoTune;
+    uint8_t  reserved;
+    float    autoTuneMs;
+};
+
+struct InputEvent {
+    uint32_t frame;
+    uint32_t timeUs;
+    uint8_t  type;
+    uint8_t  a;
+    uint8_t  b;
+    uint8_t  reserved;
+    int16_t  x;
+    int16_t  y;
+};
+#pragma pack(pop)
+
+struct InputRecorder {
+    FILE*    file = nullptr;
+    uint32_t events = 0;
+    std::chrono::steady_clock::time_point start;
+};
+
+struct InputReplay {
+    bool                    active = false;
+    InputLogHeader          header;
+    std::vector<InputEvent> events;
+    size_t                  next = 0;
+    uint32_t                frames = 0;
+    uint32_t                durationUs = 0;
+};
+
+static bool Input_BeginRecord(InputRecorder& r, const char* path, InputLogHeader header) {
+    r.file = fopen(path, "wb");
+    if (!r.file) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    memcpy(header.magic, "SPIN", 4);
+    header.version = INPUT_LOG_VERSION;
+    header.eventSize = sizeof(InputEvent);
+    fwrite(&header, sizeof(header), 1, r.file);
+    r.events = 0;
+    r.start = std::chrono::steady_clock::now();
+    return true;
+}
+
+static void Input_Record(InputRecorder& r, uint32_t frame, int type, int a, int b, int x, int y) {
+    if (!r.file) return;
+    InputEvent e = {};
+    e.frame = frame;
+    e.timeUs = (uint32_t)std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - r.start).count();
+    e.type = (uint8_t)type;
+    e.a = (uint8_t)a;
+    e.b = (uint8_t)b;
+    e.x = (int16_t)x;
+    e.y = (int16_t)y;
+    fwrite(&e, sizeof(e), 1, r.file);
+    ++r.events;
+}
+
+static void Input_EndRecord(InputRecorder& r, uint32_t frames) {
+    if (!r.file) return;
+    Input_Record(r, frames, INPUT_END, 0, 0, 0, 0);
+    fclose(r.file);
+    r.file = nullptr;
+    fprintf(stdout, "Recorded %u input events over %u frames\n", r.events - 1, frames);
+}
+
+static bool Input_Load(InputReplay& r, const char* path) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot read '%s'\n", path);
+        return false;
+    }
+    bool ok = fread(&r.header, sizeof(r.header), 1, f) == 1 && !memcmp(r.header.magic, "SPIN", 4);
+    if (!ok || r.header.version != INPUT_LOG_VERSION || r.header.eventSize != sizeof(InputEvent)) {
+        fprintf(stderr, "ERROR: '%s' is not a version %d input log\n", path, INPUT_LOG_VERSION);
+        fclose(f);
+        return false;
+    }
+    r.events.clear();
+    InputEvent e = {};
+    bool ended = false;
+    while (fread(&e, sizeof(e), 1, f) == 1) {
+        if (e.type == INPUT_END) {
+            ended = true;
+            break;
+        }
+        r.events.push_back(e);
+    }
+    fclose(f);
+    // A log cut short (crash, kill) still replays up to its last event
+    r.frames = ended ? e.frame : (r.events.empty() ? 0 : r.events.back().frame + 1);
+    r.durationUs = ended ? e.timeUs : (r.events.empty() ? 0 : r.events.back().timeUs);
+    r.next = 0;
+    r.active = true;
+    return true;
+}
+
+// Next event due before frame, or null once they are all dispatched
+static const InputEvent* Input_Next(InputReplay& r, uint32_t frame) {
+    if (r.next < r.events.size() && r.events[r.next].frame <= frame) return &r.events[r.next++];
+    return nullptr;
+}
+
+#endif //__INPUT_LOG_H__
@@ -0,0 +1,45 @@
+//**************************************************************************************
+// File JSON.h
+// Helpers shared by the hand-written JSON reports. Every string that comes
+// from outside the code (file names, GL renderer strings, labels, names
+// given on the command line) goes through Json_Escape() before it is put
+// between quotes. Json_WriteStats() writes a StatSummary the same way in
+// every report.
+//**************************************************************************************
+#ifndef __JSON_H__
+#define __JSON_H__
+
+#include <stdio.h>
+#include <string>
+#include "STATS.h"
+
+// s with quotes, backslashes and control characters escaped, without the enclosing quotes
+static std::string Json_Escape(const char* s) {
+    std::string out;
+    if (!s) return out;
+    for (; *s; ++s) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        }
+        else if (c == '\n') out += "\\n";
+        else if (c == '\r') out += "\\r";
+        else if (c == '\t') out += "\\t";
+        else if (c < 0x20) {
+            char buf[8];
+            snprintf(buf, sizeof(buf), "\\u%04x", c);
+            out += buf;
+        }
+        else out += (char)c;
+    }
+    return out;
+}
+
+// "key":{count, min, avg, sd, percentiles, max} of a StatSummary, no separator around it
+static void Json_WriteStats(FILE* f, const char* key, const StatSummary& s) {
+    fprintf(f, "\"%s\":{\"count\":%d,\"min\":%.4f,\"avg\":%.4f,\"sd\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"p99\":%.4f,\"max\":%.4f}",
+        key, s.count, s.min, s.avg, s.stddev, s.p50, s.p95, s.p99, s.max);
+}
+
+#endif //__JSON_H__
@@ -0,0 +1,395 @@
+//**************************************************************************************
+// File MESH.h
+// Triangle meshes for the parallax shaders: an OBJ loader (v/vt/vn/f, polygons
+// as fans, negative indices) that welds the face corners into indexed vertices
+// through a hash table, fills in smooth normals when the file has none and
+// builds a tangent frame per vertex.
+//
+// Tangents follow MikkTSpace's rules: per corner, the triangle's dP/du is
+// projected into the tangent plane of the vertex normal and weighted by the
+// corner angle; corners sharing a vertex are averaged only with corners of
+// the same handedness, and a vertex used with both is split. w is the sign of
+// the bitangent, B = w * cross(N, T), as vsParallax.glsl rebuilds it. The
+// per-triangle and per-vertex work runs on all hardware threads (PARALLEL.h).
+//
+// Vertices are interleaved position(3) uv(2) normal(3) tangent(4), the layout
+// of the built-in quad and of CpuRef_Render.
+//**************************************************************************************
+#ifndef __MESH_H__
+#define __MESH_H__
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#include "PARALLEL.h"
+
+#define MESH_STRIDE 12      // floats per vertex
+
+struct Mesh {
+    std::vector<float>    vertices;     // MESH_STRIDE floats per vertex
+    std::vector<unsigned> indices;      // triangles
+};
+
+struct MeshLoadStats {
+    double parseMs = 0.0;
+    double weldMs = 0.0;
+    double normalMs = 0.0;      // 0 when the file has normals
+    double tangentMs = 0.0;
+    size_t positions = 0;
+    size_t triangles = 0;
+    size_t welded = 0;          // unique position/uv/normal corners
+    size_t vertices = 0;        // after the handedness split
+};
+
+// One face corner: indices into the position, uv and normal lists (-1 = none)
+struct MeshCorner {
+    int p, t, n;
+};
+
+static double Mesh_Ms(std::chrono::steady_clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - since).count();
+}
+
+// Index of "v/vt/vn" element; OBJ counts from 1, negatives from the end
+static int Mesh_ObjIndex(const char*& s, size_t count) {
+    char* end;
+    long i = strtol(s, &end, 10);
+    if (end == s) return -1;
+    s = end;
+    return i > 0 ? (int)(i - 1) : i < 0 ? (int)((long)count + i) : -1;
+}
+
+static bool Mesh_ParseObj(const char* path, std::vector<float>& pos, std::vector<float>& uv, std::vector<float>& nrm,
+                          std::vector<MeshCorner>& corners) {
+    FILE* f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot open mesh '%s'\n", path);
+        return false;
+    }
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    std::vector<char> text((size_t)size + 1);
+    size_t got = fread(text.data(), 1, (size_t)size, f);
+    fclose(f);
+    text[got] = 0;
+
+    std::vector<MeshCorner> face;
+    char* end;
+    for (char* line = text.data(); *line; ) {
+        char* next = strchr(line, '\n');
+        if (next) *next = 0;
+        const char* s = line;
+        while (*s == ' ' || *s == '\t') ++s;
+        if (s[0] == 'v' && (s[1] == ' ' || s[1] == '\t')) {
+            s += 2;
+            for (int k = 0; k < 3; ++k, s = end) pos.push_back(strtof(s, &end));
+        }
+        else if (s[0] == 'v' && s[1] == 't') {
+            s += 2;
+            for (int k = 0; k < 2; ++k, s = end) uv.push_back(strtof(s, &end));
+        }
+        else if (s[0] == 'v' && s[1] == 'n') {
+            s += 2;
+            for (int k = 0; k < 3; ++k, s = end) nrm.push_back(strtof(s, &end));
+        }
+        else if (s[0] == 'f' && (s[1] == ' ' || s[1] == '\t')) {
+            s += 2;
+            face.clear();
+            for (;;) {
+                while (*s == ' ' || *s == '\t' || *s == '\r') ++s;
+                MeshCorner c = { Mesh_ObjIndex(s, pos.size() / 3), -1, -1 };
+                if (c.p < 0) break;
+                if (*s == '/') {
+                    ++s;
+                    if (*s != '/') c.t = Mesh_ObjIndex(s, uv.size() / 2);
+                    if (*s == '/') {
+                        ++s;
+                        c.n = Mesh_ObjIndex(s, nrm.size() / 3);
+                    }
+                }
+                if (c.p >= (int)(pos.size() / 3) || c.t >= (int)(uv.size() / 2) || c.n >= (int)(nrm.size() / 3)) {
+                    fprintf(stderr, "ERROR: '%s': face index out of range\n", path);
+                    return false;
+                }
+                face.push_back(c);
+            }
+            for (size_t k = 1; k + 1 < face.size(); ++k) {
+                corners.push_back(face[0]);
+                corners.push_back(face[k]);
+                corners.push_back(face[k + 1]);
+            }
+        }
+        if (!next) break;
+        line = next + 1;
+    }
+    return true;
+}
+
+// Weld equal corners: open-addressing hash of (p, t, n); returns the unique corners
+// and, per input corner, its index among them
+static void Mesh_Weld(const std::vector<MeshCorner>& corners, std::vector<MeshCorner>& unique,
+                      std::vector<unsigned>& remap) {
+    size_t capacity = 16;
+    while (capacity < corners.size() * 2) capacity <<= 1;
+    std::vector<int> table(capacity, -1);
+    unique.clear();
+    remap.resize(corners.size());
+    for (size_t i = 0; i < corners.size(); ++i) {
+        const MeshCorner& c = corners[i];
+        unsigned long long h = ((unsigned long long)(unsigned)c.p * 0x9E3779B97F4A7C15ull) ^
+                               ((unsigned long long)(unsigned)c.t * 0xC2B2AE3D27D4EB4Full) ^
+                               ((unsigned long long)(unsigned)c.n * 0x165667B19E3779F9ull);
+        size_t slot = (size_t)(h ^ (h >> 29)) & (capacity - 1);
+        for (;; slot = (slot + 1) & (capacity - 1)) {
+            int u = table[slot];
+            if (u < 0) {
+                table[slot] = (int)unique.size();
+                remap[i] = (unsigned)unique.size();
+                unique.push_back(c);
+                break;
+            }
+            if (unique[u].p == c.p && unique[u].t == c.t && unique[u].n == c.n) {
+                remap[i] = (unsigned)u;
+                break;
+            }
+        }
+    }
+}
+
+// Area-weighted face normals summed per position, for files without vn
+static void Mesh_SmoothNormals(const std::vector<float>& pos, std::vector<MeshCorner>& corners, std::vector<float>& nrm) {
+    nrm.assign(pos.size(), 0.0f);
+    for (size_t c = 0; c + 2 < corners.size(); c += 3) {
+        const float* a = &pos[(size_t)corners[c].p * 3];
+        const float* b = &pos[(size_t)corners[c + 1].p * 3];
+        const float* d = &pos[(size_t)corners[c + 2].p * 3];
+        float e1[3] = { b[0] - a[0], b[1] - a[1], b[2] - a[2] };
+        float e2[3] = { d[0] - a[0], d[1] - a[1], d[2] - a[2] };
+        float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+        for (int k = 0; k < 3; ++k)
+            for (int j = 0; j < 3; ++j) nrm[(size_t)corners[c + k].p * 3 + j] += n[j];
+    }
+    for (MeshCorner& c : corners) c.n = c.p;
+}
+
+static inline void Mesh_Normalize3(float* v) {
+    float l = sqrtf(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]);
+    if (l > 0.0f) { v[0] /= l; v[1] /= l; v[2] /= l; }
+}
+
+// Any unit vector perpendicular to n, for corners without a usable uv gradient
+static void Mesh_AnyTangent(const float* n, float* t) {
+    float a[3] = { fabsf(n[0]) < 0.9f ? 1.0f : 0.0f, fabsf(n[0]) < 0.9f ? 0.0f : 1.0f, 0.0f };
+    float d = a[0] * n[0] + a[1] * n[1];
+    for (int k = 0; k < 3; ++k) t[k] = a[k] - d * n[k];
+    Mesh_Normalize3(t);
+}
+
+// Tangent frames for welded vertices (vertex data already holds position, uv, normal).
+// chunks: parallel work items, 1 runs on the calling thread only. Vertices used with
+// both handednesses are split; indices are rewritten to the final vertices.
+static void Mesh_BuildTangents(std::vector<float>& vertices, std::vector<unsigned>& indices, int chunks) {
+    size_t vertexCount = vertices.size() / MESH_STRIDE;
+    size_t cornerCount = indices.size();
+    size_t triCount = cornerCount / 3;
+    if (chunks < 1) chunks = 1;
+
+    // Per corner: projected, angle-weighted dP/du and the handedness of the triangle
+    std::vector<float> cornerT(cornerCount * 3, 0.0f);
+    std::vector<unsigned char> cornerOdd(cornerCount, 0);
+    Parallel_Rows(chunks, [&](int chunk) {
+        size_t begin = triCount * chunk / chunks, end = triCount * (chunk + 1) / chunks;
+        for (size_t tri = begin; tri < end; ++tri) {
+            const float* v[3];
+            for (int k = 0; k < 3; ++k) v[k] = &vertices[(size_t)indices[tri * 3 + k] * MESH_STRIDE];
+            float e1[3], e2[3];
+            for (int j = 0; j < 3; ++j) { e1[j] = v[1][j] - v[0][j]; e2[j] = v[2][j] - v[0][j]; }
+            float du1 = v[1][3] - v[0][3], dv1 = v[1][4] - v[0][4];
+            float du2 = v[2][3] - v[0][3], dv2 = v[2][4] - v[0][4];
+            float r = du1 * dv2 - du2 * dv1;
+            if (fabsf(r) < 1e-20f) continue;    // no uv gradient: zero weight
+            float T[3], B[3];
+            for (int j = 0; j < 3; ++j) {
+                T[j] = (e1[j] * dv2 - e2[j] * dv1) / r;
+                B[j] = (e2[j] * du1 - e1[j] * du2) / r;
+            }
+            for (int k = 0; k < 3; ++k) {
+                const float* n = v[k] + 5;
+                float d = T[0] * n[0] + T[1] * n[1] + T[2] * n[2];
+                float t[3] = { T[0] - d * n[0], T[1] - d * n[1], T[2] - d * n[2] };
+                Mesh_Normalize3(t);
+                float nxt[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+                bool odd = nxt[0] * B[0] + nxt[1] * B[1] + nxt[2] * B[2] < 0.0f;
+
+                // Weight: the triangle's angle at this corner
+                const float* a = v[(k + 1) % 3];
+                const float* b = v[(k + 2) % 3];
+                float ea[3] = { a[0] - v[k][0], a[1] - v[k][1], a[2] - v[k][2] };
+                float eb[3] = { b[0] - v[k][0], b[1] - v[k][1], b[2] - v[k][2] };
+                Mesh_Normalize3(ea);
+                Mesh_Normalize3(eb);
+                float c = ea[0] * eb[0] + ea[1] * eb[1] + ea[2] * eb[2];
+                float angle = acosf(c < -1.0f ? -1.0f : c > 1.0f ? 1.0f : c);
+                size_t corner = tri * 3 + k;
+                for (int j = 0; j < 3; ++j) cornerT[corner * 3 + j] = t[j] * angle;
+                cornerOdd[corner] = odd ? 1 : 0;
+            }
+        }
+    });
+
+    // Corners of each vertex (counting sort), then per-vertex sums by handedness
+    std::vector<unsigned> first(vertexCount + 1, 0), byVertex(cornerCount);
+    for (unsigned i : indices) ++first[i + 1];
+    for (size_t v = 0; v < vertexCount; ++v) first[v + 1] += first[v];
+    {
+        std::vector<unsigned> fill(first.begin(), first.end() - 1);
+        for (size_t c = 0; c < cornerCount; ++c) byVertex[fill[indices[c]]++] = (unsigned)c;
+    }
+    std::vector<float> sum(vertexCount * 6, 0.0f);     // [even xyz, odd xyz]
+    std::vector<unsigned char> used(vertexCount, 0);  // bit 0 even, bit 1 odd
+    Parallel_Rows(chunks, [&](int chunk) {
+        size_t begin = vertexCount * chunk / chunks, end = vertexCount * (chunk + 1) / chunks;
+        for (size_t v = begin; v < end; ++v)
+            for (unsigned k = first[v]; k < first[v + 1]; ++k) {
+                unsigned c = byVertex[k];
+                int side = cornerOdd[c];
+                for (int j = 0; j < 3; ++j) sum[v * 6 + side * 3 + j] += cornerT[(size_t)c * 3 + j];
+                used[v] |= (unsigned char)(1 << side);
+            }
+    });
+
+    // Final vertices: one per (vertex, handedness) in use; the odd copy of a vertex
+    // used both ways is appended
+    std::vector<unsigned> oddCopy(vertexCount, 0);
+    size_t outCount = vertexCount;
+    for (size_t v = 0; v < vertexCount; ++v)
+        if (used[v] == 3) oddCopy[v] = (unsigned)outCount++;
+    vertices.resize(outCount * MESH_STRIDE);
+    for (size_t v = 0; v < vertexCount; ++v)
+        if (used[v] == 3) memcpy(&vertices[(size_t)oddCopy[v] * MESH_STRIDE], &vertices[v * MESH_STRIDE], 8 * sizeof(float));
+    Parallel_Rows(chunks, [&](int chunk) {
+        size_t begin = vertexCount * chunk / chunks, end = vertexCount * (chunk + 1) / chunks;
+        for (size_t v = begin; v < end; ++v)
+            for (int side = 0; side < 2; ++side) {
+                if (side == 1 && !(used[v] & 2)) continue;
+                if (side == 0 && (used[v] & 2) && !(used[v] & 1)) continue;   // odd only: written below
+                size_t out = side == 1 && used[v] == 3 ? oddCopy[v] : v;
+                float* dst = &vertices[out * MESH_STRIDE];
+                float t[3] = { sum[v * 6 + side * 3], sum[v * 6 + side * 3 + 1], sum[v * 6 + side * 3 + 2] };
+                if (t[0] * t[0] + t[1] * t[1] + t[2] * t[2] < 1e-24f) Mesh_AnyTangent(dst + 5, t);
+                else Mesh_Normalize3(t);
+                dst[8] = t[0];
+                dst[9] = t[1];
+                dst[10] = t[2];
+                dst[11] = side ? -1.0f : 1.0f;
+            }
+    });
+    for (size_t c = 0; c < cornerCount; ++c)
+        if (cornerOdd[c] && used[indices[c]] == 3) indices[c] = oddCopy[indices[c]];
+}
+
+// Load an OBJ into indexed vertices with normals and tangents; chunks as for Mesh_BuildTangents
+static bool Mesh_LoadObj(const char* path, Mesh& mesh, MeshLoadStats* stats = nullptr, int chunks = 64) {
+    MeshLoadStats local;
+    MeshLoadStats& st = stats ? *stats : local;
+    std::vector<float> pos, uv, nrm;
+    std::vector<MeshCorner> corners;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!Mesh_ParseObj(path, pos, uv, nrm, corners)) return false;
+    st.parseMs = Mesh_Ms(t0);
+    if (corners.empty()) {
+        fprintf(stderr, "ERROR: '%s' has no faces\n", path);
+        return false;
+    }
+    for (const MeshCorner& c : corners)
+        if (c.t < 0) {
+            fprintf(stderr, "ERROR: '%s' has faces without texture coordinates\n", path);
+            return false;
+        }
+    st.normalMs = 0.0;
+    bool needNormals = false;
+    for (const MeshCorner& c : corners) needNormals = needNormals || c.n < 0;
+    if (needNormals) {
+        t0 = std::chrono::steady_clock::now();
+        Mesh_SmoothNormals(pos, corners, nrm);
+        st.normalMs = Mesh_Ms(t0);
+    }
+
+    t0 = std::chrono::steady_clock::now();
+    std::vector<MeshCorner> unique;
+    Mesh_Weld(corners, unique, mesh.indices);
+    mesh.vertices.assign(unique.size() * MESH_STRIDE, 0.0f);
+    for (size_t i = 0; i < unique.size(); ++i) {
+        float* v = &mesh.vertices[i * MESH_STRIDE];
+        memcpy(v, &pos[(size_t)unique[i].p * 3], 3 * sizeof(float));
+        memcpy(v + 3, &uv[(size_t)unique[i].t * 2], 2 * sizeof(float));
+        memcpy(v + 5, &nrm[(size_t)unique[i].n * 3], 3 * sizeof(float));
+        Mesh_Normalize3(v + 5);
+    }
+    st.weldMs = Mesh_Ms(t0);
+
+    t0 = std::chrono::steady_clock::now();
+    Mesh_BuildTangents(mesh.vertices, mesh.indices, chunks);
+    st.tangentMs = Mesh_Ms(t0);
+    st.positions = pos.size() / 3;
+    st.triangles = mesh.indices.size() / 3;
+    st.welded = unique.size();
+    st.vertices = mesh.vertices.size() / MESH_STRIDE;
+    return true;
+}
+
+// Center the mesh on the origin and scale it into a sphere of the given radius
+static void Mesh_Fit(Mesh& mesh, float radius) {
+    size_t n = mesh.vertices.size() / MESH_STRIDE;
+    if (!n) return;
+    float lo[3] = { 1e30f, 1e30f, 1e30f }, hi[3] = { -1e30f, -1e30f, -1e30f };
+    for (size_t i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k) {
+            float x = mesh.vertices[i * MESH_STRIDE + k];
+            lo[k] = x < lo[k] ? x : lo[k];
+            hi[k] = x > hi[k] ? x : hi[k];
+        }
+    float c[3] = { 0.5f * (lo[0] + hi[0]), 0.5f * (lo[1] + hi[1]), 0.5f * (lo[2] + hi[2]) };
+    float r2 = 0.0f;
+    for (size_t i = 0; i < n; ++i) {
+        float* p = &mesh.vertices[i * MESH_STRIDE];
+        float d = (p[0] - c[0]) * (p[0] - c[0]) + (p[1] - c[1]) * (p[1] - c[1]) + (p[2] - c[2]) * (p[2] - c[2]);
+        r2 = d > r2 ? d : r2;
+    }
+    float s = r2 > 0.0f ? radius / sqrtf(r2) : 1.0f;
+    for (size_t i = 0; i < n; ++i)
+        for (int k = 0; k < 3; ++k) mesh.vertices[i * MESH_STRIDE + k] = (mesh.vertices[i * MESH_STRIDE + k] - c[k]) * s;
+}
+
+// A torus of about `triangles` triangles as OBJ text, uvs tiled 8x2, for load benchmarks
+static bool Mesh_WriteTorusObj(const char* path, size_t triangles) {
+    int ring = (int)sqrt((double)triangles / 4.0);
+    if (ring < 3) ring = 3;
+    int major = 2 * ring, minor = ring;
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    const float R = 4.0f, r = 1.5f;
+    for (int i = 0; i <= major; ++i)
+        for (int j = 0; j <= minor; ++j) {
+            float a = 6.2831853f * i / major, b = 6.2831853f * j / minor;
+            fprintf(f, "v %.6f %.6f %.6f\nvt %.6f %.6f\nvn %.6f %.6f %.6f\n",
+                (R + r * cosf(b)) * cosf(a), (R + r * cosf(b)) * sinf(a), r * sinf(b),
+                8.0f * i / major, 2.0f * j / minor, cosf(b) * cosf(a), cosf(b) * sinf(a), sinf(b));
+        }
+    for (int i = 0; i < major; ++i)
+        for (int j = 0; j < minor; ++j) {
+            int a = i * (minor + 1) + j + 1, b = (i + 1) * (minor + 1) + j + 1;
+            fprintf(f, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, b + 1, b + 1, b + 1, a + 1, a + 1, a + 1);
+        }
+    fclose(f);
+    return true;
+}
+
+#endif //__MESH_H__
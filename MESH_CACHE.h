@@ -0,0 +1,287 @@
+//**************************************************************************************
+// File MESH_CACHE.h
+// Binary mesh cache: a converted OBJ that loads by mapping the file and
+// handing its buffers straight to glBufferData, with no parsing, welding or
+// tangent generation at startup.
+//
+// The converter (MeshCache_Write) takes a loaded, fitted mesh, reorders its
+// triangles for the post-transform cache and for overdraw (MESH_OPT.h; any
+// MeshOrder), renumbers the vertices in first-use order and quantizes them to
+// 20 bytes (48 as floats):
+//   position  3 x int16 + pad    object position = q * positionScale
+//   uv        2 x uint16         uv = q * uvScaleBias.xy + uvScaleBias.zw
+//   normal    2_10_10_10 snorm
+//   tangent   2_10_10_10 snorm   w (2 bits) = bitangent sign
+// Positions and uvs are plain integers scaled in vsParallax.glsl, which is
+// exact under both of GL's snorm conversion rules; indices are 16 bits when
+// the vertices fit. Little-endian, as every target of this demo.
+//
+// The CPU reference needs floats: MeshCache_Decode() expands the mapped
+// vertices the same way the vertex shader does, only when a reference
+// render asks for them.
+//**************************************************************************************
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__
+
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "MESH.h"
+#include "MESH_OPT.h"
+
+#define MESH_CACHE_MAGIC   "SPMC"
+#define MESH_CACHE_VERSION 1
+
+struct MeshCacheHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    uint32_t indexSize;         // 2 or 4 bytes
+    uint32_t vertexOffset;      // from the start of the file, 16-byte aligned
+    uint32_t indexOffset;
+    float    positionScale;
+    float    uvScaleBias[4];
+    float    acmr;              // of the stored order, MESH_ACMR_FIFO entries
+    uint32_t reserved[3];
+};
+
+struct MeshCacheVertex {
+    int16_t  position[4];       // w unused
+    uint16_t uv[2];
+    uint32_t normal;            // GL_INT_2_10_10_10_REV
+    uint32_t tangent;
+};
+
+// A mapped cache file; the pointers are into the mapping
+struct MeshCache {
+    const unsigned char*   data = nullptr;
+    size_t                 size = 0;
+    const MeshCacheHeader* header = nullptr;
+    const MeshCacheVertex* vertices = nullptr;
+    const void*            indices = nullptr;
+#ifdef _WIN32
+    HANDLE                 file = INVALID_HANDLE_VALUE;
+    HANDLE                 mapping = NULL;
+#endif
+};
+
+struct MeshCacheStats {
+    double optimizeMs = 0.0;
+    double acmrBefore = 0.0;
+    double acmrAfter = 0.0;
+    size_t bytes = 0;
+};
+
+static inline float MeshCache_Clamp1(float x) {
+    return x < -1.0f ? -1.0f : x > 1.0f ? 1.0f : x;
+}
+
+// Three snorm10 components and the sign of w in two bits
+static uint32_t MeshCache_Pack1010102(const float* v, float w) {
+    uint32_t r = 0;
+    for (int k = 0; k < 3; ++k) r |= ((uint32_t)(int)lrintf(MeshCache_Clamp1(v[k]) * 511.0f) & 1023u) << (10 * k);
+    return r | ((uint32_t)(w < 0.0f ? -1 : 1) & 3u) << 30;
+}
+
+static void MeshCache_Unpack1010102(uint32_t r, float* v) {
+    for (int k = 0; k < 3; ++k) {
+        int q = (int)(r << (22 - 10 * k)) >> 22;
+        v[k] = q < -511 ? -1.0f : (float)q / 511.0f;
+    }
+    v[3] = (int)r >> 30 < 0 ? -1.0f : 1.0f;
+}
+
+// Reorder, quantize and write a mesh (positions already fitted)
+static bool MeshCache_Write(const char* path, const Mesh& source, MeshOrder order = MESH_ORDER_OVERDRAW,
+                            MeshCacheStats* stats = nullptr) {
+    MeshCacheStats local;
+    MeshCacheStats& st = stats ? *stats : local;
+    Mesh mesh = source;
+    size_t vertexCount = mesh.vertices.size() / MESH_STRIDE;
+    auto t0 = std::chrono::steady_clock::now();
+    st.acmrBefore = Mesh_ACMR(mesh.indices, vertexCount);
+    Mesh_Order(mesh, order);
+    vertexCount = mesh.vertices.size() / MESH_STRIDE;
+    st.acmrAfter = Mesh_ACMR(mesh.indices, vertexCount);
+    st.optimizeMs = Mesh_Ms(t0);
+
+    MeshCacheHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, MESH_CACHE_MAGIC, 4);
+    h.version = MESH_CACHE_VERSION;
+    h.vertexCount = (uint32_t)vertexCount;
+    h.indexCount = (uint32_t)mesh.indices.size();
+    h.indexSize = vertexCount <= 65536 ? 2 : 4;
+    h.vertexOffset = (uint32_t)((sizeof(MeshCacheHeader) + 15) & ~(size_t)15);
+    h.indexOffset = (uint32_t)((h.vertexOffset + vertexCount * sizeof(MeshCacheVertex) + 15) & ~(size_t)15);
+    h.acmr = (float)st.acmrAfter;
+
+    // One scale for all axes keeps object space similar to the float mesh
+    float extent = 0.0f, lo[2] = { 1e30f, 1e30f }, hi[2] = { -1e30f, -1e30f };
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* v = &mesh.vertices[i * MESH_STRIDE];
+        for (int k = 0; k < 3; ++k) extent = fabsf(v[k]) > extent ? fabsf(v[k]) : extent;
+        for (int k = 0; k < 2; ++k) {
+            lo[k] = v[3 + k] < lo[k] ? v[3 + k] : lo[k];
+            hi[k] = v[3 + k] > hi[k] ? v[3 + k] : hi[k];
+        }
+    }
+    h.positionScale = extent > 0.0f ? extent / 32767.0f : 1.0f;
+    for (int k = 0; k < 2; ++k) {
+        h.uvScaleBias[k] = hi[k] > lo[k] ? (hi[k] - lo[k]) / 65535.0f : 1.0f;
+        h.uvScaleBias[2 + k] = lo[k];
+    }
+
+    std::vector<unsigned char> file(h.indexOffset + (size_t)h.indexCount * h.indexSize, 0);
+    memcpy(file.data(), &h, sizeof(h));
+    MeshCacheVertex* out = (MeshCacheVertex*)(file.data() + h.vertexOffset);
+    for (size_t i = 0; i < vertexCount; ++i) {
+        const float* v = &mesh.vertices[i * MESH_STRIDE];
+        for (int k = 0; k < 3; ++k) out[i].position[k] = (int16_t)lrintf(v[k] / h.positionScale);
+        for (int k = 0; k < 2; ++k) {
+            float q = (v[3 + k] - h.uvScaleBias[2 + k]) / h.uvScaleBias[k];
+            out[i].uv[k] = (uint16_t)(q < 0.0f ? 0 : q > 65535.0f ? 65535 : lrintf(q));
+        }
+        out[i].normal = MeshCache_Pack1010102(v + 5, 1.0f);
+        out[i].tangent = MeshCache_Pack1010102(v + 8, v[11]);
+    }
+    for (size_t i = 0; i < mesh.indices.size(); ++i) {
+        if (h.indexSize == 2) ((uint16_t*)(file.data() + h.indexOffset))[i] = (uint16_t)mesh.indices[i];
+        else ((uint32_t*)(file.data() + h.indexOffset))[i] = mesh.indices[i];
+    }
+
+    FILE* f = fopen(path, "wb");
+    if (!f || fwrite(file.data(), 1, file.size(), f) != file.size()) {
+        fprintf(stderr, "ERROR: cannot write mesh cache '%s'\n", path);
+        if (f) fclose(f);
+        return false;
+    }
+    fclose(f);
+    st.bytes = file.size();
+    return true;
+}
+
+// Does the file start with the cache magic?
+static bool MeshCache_Is(const char* path) {
+    char magic[4] = { 0 };
+    FILE* f = fopen(path, "rb");
+    if (!f) return false;
+    bool is = fread(magic, 1, 4, f) == 4 && !memcmp(magic, MESH_CACHE_MAGIC, 4);
+    fclose(f);
+    return is;
+}
+
+static void MeshCache_Close(MeshCache& cache) {
+#ifdef _WIN32
+    if (cache.data) UnmapViewOfFile(cache.data);
+    if (cache.mapping) CloseHandle(cache.mapping);
+    if (cache.file != INVALID_HANDLE_VALUE) CloseHandle(cache.file);
+    cache.file = INVALID_HANDLE_VALUE;
+    cache.mapping = NULL;
+#else
+    if (cache.data) munmap((void*)cache.data, cache.size);
+#endif
+    cache.data = nullptr;
+    cache.size = 0;
+    cache.header = nullptr;
+    cache.vertices = nullptr;
+    cache.indices = nullptr;
+}
+
+// Map a cache file read-only and check its header against the file size
+static bool MeshCache_Open(const char* path, MeshCache& cache) {
+    MeshCache_Close(cache);
+#ifdef _WIN32
+    cache.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    LARGE_INTEGER size;
+    if (cache.file == INVALID_HANDLE_VALUE || !GetFileSizeEx(cache.file, &size)) {
+        fprintf(stderr, "ERROR: cannot open mesh cache '%s'\n", path);
+        MeshCache_Close(cache);
+        return false;
+    }
+    cache.size = (size_t)size.QuadPart;
+    cache.mapping = cache.size ? CreateFileMappingA(cache.file, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    cache.data = cache.mapping ? (const unsigned char*)MapViewOfFile(cache.mapping, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat sb;
+    if (fd < 0 || fstat(fd, &sb) != 0) {
+        fprintf(stderr, "ERROR: cannot open mesh cache '%s'\n", path);
+        if (fd >= 0) close(fd);
+        return false;
+    }
+    cache.size = (size_t)sb.st_size;
+    void* p = cache.size ? mmap(nullptr, cache.size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    close(fd);
+    cache.data = p != MAP_FAILED ? (const unsigned char*)p : nullptr;
+#endif
+    if (!cache.data) {
+        fprintf(stderr, "ERROR: cannot map mesh cache '%s'\n", path);
+        MeshCache_Close(cache);
+        return false;
+    }
+
+    const MeshCacheHeader* h = (const MeshCacheHeader*)cache.data;
+    bool valid = cache.size >= sizeof(MeshCacheHeader) && !memcmp(h->magic, MESH_CACHE_MAGIC, 4) &&
+                 (h->indexSize == 2 || h->indexSize == 4) && h->indexCount % 3 == 0 && h->indexCount > 0 &&
+                 h->vertexOffset % 16 == 0 && h->indexOffset % 16 == 0 && h->vertexOffset >= sizeof(MeshCacheHeader) &&
+                 (size_t)h->vertexOffset + (size_t)h->vertexCount * sizeof(MeshCacheVertex) <= h->indexOffset &&
+                 (size_t)h->indexOffset + (size_t)h->indexCount * h->indexSize <= cache.size;
+    if (!valid || h->version != MESH_CACHE_VERSION) {
+        fprintf(stderr, valid ? "ERROR: '%s' is a mesh cache of version %u, expected %u; convert it again\n"
+                              : "ERROR: '%s' is not a valid mesh cache\n", path, valid ? h->version : 0, MESH_CACHE_VERSION);
+        MeshCache_Close(cache);
+        return false;
+    }
+    // An index past the vertices would read outside the buffer on the GPU
+    unsigned maxIndex = 0;
+    const unsigned char* idx = cache.data + h->indexOffset;
+    for (size_t i = 0; i < h->indexCount; ++i) {
+        unsigned v = h->indexSize == 2 ? ((const uint16_t*)idx)[i] : ((const uint32_t*)idx)[i];
+        maxIndex = v > maxIndex ? v : maxIndex;
+    }
+    if (maxIndex >= h->vertexCount) {
+        fprintf(stderr, "ERROR: '%s': index %u out of range (%u vertices)\n", path, maxIndex, h->vertexCount);
+        MeshCache_Close(cache);
+        return false;
+    }
+    cache.header = h;
+    cache.vertices = (const MeshCacheVertex*)(cache.data + h->vertexOffset);
+    cache.indices = cache.data + h->indexOffset;
+    return true;
+}
+
+// Float vertices and 32-bit indices of a mapped cache, as vsParallax.glsl sees them
+static void MeshCache_Decode(const MeshCache& cache, Mesh& mesh) {
+    const MeshCacheHeader& h = *cache.header;
+    mesh.vertices.resize((size_t)h.vertexCount * MESH_STRIDE);
+    mesh.indices.resize(h.indexCount);
+    for (size_t i = 0; i < h.vertexCount; ++i) {
+        const MeshCacheVertex& q = cache.vertices[i];
+        float* v = &mesh.vertices[i * MESH_STRIDE];
+        for (int k = 0; k < 3; ++k) v[k] = (float)q.position[k] * h.positionScale;
+        for (int k = 0; k < 2; ++k) v[3 + k] = (float)q.uv[k] * h.uvScaleBias[k] + h.uvScaleBias[2 + k];
+        float n[4];
+        MeshCache_Unpack1010102(q.normal, n);
+        memcpy(v + 5, n, 3 * sizeof(float));
+        MeshCache_Unpack1010102(q.tangent, v + 8);
+    }
+    for (size_t i = 0; i < h.indexCount; ++i) {
+        mesh.indices[i] = h.indexSize == 2 ? ((const uint16_t*)cache.indices)[i] : ((const uint32_t*)cache.indices)[i];
+    }
+}
+
+#endif //__MESH_CACHE_H__
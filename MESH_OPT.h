@@ -0,0 +1,367 @@
+//**************************************************************************************
+// File MESH_OPT.h
+// Offline mesh optimization for the GPU's post-transform vertex cache:
+// Forsyth's linear-speed triangle reordering (LRU cache model), vertex
+// reordering by first use so fetches walk the vertex buffer forward, and the
+// ACMR (average cache miss ratio: vertices transformed per triangle) of an
+// index order on a FIFO cache, the usual hardware model.
+//
+// For overdraw, which costs far more than vertices under psSteepParallax,
+// Mesh_OptimizeOverdraw follows Sander, Nehab & Barczak, "Fast Triangle
+// Reordering for Vertex Locality and Reduced Overdraw" (2007): Tipsify orders
+// the triangles for a FIFO cache, the order is cut into clusters where
+// Tipsify jumps (hard boundaries) and where a cluster's own ACMR has come
+// down to lambda (soft boundaries), and the clusters are drawn outward-facing
+// first: by dot(cluster centroid - mesh centroid, cluster normal), largest
+// first. Those tend to be in front from most directions, so with the depth
+// test the fragments behind them are rejected before shading. No view is
+// assumed; the order is computed once, offline.
+//**************************************************************************************
+#ifndef __MESH_OPT_H__
+#define __MESH_OPT_H__
+
+#include <math.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "JSON.h"
+#include "MESH.h"
+#include "STATS.h"
+
+#define MESH_OPT_CACHE 32       // LRU entries Forsyth optimizes for
+#define MESH_ACMR_FIFO 16       // FIFO entries of the ACMR report and of Tipsify
+#define MESH_OVERDRAW_LAMBDA 1.05   // soft cluster boundary: cluster ACMR <= this x Tipsify's
+
+enum MeshOrder {
+    MESH_ORDER_NONE = 0,        // as loaded
+    MESH_ORDER_FORSYTH,
+    MESH_ORDER_TIPSIFY,
+    MESH_ORDER_OVERDRAW,        // Tipsify, then clusters sorted for overdraw
+    MESH_ORDER_COUNT
+};
+
+static const char* meshOrderNames[MESH_ORDER_COUNT] = { "none", "forsyth", "tipsify", "overdraw" };
+
+// Vertices transformed per triangle with a FIFO post-transform cache of cacheSize
+static double Mesh_ACMR(const std::vector<unsigned>& indices, size_t vertexCount, int cacheSize = MESH_ACMR_FIFO) {
+    if (indices.size() < 3) return 0.0;
+    std::vector<size_t> stamp(vertexCount, 0);  // miss counter when the vertex entered the cache, 0 = never
+    size_t misses = 0;
+    for (unsigned v : indices) {
+        if (stamp[v] && misses - stamp[v] < (size_t)cacheSize) continue;
+        ++misses;
+        stamp[v] = misses;
+    }
+    return (double)misses / (double)(indices.size() / 3);
+}
+
+// Forsyth's vertex score: recent cache positions score high (the last triangle's
+// three vertices a little less), and vertices with few triangles left get a boost
+static float Mesh_ForsythScore(int cachePos, int remaining) {
+    if (remaining == 0) return -1.0f;
+    float score = 0.0f;
+    if (cachePos >= 0) {
+        if (cachePos < 3) score = 0.75f;
+        else score = powf(1.0f - (float)(cachePos - 3) / (float)(MESH_OPT_CACHE - 3), 1.5f);
+    }
+    return score + 2.0f * powf((float)remaining, -0.5f);
+}
+
+// Reorder the triangles for vertex cache reuse (Forsyth, "Linear-Speed Vertex Cache Optimisation")
+static void Mesh_OptimizeForsyth(std::vector<unsigned>& indices, size_t vertexCount) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+
+    // Triangles of each vertex
+    std::vector<unsigned> first(vertexCount + 1, 0), triOf(indices.size());
+    for (unsigned v : indices) ++first[v + 1];
+    for (size_t v = 0; v < vertexCount; ++v) first[v + 1] += first[v];
+    std::vector<unsigned> remaining(vertexCount), fill(first.begin(), first.end() - 1);
+    for (size_t c = 0; c < indices.size(); ++c) triOf[fill[indices[c]]++] = (unsigned)(c / 3);
+    for (size_t v = 0; v < vertexCount; ++v) remaining[v] = first[v + 1] - first[v];
+
+    std::vector<int>   cachePos(vertexCount, -1);
+    std::vector<float> vertexScore(vertexCount);
+    for (size_t v = 0; v < vertexCount; ++v) vertexScore[v] = Mesh_ForsythScore(-1, (int)remaining[v]);
+    std::vector<float> triScore(triCount);
+    std::vector<unsigned char> emitted(triCount, 0);
+    for (size_t t = 0; t < triCount; ++t)
+        triScore[t] = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+
+    std::vector<unsigned> out;
+    out.reserve(indices.size());
+    int cache[MESH_OPT_CACHE + 3];
+    int cacheCount = 0;
+    size_t scan = 0;            // lowest triangle that may still be unemitted
+    long best = -1;
+    for (size_t t = 0; t < triCount; ++t)
+        if (best < 0 || triScore[t] > triScore[best]) best = (long)t;
+
+    while (best >= 0) {
+        emitted[best] = 1;
+        unsigned tv[3] = { indices[best * 3], indices[best * 3 + 1], indices[best * 3 + 2] };
+        out.insert(out.end(), tv, tv + 3);
+
+        // Drop the triangle from its vertices' lists
+        for (unsigned v : tv) {
+            unsigned* list = &triOf[first[v]];
+            for (unsigned k = 0; k < remaining[v]; ++k)
+                if (list[k] == (unsigned)best) {
+                    list[k] = list[remaining[v] - 1];
+                    break;
+                }
+            --remaining[v];
+        }
+
+        // Move the vertices to the front of the LRU cache
+        int next[MESH_OPT_CACHE + 3];
+        int n = 0;
+        for (unsigned v : tv) next[n++] = (int)v;
+        for (int k = 0; k < cacheCount; ++k)
+            if (cache[k] != (int)tv[0] && cache[k] != (int)tv[1] && cache[k] != (int)tv[2]) next[n++] = cache[k];
+        for (int k = 0; k < n; ++k) cachePos[next[k]] = k < MESH_OPT_CACHE ? k : -1;
+        cacheCount = n < MESH_OPT_CACHE ? n : MESH_OPT_CACHE;
+        memcpy(cache, next, sizeof(int) * cacheCount);
+
+        // Rescore what the cache touched and pick the best triangle among them
+        for (int k = 0; k < n; ++k) {
+            int v = next[k];
+            vertexScore[v] = Mesh_ForsythScore(cachePos[v], (int)remaining[v]);
+        }
+        best = -1;
+        float bestScore = -1.0f;
+        for (int k = 0; k < cacheCount; ++k) {
+            int v = cache[k];
+            for (unsigned j = 0; j < remaining[v]; ++j) {
+                unsigned t = triOf[first[v] + j];
+                float s = vertexScore[indices[t * 3]] + vertexScore[indices[t * 3 + 1]] + vertexScore[indices[t * 3 + 2]];
+                triScore[t] = s;
+                if (s > bestScore) {
+                    bestScore = s;
+                    best = (long)t;
+                }
+            }
+        }
+        // Nothing in the cache: continue with the next unemitted triangle in order
+        if (best < 0) {
+            while (scan < triCount && emitted[scan]) ++scan;
+            if (scan < triCount) best = (long)scan;
+        }
+    }
+    indices.swap(out);
+}
+
+// Tipsify (Sander et al. 2007) for a FIFO cache of cacheSize. If hardBounds is given,
+// it receives the first triangle (in the new order) after each jump out of the cache.
+static void Mesh_OptimizeTipsify(std::vector<unsigned>& indices, size_t vertexCount, int cacheSize = MESH_ACMR_FIFO,
+                                 std::vector<size_t>* hardBounds = nullptr) {
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+    std::vector<unsigned> first(vertexCount + 1, 0), triOf(indices.size());
+    for (unsigned v : indices) ++first[v + 1];
+    for (size_t v = 0; v < vertexCount; ++v) first[v + 1] += first[v];
+    std::vector<unsigned> live(vertexCount), fill(first.begin(), first.end() - 1);
+    for (size_t c = 0; c < indices.size(); ++c) triOf[fill[indices[c]]++] = (unsigned)(c / 3);
+    for (size_t v = 0; v < vertexCount; ++v) live[v] = first[v + 1] - first[v];
+
+    std::vector<long long> stamp(vertexCount, -(long long)cacheSize - 1);    // time the vertex entered the cache
+    std::vector<unsigned char> emitted(triCount, 0);
+    std::vector<unsigned> deadEnd, candidates, out;
+    out.reserve(indices.size());
+    if (hardBounds) hardBounds->clear();
+    long long time = cacheSize + 1;
+    size_t cursor = 0;
+    long f = 0;
+    while (f >= 0) {
+        if (hardBounds && time - stamp[f] > cacheSize) hardBounds->push_back(out.size() / 3);
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned k = first[f]; k < first[f + 1]; ++k) {
+            unsigned t = triOf[k];
+            if (emitted[t]) continue;
+            emitted[t] = 1;
+            for (int j = 0; j < 3; ++j) {
+                unsigned v = indices[t * 3 + j];
+                out.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                --live[v];
+                if (time - stamp[v] > cacheSize) stamp[v] = time++;
+            }
+        }
+        // Next: the candidate still in cache after its remaining fan is emitted, oldest
+        // first; else the most recent dead end; else the next vertex in input order
+        f = -1;
+        long long best = -1;
+        for (unsigned v : candidates) {
+            if (!live[v]) continue;
+            long long p = time - stamp[v] + 2 * (long long)live[v] <= cacheSize ? time - stamp[v] : 0;
+            if (p > best) {
+                best = p;
+                f = (long)v;
+            }
+        }
+        while (f < 0 && !deadEnd.empty()) {
+            unsigned d = deadEnd.back();
+            deadEnd.pop_back();
+            if (live[d]) f = (long)d;
+        }
+        for (; f < 0 && cursor < vertexCount; ++cursor)
+            if (live[cursor]) f = (long)cursor;
+    }
+    indices.swap(out);
+}
+
+// Tipsify, then clusters (hard boundaries, plus soft ones where a cluster's ACMR on a cold
+// cache has come down to lambda x Tipsify's) drawn outward-facing first
+static void Mesh_OptimizeOverdraw(Mesh& mesh, int cacheSize = MESH_ACMR_FIFO, double lambda = MESH_OVERDRAW_LAMBDA) {
+    size_t vertexCount = mesh.vertices.size() / MESH_STRIDE;
+    std::vector<unsigned>& indices = mesh.indices;
+    std::vector<size_t> hard;
+    Mesh_OptimizeTipsify(indices, vertexCount, cacheSize, &hard);
+    size_t triCount = indices.size() / 3;
+    if (triCount == 0) return;
+    double limit = lambda * Mesh_ACMR(indices, vertexCount, cacheSize);
+
+    // Cut into clusters
+    std::vector<size_t> bounds;
+    std::vector<size_t> stamp(vertexCount, 0);
+    size_t misses = 0, clusterMisses = 0, clusterStart = 0, nextHard = 0;
+    for (size_t t = 0; t < triCount; ++t) {
+        while (nextHard < hard.size() && hard[nextHard] < t) ++nextHard;
+        bool isHard = nextHard < hard.size() && hard[nextHard] == t;
+        bool isSoft = t > clusterStart && (double)clusterMisses <= limit * (double)(t - clusterStart);
+        if (t == 0 || isHard || isSoft) {
+            bounds.push_back(t);
+            clusterStart = t;
+            clusterMisses = 0;
+            misses += cacheSize;        // cold cache for the new cluster
+        }
+        for (int j = 0; j < 3; ++j) {
+            unsigned v = indices[t * 3 + j];
+            if (stamp[v] && misses - stamp[v] < (size_t)cacheSize) continue;
+            ++misses;
+            ++clusterMisses;
+            stamp[v] = misses;
+        }
+    }
+    bounds.push_back(triCount);
+
+    // Area-weighted centroid and normal per cluster, and the mesh centroid
+    size_t clusterCount = bounds.size() - 1;
+    std::vector<double> centroid(clusterCount * 3, 0.0), normal(clusterCount * 3, 0.0), area(clusterCount, 0.0);
+    double meshCentroid[3] = { 0.0, 0.0, 0.0 }, meshArea = 0.0;
+    for (size_t c = 0; c < clusterCount; ++c)
+        for (size_t t = bounds[c]; t < bounds[c + 1]; ++t) {
+            const float* p[3];
+            for (int j = 0; j < 3; ++j) p[j] = &mesh.vertices[(size_t)indices[t * 3 + j] * MESH_STRIDE];
+            double e1[3], e2[3];
+            for (int k = 0; k < 3; ++k) { e1[k] = p[1][k] - p[0][k]; e2[k] = p[2][k] - p[0][k]; }
+            double n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+            double a = 0.5 * sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            for (int k = 0; k < 3; ++k) {
+                double mid = (p[0][k] + p[1][k] + p[2][k]) / 3.0;
+                centroid[c * 3 + k] += mid * a;
+                normal[c * 3 + k] += n[k];
+                meshCentroid[k] += mid * a;
+            }
+            area[c] += a;
+            meshArea += a;
+        }
+    for (int k = 0; k < 3; ++k) meshCentroid[k] /= meshArea > 0.0 ? meshArea : 1.0;
+    std::vector<double> key(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) {
+        double d = 0.0;
+        for (int k = 0; k < 3; ++k)
+            d += (centroid[c * 3 + k] / (area[c] > 0.0 ? area[c] : 1.0) - meshCentroid[k]) * normal[c * 3 + k];
+        double len = sqrt(normal[c * 3] * normal[c * 3] + normal[c * 3 + 1] * normal[c * 3 + 1] + normal[c * 3 + 2] * normal[c * 3 + 2]);
+        key[c] = len > 0.0 ? d / len : 0.0;
+    }
+    std::vector<size_t> order(clusterCount);
+    for (size_t c = 0; c < clusterCount; ++c) order[c] = c;
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) { return key[a] > key[b]; });
+    std::vector<unsigned> out;
+    out.reserve(indices.size());
+    for (size_t c : order) out.insert(out.end(), indices.begin() + bounds[c] * 3, indices.begin() + bounds[c + 1] * 3);
+    indices.swap(out);
+}
+
+// Renumber the vertices in order of first use so vertex fetches stream forward
+static void Mesh_ReorderVertices(Mesh& mesh) {
+    size_t vertexCount = mesh.vertices.size() / MESH_STRIDE;
+    std::vector<unsigned> remap(vertexCount, ~0u);
+    std::vector<float> vertices(mesh.vertices.size());
+    unsigned next = 0;
+    for (unsigned& i : mesh.indices) {
+        if (remap[i] == ~0u) {
+            memcpy(&vertices[(size_t)next * MESH_STRIDE], &mesh.vertices[(size_t)i * MESH_STRIDE], MESH_STRIDE * sizeof(float));
+            remap[i] = next++;
+        }
+        i = remap[i];
+    }
+    vertices.resize((size_t)next * MESH_STRIDE);    // unreferenced vertices are dropped
+    mesh.vertices.swap(vertices);
+}
+
+// Reorder a mesh's triangles, and for any order but NONE its vertices by first use
+static void Mesh_Order(Mesh& mesh, MeshOrder order) {
+    size_t vertexCount = mesh.vertices.size() / MESH_STRIDE;
+    if (order == MESH_ORDER_NONE) return;
+    if (order == MESH_ORDER_FORSYTH) Mesh_OptimizeForsyth(mesh.indices, vertexCount);
+    if (order == MESH_ORDER_TIPSIFY) Mesh_OptimizeTipsify(mesh.indices, vertexCount);
+    if (order == MESH_ORDER_OVERDRAW) Mesh_OptimizeOverdraw(mesh);
+    Mesh_ReorderVertices(mesh);
+}
+
+static bool Mesh_ParseOrder(const char* name, MeshOrder& order) {
+    for (int k = 0; k < MESH_ORDER_COUNT; ++k)
+        if (!strcmp(name, meshOrderNames[k])) {
+            order = (MeshOrder)k;
+            return true;
+        }
+    fprintf(stderr, "ERROR: unknown mesh order '%s' (none, forsyth, tipsify, overdraw)\n", name);
+    return false;
+}
+
+// One index order of the --mesh-order-report: cache figures and what the GPU measured
+struct MeshOrderResult {
+    MeshOrder   order;
+    double      optimizeMs = 0.0;
+    double      acmr[2] = { 0.0, 0.0 };     // FIFO of MESH_ACMR_FIFO and of 32 entries
+    double      atvr = 0.0;                 // transformed vertices per vertex (MESH_ACMR_FIFO)
+    StatSummary frameMs;
+    StatSummary parallaxMs;
+    StatSummary steepMs;
+    std::string counters;                   // PipeStats_Json members
+};
+
+static bool Mesh_WriteOrderJson(const char* path, const char* mesh, const char* renderer, int views, int framesPerView,
+                                size_t triangles, size_t vertices, const std::vector<MeshOrderResult>& results) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    fprintf(f, "{\n  \"mesh\": \"%s\",\n  \"renderer\": \"%s\",\n  \"triangles\": %zu,\n  \"vertices\": %zu,\n"
+               "  \"views\": %d,\n  \"frames_per_view\": %d,\n  \"orders\": [\n",
+        Json_Escape(mesh).c_str(), Json_Escape(renderer).c_str(), triangles, vertices, views, framesPerView);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const MeshOrderResult& r = results[i];
+        fprintf(f, "    {\"order\":\"%s\",\"optimize_ms\":%.1f,\"acmr_fifo%d\":%.4f,\"acmr_fifo32\":%.4f,\"atvr\":%.4f,\n     ",
+            meshOrderNames[r.order], r.optimizeMs, MESH_ACMR_FIFO, r.acmr[0], r.acmr[1], r.atvr);
+        Json_WriteStats(f, "frame_ms", r.frameMs);
+        fprintf(f, ",\n     ");
+        Json_WriteStats(f, "parallax_gpu_ms", r.parallaxMs);
+        fprintf(f, ",\n     ");
+        Json_WriteStats(f, "steep_gpu_ms", r.steepMs);
+        if (!r.counters.empty()) fprintf(f, ",\n     %s", r.counters.c_str());
+        fprintf(f, "}%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return true;
+}
+
+#endif //__MESH_OPT_H__
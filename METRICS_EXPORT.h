@@ -0,0 +1,316 @@
+//**************************************************************************************
+// File METRICS_EXPORT.h
+// Prometheus text-format metrics for long soak runs: frame-time and per-pass
+// GPU-time quantiles, GPU memory by category, frame and dropped-frame
+// counters. An exporter thread rewrites a file every interval (written to a
+// temporary and renamed, as the node_exporter textfile collector expects)
+// and/or answers HTTP scrapes on a local Unix socket.
+//
+// The render thread only ever try_locks: Metrics_Frame() keeps its own rolling
+// windows and copies them into the shared snapshot at most every
+// METRICS_PUBLISH_MS, skipping the copy when the exporter holds the lock. All
+// formatting, sorting and I/O happens on the exporter thread.
+//**************************************************************************************
+#ifndef __METRICS_EXPORT_H__
+#define __METRICS_EXPORT_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+#include "GPU_MEMORY.h"
+#include "GPU_TIMER.h"
+#include "PROFILER.h"
+#include "STATS.h"
+
+#define METRICS_WINDOW     600      // frames in the frame-time quantiles
+#define METRICS_PUBLISH_MS 100      // at most this often the render thread copies its state
+#define METRICS_DROP_FACTOR 2.0     // a frame over this times the window median counts as dropped
+
+// Everything the exporter reports; the render thread fills it, the exporter copies it out
+struct MetricsSnapshot {
+    RollingWindow<METRICS_WINDOW>   frameMs;
+    RollingWindow<GPU_TIMER_WINDOW> passMs[PASS_COUNT];
+    double        passMsSum[PASS_COUNT] = {};         // every resolved sample since start
+    unsigned long long passCount[PASS_COUNT] = {};
+    size_t        memBytes[GPUMEM_CATEGORY_COUNT];
+    size_t        memBudget = 0;
+    unsigned long long frames = 0;
+    double        frameMsSum = 0.0;
+    unsigned long long dropped = 0;
+    int           gpuTimerDropped = 0;
+    char          preset[16] = "";
+    double        uptimeS = 0.0;
+};
+
+struct MetricsExporter {
+    bool                    active = false;
+    std::string             filePath;
+    std::string             socketPath;
+    double                  intervalS = 10.0;
+    std::thread             thread;
+    std::mutex              lock;           // guards shared
+    std::condition_variable wake;
+    std::atomic<bool>       stop{ false };
+    MetricsSnapshot         shared;
+    MetricsSnapshot         local;          // render thread only
+    std::chrono::steady_clock::time_point start, lastPublish;
+    double                  medianMs = 0.0; // render thread: median for the drop rule, refreshed on publish
+    int                     listenFd = -1;
+    int                     published = 0, skipped = 0, scrapes = 0, writes = 0;
+};
+
+static MetricsExporter metrics;
+
+// Quantiles of a window; sum and count are totals since start, as Prometheus expects of a summary
+static void Metrics_Summary(std::string& out, const char* name, const char* labels, const StatSummary& s,
+                            double sumMs, unsigned long long count) {
+    char buf[512];
+    const double q[3] = { 0.5, 0.95, 0.99 };
+    const double v[3] = { s.p50, s.p95, s.p99 };
+    for (int i = 0; i < 3; ++i) {
+        snprintf(buf, sizeof(buf), "%s{%s%squantile=\"%g\"} %.6f\n", name, labels, *labels ? "," : "", q[i], v[i] * 1e-3);
+        out += buf;
+    }
+    char braced[256] = "";
+    if (*labels && snprintf(braced, sizeof(braced), "{%s}", labels) >= (int)sizeof(braced)) return;
+    snprintf(buf, sizeof(buf), "%s_sum%s %.6f\n%s_count%s %llu\n", name, braced, sumMs * 1e-3, name, braced, count);
+    out += buf;
+}
+
+// Prometheus text exposition of a snapshot
+static std::string Metrics_Format(const MetricsSnapshot& m) {
+    std::string out;
+    char buf[1024];
+    StatSummary frame = m.frameMs.summary();
+    out += "# HELP steepparallax_frame_time_seconds Wall time between presented frames (quantiles of the recent window)\n"
+           "# TYPE steepparallax_frame_time_seconds summary\n";
+    Metrics_Summary(out, "steepparallax_frame_time_seconds", "", frame, m.frameMsSum, m.frames);
+
+    out += "# HELP steepparallax_gpu_pass_seconds GPU time of a pass (quantiles of the recent window, sum and count since start)\n"
+           "# TYPE steepparallax_gpu_pass_seconds summary\n";
+    for (int k = 0; k < PASS_COUNT; ++k) {
+        StatSummary s = m.passMs[k].summary();
+        snprintf(buf, sizeof(buf), "pass=\"%s\"", gpuPasses[k].name);
+        Metrics_Summary(out, "steepparallax_gpu_pass_seconds", buf, s, m.passMsSum[k], m.passCount[k]);
+    }
+
+    out += "# HELP steepparallax_gpu_memory_bytes Tracked GPU allocations by category\n"
+           "# TYPE steepparallax_gpu_memory_bytes gauge\n";
+    for (int c = 0; c < GPUMEM_CATEGORY_COUNT; ++c) {
+        snprintf(buf, sizeof(buf), "steepparallax_gpu_memory_bytes{category=\"%s\"} %zu\n", gpuMemCategoryNames[c], m.memBytes[c]);
+        out += buf;
+    }
+    snprintf(buf, sizeof(buf),
+        "# HELP steepparallax_gpu_memory_budget_bytes Budget set with --gpu-budget (0 = none)\n"
+        "# TYPE steepparallax_gpu_memory_budget_bytes gauge\n"
+        "steepparallax_gpu_memory_budget_bytes %zu\n", m.memBudget);
+    out += buf;
+
+    snprintf(buf, sizeof(buf),
+        "# HELP steepparallax_frames_total Frames presented\n"
+        "# TYPE steepparallax_frames_total counter\n"
+        "steepparallax_frames_total %llu\n"
+        "# HELP steepparallax_dropped_frames_total Frames over %.0fx the recent median frame time\n"
+        "# TYPE steepparallax_dropped_frames_total counter\n"
+        "steepparallax_dropped_frames_total %llu\n", m.frames, METRICS_DROP_FACTOR, m.dropped);
+    out += buf;
+    snprintf(buf, sizeof(buf),
+        "# HELP steepparallax_gpu_timer_dropped_total GPU timer samples not ready in time\n"
+        "# TYPE steepparallax_gpu_timer_dropped_total counter\n"
+        "steepparallax_gpu_timer_dropped_total %d\n"
+        "# HELP steepparallax_preset_info Active steep-parallax preset\n"
+        "# TYPE steepparallax_preset_info gauge\n"
+        "steepparallax_preset_info{preset=\"%s\"} 1\n"
+        "# HELP steepparallax_uptime_seconds Time since the exporter started\n"
+        "# TYPE steepparallax_uptime_seconds gauge\n"
+        "steepparallax_uptime_seconds %.1f\n", m.gpuTimerDropped, m.preset, m.uptimeS);
+    out += buf;
+    return out;
+}
+
+static bool Metrics_WriteFile(const std::string& path, const std::string& text) {
+    std::string tmp = path + ".tmp";
+    FILE* f = fopen(tmp.c_str(), "w");
+    if (!f) return false;
+    bool ok = fwrite(text.data(), 1, text.size(), f) == text.size();
+    ok = fclose(f) == 0 && ok;
+    if (!ok) return false;
+#ifdef _WIN32
+    remove(path.c_str());       // rename does not replace on Windows
+#endif
+    return rename(tmp.c_str(), path.c_str()) == 0;
+}
+
+#ifndef _WIN32
+#ifdef MSG_NOSIGNAL
+#define METRICS_SEND_FLAGS MSG_NOSIGNAL     // a client gone early is an EPIPE, not a SIGPIPE
+#else
+#define METRICS_SEND_FLAGS 0                // macOS: SO_NOSIGPIPE is set on each accepted socket
+#endif
+
+// Answer one scrape: the request is read (and ignored) briefly, any path gets the metrics
+static void Metrics_Serve(int fd, const std::string& text) {
+#ifdef SO_NOSIGPIPE
+    int one = 1;
+    setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &one, sizeof(one));
+#endif
+    char request[1024];
+    struct pollfd p = { fd, POLLIN, 0 };
+    if (poll(&p, 1, 100) > 0) (void)read(fd, request, sizeof(request));
+    char header[160];
+    int n = snprintf(header, sizeof(header), "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\n"
+                                             "Content-Length: %zu\r\n\r\n", text.size());
+    if (send(fd, header, n, METRICS_SEND_FLAGS) == n) (void)send(fd, text.data(), text.size(), METRICS_SEND_FLAGS);
+    close(fd);
+}
+#endif
+
+static void Metrics_Loop() {
+    Profiler_SetThreadName("metrics exporter");
+    auto nextWrite = std::chrono::steady_clock::now();
+    MetricsSnapshot copy;
+    while (!metrics.stop.load()) {
+        auto now = std::chrono::steady_clock::now();
+        bool writeDue = !metrics.filePath.empty() && now >= nextWrite;
+        bool scrape = false;
+#ifndef _WIN32
+        if (metrics.listenFd >= 0) {
+            struct pollfd p = { metrics.listenFd, POLLIN, 0 };
+            scrape = poll(&p, 1, 200) > 0;
+        }
+#endif
+        if (!writeDue && !scrape) {
+            if (metrics.listenFd < 0) {
+                std::unique_lock<std::mutex> guard(metrics.lock);
+                metrics.wake.wait_until(guard, nextWrite, [] { return metrics.stop.load(); });
+            }
+            continue;
+        }
+        {
+            std::lock_guard<std::mutex> guard(metrics.lock);
+            copy = metrics.shared;
+        }
+        std::string text = Metrics_Format(copy);
+        if (writeDue) {
+            if (Metrics_WriteFile(metrics.filePath, text)) ++metrics.writes;
+            else fprintf(stderr, "WARNING: cannot write metrics to '%s'\n", metrics.filePath.c_str());
+            nextWrite = now + std::chrono::milliseconds((long long)(metrics.intervalS * 1000.0));
+        }
+#ifndef _WIN32
+        if (scrape) {
+            int fd = accept(metrics.listenFd, nullptr, nullptr);
+            if (fd >= 0) {
+                Metrics_Serve(fd, text);
+                ++metrics.scrapes;
+            }
+        }
+#endif
+    }
+}
+
+// Start the exporter; either path may be null. intervalS: seconds between file rewrites
+static bool Metrics_Start(const char* filePath, const char* socketPath, double intervalS) {
+    if (!filePath && !socketPath) return false;
+    metrics.filePath = filePath ? filePath : "";
+    metrics.socketPath = socketPath ? socketPath : "";
+    metrics.intervalS = intervalS > 0.1 ? intervalS : 0.1;
+    metrics.start = metrics.lastPublish = std::chrono::steady_clock::now();
+    if (socketPath) {
+#ifdef _WIN32
+        fprintf(stderr, "WARNING: --metrics-socket needs a Unix socket, use --metrics-file\n");
+        metrics.socketPath.clear();
+#else
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        if (strlen(socketPath) >= sizeof(addr.sun_path)) {
+            fprintf(stderr, "ERROR: socket path '%s' is too long\n", socketPath);
+            return false;
+        }
+        strcpy(addr.sun_path, socketPath);
+        unlink(socketPath);
+        metrics.listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (metrics.listenFd < 0 || bind(metrics.listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 ||
+            listen(metrics.listenFd, 4) != 0) {
+            fprintf(stderr, "ERROR: cannot listen on '%s'\n", socketPath);
+            if (metrics.listenFd >= 0) close(metrics.listenFd);
+            metrics.listenFd = -1;
+            return false;
+        }
+#endif
+    }
+    metrics.stop = false;
+    metrics.thread = std::thread(Metrics_Loop);
+    metrics.active = true;
+    return true;
+}
+
+// Render thread, once per presented frame: never waits on the exporter
+static void Metrics_Frame(double frameMs, const char* preset) {
+    if (!metrics.active) return;
+    MetricsSnapshot& m = metrics.local;
+    ++m.frames;
+    m.frameMsSum += frameMs;
+    if (m.frameMs.count >= 8 && frameMs > METRICS_DROP_FACTOR * metrics.medianMs) ++m.dropped;
+    m.frameMs.add(frameMs);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now - metrics.lastPublish < std::chrono::milliseconds(METRICS_PUBLISH_MS)) return;
+    std::unique_lock<std::mutex> guard(metrics.lock, std::try_to_lock);
+    if (!guard.owns_lock()) {
+        ++metrics.skipped;
+        return;
+    }
+    PROFILE_SCOPE("metrics publish");
+    metrics.medianMs = m.frameMs.summary().p50;
+    for (int k = 0; k < PASS_COUNT; ++k) {
+        m.passMs[k] = gpuPasses[k].window;
+        m.passMsSum[k] = gpuPasses[k].resolvedMs;
+        m.passCount[k] = (unsigned long long)gpuPasses[k].resolved;
+    }
+    m.gpuTimerDropped = 0;
+    for (int k = 0; k < PASS_COUNT; ++k) m.gpuTimerDropped += gpuPasses[k].dropped;
+    for (int c = 0; c < GPUMEM_CATEGORY_COUNT; ++c) m.memBytes[c] = GpuMem_Total(c);
+    m.memBudget = gpuMem.budget;
+    snprintf(m.preset, sizeof(m.preset), "%s", preset);
+    m.uptimeS = std::chrono::duration<double>(now - metrics.start).count();
+    metrics.shared = m;
+    metrics.lastPublish = now;
+    ++metrics.published;
+}
+
+// Stop the thread; the file gets a last rewrite with the final counters
+static void Metrics_Stop() {
+    if (!metrics.active) return;
+    {
+        std::lock_guard<std::mutex> guard(metrics.lock);
+        metrics.local.uptimeS = std::chrono::duration<double>(std::chrono::steady_clock::now() - metrics.start).count();
+        metrics.shared = metrics.local;
+    }
+    metrics.stop = true;
+    metrics.wake.notify_all();
+    metrics.thread.join();
+    if (!metrics.filePath.empty() && Metrics_WriteFile(metrics.filePath, Metrics_Format(metrics.shared))) ++metrics.writes;
+#ifndef _WIN32
+    if (metrics.listenFd >= 0) {
+        close(metrics.listenFd);
+        unlink(metrics.socketPath.c_str());
+        metrics.listenFd = -1;
+    }
+#endif
+    fprintf(stdout, "Metrics: %d snapshots published, %d skipped (exporter busy), %d file writes, %d scrapes\n",
+        metrics.published, metrics.skipped, metrics.writes, metrics.scrapes);
+    metrics.active = false;
+}
+
+#endif //__METRICS_EXPORT_H__
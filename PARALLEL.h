@@ -0,0 +1,30 @@
+//**************************************************************************************
+// File PARALLEL.h
+// Minimal fork/join helper shared by the CPU reference renderer and the image
+// metrics: rows are handed out one at a time from an atomic counter to one
+// std::thread per hardware thread (the caller's thread included).
+//**************************************************************************************
+#ifndef __PARALLEL_H__
+#define __PARALLEL_H__
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Run fn(row) for every row on all hardware threads
+template<typename F>
+static void Parallel_Rows(int rows, F fn) {
+    unsigned n = std::thread::hardware_concurrency();
+    if (n < 1) n = 1;
+    if ((int)n > rows) n = rows > 0 ? rows : 1;
+    std::atomic<int> next{ 0 };
+    auto worker = [&]() {
+        for (int r = next++; r < rows; r = next++) fn(r);
+    };
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < n; ++i) pool.emplace_back(worker);
+    worker();
+    for (std::thread& t : pool) t.join();
+}
+
+#endif //__PARALLEL_H__
@@ -0,0 +1,210 @@
+//**************************************************************************************
+// File PERF_COUNTERS.h
+// Hardware performance counters for the CPU kernels (reference sampler and
+// renderer, image metrics, asset decode/downsample) through Linux
+// perf_event_open: cycles, instructions, L1D and LLC read misses and branch
+// mispredicts, next to the wall time of each kernel.
+//
+// Counters are opened on the calling thread with inherit set, so the worker
+// threads PARALLEL.h starts inside a kernel are counted too (their counts are
+// folded in when they are joined). User space only, so perf_event_paranoid
+// up to 2 is enough. Counters the CPU or the VM does not expose are left out;
+// when multiplexed, counts are scaled by time enabled / time running.
+// Elsewhere than Linux only the wall time is measured.
+//**************************************************************************************
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+#include <vector>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+#include "STATS.h"
+
+enum PerfCounter {
+    PERF_CYCLES = 0,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_COUNTER_COUNT
+};
+
+static const char* perfCounterNames[PERF_COUNTER_COUNT] = {
+    "cycles", "instructions", "l1d_misses", "llc_misses", "branch_misses"
+};
+
+struct PerfCounters {
+    int  fd[PERF_COUNTER_COUNT];
+    bool any = false;           // at least one counter works
+};
+
+// Counter values of one measurement, -1 where the counter is not available
+struct PerfSample {
+    double value[PERF_COUNTER_COUNT];
+};
+
+// One kernel: wall time per run, counters averaged over the runs
+struct PerfKernelResult {
+    std::string name;
+    int         runs = 0;
+    StatSummary wallMs;
+    PerfSample  perRun;
+};
+
+#ifdef __linux__
+static int PerfCounters_OpenOne(unsigned type, unsigned long long config) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.disabled = 1;
+    attr.inherit = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+}
+#endif
+
+// Open every counter on the calling thread; false if none is available
+static bool PerfCounters_Open(PerfCounters& pc) {
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) pc.fd[c] = -1;
+    pc.any = false;
+#ifdef __linux__
+    const unsigned long long readMiss = (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+    pc.fd[PERF_CYCLES] = PerfCounters_OpenOne(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES);
+    pc.fd[PERF_INSTRUCTIONS] = PerfCounters_OpenOne(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS);
+    pc.fd[PERF_L1D_MISSES] = PerfCounters_OpenOne(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | readMiss);
+    pc.fd[PERF_LLC_MISSES] = PerfCounters_OpenOne(PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | readMiss);
+    pc.fd[PERF_BRANCH_MISSES] = PerfCounters_OpenOne(PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES);
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) pc.any = pc.any || pc.fd[c] >= 0;
+    if (!pc.any) {
+        fprintf(stderr, "WARNING: no hardware performance counters (perf_event_open failed), wall time only\n");
+        return false;
+    }
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+        if (pc.fd[c] < 0) fprintf(stderr, "WARNING: performance counter %s is not available\n", perfCounterNames[c]);
+    return true;
+#else
+    return false;
+#endif
+}
+
+static void PerfCounters_Start(PerfCounters& pc) {
+#ifdef __linux__
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) {
+        if (pc.fd[c] < 0) continue;
+        ioctl(pc.fd[c], PERF_EVENT_IOC_RESET, 0);
+        ioctl(pc.fd[c], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#else
+    (void)pc;
+#endif
+}
+
+static void PerfCounters_Stop(PerfCounters& pc, PerfSample& out) {
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) out.value[c] = -1.0;
+#ifdef __linux__
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+        if (pc.fd[c] >= 0) ioctl(pc.fd[c], PERF_EVENT_IOC_DISABLE, 0);
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) {
+        unsigned long long v[3];     // value, time enabled, time running
+        if (pc.fd[c] < 0 || read(pc.fd[c], v, sizeof(v)) != (ssize_t)sizeof(v) || v[2] == 0) continue;
+        out.value[c] = (double)v[0] * ((double)v[1] / (double)v[2]);
+    }
+#else
+    (void)pc;
+#endif
+}
+
+static void PerfCounters_Close(PerfCounters& pc) {
+#ifdef __linux__
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+        if (pc.fd[c] >= 0) close(pc.fd[c]);
+#endif
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) pc.fd[c] = -1;
+}
+
+// Run fn() runs times (after one untimed warm-up run), each timed and counted
+template<typename F>
+static PerfKernelResult PerfKernel_Run(PerfCounters& pc, const char* name, int runs, F fn) {
+    PerfKernelResult r;
+    r.name = name;
+    r.runs = runs;
+    for (int c = 0; c < PERF_COUNTER_COUNT; ++c) r.perRun.value[c] = pc.fd[c] >= 0 ? 0.0 : -1.0;
+    fn();
+    std::vector<double> wall;
+    for (int i = 0; i < runs; ++i) {
+        PerfSample s;
+        auto t0 = std::chrono::steady_clock::now();
+        PerfCounters_Start(pc);
+        fn();
+        PerfCounters_Stop(pc, s);
+        wall.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        for (int c = 0; c < PERF_COUNTER_COUNT; ++c)
+            if (r.perRun.value[c] >= 0.0) r.perRun.value[c] = s.value[c] >= 0.0 ? r.perRun.value[c] + s.value[c] / runs : -1.0;
+    }
+    r.wallMs = summarize(wall);
+    return r;
+}
+
+// Misses per thousand instructions, -1 if either counter is missing
+static double PerfKernel_PerKiloInstr(const PerfKernelResult& r, PerfCounter c) {
+    double instr = r.perRun.value[PERF_INSTRUCTIONS];
+    return instr > 0.0 && r.perRun.value[c] >= 0.0 ? 1000.0 * r.perRun.value[c] / instr : -1.0;
+}
+
+static double PerfKernel_IPC(const PerfKernelResult& r) {
+    double cycles = r.perRun.value[PERF_CYCLES];
+    return cycles > 0.0 && r.perRun.value[PERF_INSTRUCTIONS] >= 0.0 ? r.perRun.value[PERF_INSTRUCTIONS] / cycles : -1.0;
+}
+
+static void PerfKernel_Print(FILE* f, const std::vector<PerfKernelResult>& results) {
+    fprintf(f, "%-22s %10s %12s %12s %6s %9s %9s %9s  (misses per 1000 instructions)\n",
+        "kernel", "wall ms", "Mcycles", "Minstr", "IPC", "L1D", "LLC", "branch");
+    for (const PerfKernelResult& r : results) {
+        double v[6] = { r.perRun.value[PERF_CYCLES] / 1e6, r.perRun.value[PERF_INSTRUCTIONS] / 1e6, PerfKernel_IPC(r),
+                        PerfKernel_PerKiloInstr(r, PERF_L1D_MISSES), PerfKernel_PerKiloInstr(r, PERF_LLC_MISSES),
+                        PerfKernel_PerKiloInstr(r, PERF_BRANCH_MISSES) };
+        char cols[6][16];
+        for (int k = 0; k < 6; ++k) snprintf(cols[k], sizeof(cols[k]), v[k] >= 0.0 ? "%.2f" : "-", v[k]);
+        fprintf(f, "%-22s %10.3f %12s %12s %6s %9s %9s %9s\n", r.name.c_str(), r.wallMs.p50,
+            cols[0], cols[1], cols[2], cols[3], cols[4], cols[5]);
+    }
+}
+
+// "cpu_kernels": [...] member for a report; counters per run, missing ones left out
+static std::string PerfKernel_Json(const std::vector<PerfKernelResult>& results) {
+    std::string json = "\"cpu_kernels\": [";
+    char buf[256];
+    for (size_t i = 0; i < results.size(); ++i) {
+        const PerfKernelResult& r = results[i];
+        const StatSummary& s = r.wallMs;
+        snprintf(buf, sizeof(buf), "%s{\"name\":\"%s\",\"runs\":%d,\"wall_ms\":{\"count\":%d,\"min\":%.4f,\"avg\":%.4f,"
+                                   "\"sd\":%.4f,\"p50\":%.4f,\"p95\":%.4f,\"max\":%.4f}",
+            i ? "," : "", r.name.c_str(), r.runs, s.count, s.min, s.avg, s.stddev, s.p50, s.p95, s.max);
+        json += buf;
+        for (int c = 0; c < PERF_COUNTER_COUNT; ++c) {
+            if (r.perRun.value[c] < 0.0) continue;
+            snprintf(buf, sizeof(buf), ",\"%s\":%.0f", perfCounterNames[c], r.perRun.value[c]);
+            json += buf;
+        }
+        if (PerfKernel_IPC(r) >= 0.0) {
+            snprintf(buf, sizeof(buf), ",\"ipc\":%.3f", PerfKernel_IPC(r));
+            json += buf;
+        }
+        json += "}";
+    }
+    return json + "]";
+}
+
+#endif //__PERF_COUNTERS_H__
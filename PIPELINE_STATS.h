@@ -0,0 +1,234 @@
+//**************************************************************************************
+// File PIPELINE_STATS.h
+// Per-pass pipeline counters from ARB_pipeline_statistics_query (core in 4.6),
+// plus GL_SAMPLES_PASSED, which every GL has. Counters the driver does not
+// implement (zero GL_QUERY_COUNTER_BITS) are skipped.
+//
+// The queries run alongside the GPU timer's and are read back the same way:
+// GPU_TIMER_LATENCY frames later, only if available, never waiting. Totals
+// are divided by the displayed pixels of the pass's viewport, so fragment
+// invocations per pixel show overdraw and helper invocations, and samples
+// passed per fragment show what MSAA adds.
+//**************************************************************************************
+#ifndef __PIPELINE_STATS_H__
+#define __PIPELINE_STATS_H__
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "GPU_TIMER.h"
+
+#ifndef GL_VERTICES_SUBMITTED_ARB
+#define GL_VERTICES_SUBMITTED_ARB           0x82EE
+#define GL_PRIMITIVES_SUBMITTED_ARB         0x82EF
+#define GL_VERTEX_SHADER_INVOCATIONS_ARB    0x82F0
+#define GL_FRAGMENT_SHADER_INVOCATIONS_ARB  0x82F4
+#define GL_CLIPPING_INPUT_PRIMITIVES_ARB    0x82F6
+#define GL_CLIPPING_OUTPUT_PRIMITIVES_ARB   0x82F7
+#endif
+
+enum PipeStat {
+    PIPE_SAMPLES_PASSED = 0,
+    PIPE_FRAGMENT_INVOCATIONS,
+    PIPE_VERTICES_SUBMITTED,
+    PIPE_PRIMITIVES_SUBMITTED,
+    PIPE_VERTEX_INVOCATIONS,
+    PIPE_CLIPPING_INPUT,
+    PIPE_CLIPPING_OUTPUT,
+    PIPE_STAT_COUNT
+};
+
+struct PipeStatInfo {
+    const char* name;
+    GLenum      target;
+    bool        arb;        // needs ARB_pipeline_statistics_query
+};
+
+static const PipeStatInfo pipeStatInfo[PIPE_STAT_COUNT] = {
+    { "samples_passed",           GL_SAMPLES_PASSED,                  false },
+    { "fragment_invocations",     GL_FRAGMENT_SHADER_INVOCATIONS_ARB, true },
+    { "vertices_submitted",       GL_VERTICES_SUBMITTED_ARB,          true },
+    { "primitives_submitted",     GL_PRIMITIVES_SUBMITTED_ARB,        true },
+    { "vertex_invocations",       GL_VERTEX_SHADER_INVOCATIONS_ARB,   true },
+    { "clipping_input",           GL_CLIPPING_INPUT_PRIMITIVES_ARB,   true },
+    { "clipping_output",          GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,  true },
+};
+
+struct PipePassStats {
+    GLuint queries[GPU_TIMER_LATENCY][PIPE_STAT_COUNT];
+    int    issuedFrame[GPU_TIMER_LATENCY];     // frame that used the slot, -1 if unused
+    double issuedPixels[GPU_TIMER_LATENCY];    // displayed pixels of the pass
+    double sum[PIPE_STAT_COUNT];               // since the last reset
+    double last[PIPE_STAT_COUNT];              // most recent frame read back
+    double lastPixels;
+    double pixels;
+    int    frames;
+    int    dropped;
+};
+
+struct PipeStatsState {
+    bool          ready = false;
+    bool          supported[PIPE_STAT_COUNT] = {};
+    int           frame = 0;
+    PipePassStats passes[PASS_COUNT];
+};
+
+static PipeStatsState pipeStats;
+
+static bool PipeStats_HasExtension(const char* name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; ++i) {
+        const char* ext = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (ext && !strcmp(ext, name)) return true;
+    }
+    return false;
+}
+
+static void PipeStats_Reset() {
+    for (PipePassStats& p : pipeStats.passes) {
+        memset(p.sum, 0, sizeof(p.sum));
+        p.pixels = 0.0;
+        p.frames = 0;
+    }
+}
+
+static void PipeStats_Init() {
+    bool arb = PipeStats_HasExtension("GL_ARB_pipeline_statistics_query");
+    for (int c = 0; c < PIPE_STAT_COUNT; ++c) {
+        GLint bits = 0;
+        if (!pipeStatInfo[c].arb || arb) glGetQueryiv(pipeStatInfo[c].target, GL_QUERY_COUNTER_BITS, &bits);
+        pipeStats.supported[c] = bits > 0;
+    }
+    if (!arb) fprintf(stderr, "WARNING: no ARB_pipeline_statistics_query, only samples passed are counted\n");
+    for (PipePassStats& p : pipeStats.passes) {
+        glGenQueries(GPU_TIMER_LATENCY * PIPE_STAT_COUNT, &p.queries[0][0]);
+        for (int i = 0; i < GPU_TIMER_LATENCY; ++i) p.issuedFrame[i] = -1;
+        p.dropped = 0;
+        memset(p.last, 0, sizeof(p.last));
+        p.lastPixels = 0.0;
+    }
+    PipeStats_Reset();
+    pipeStats.ready = true;
+}
+
+// Harvest the slot about to be reused; wait only when asked to (flush)
+static void PipeStats_Collect(PipePassStats& p, int slot, bool wait) {
+    if (p.issuedFrame[slot] < 0) return;
+    p.issuedFrame[slot] = -1;
+    GLuint64 value[PIPE_STAT_COUNT] = {};
+    for (int c = 0; c < PIPE_STAT_COUNT; ++c) {
+        if (!pipeStats.supported[c]) continue;
+        GLint available = GL_TRUE;
+        if (!wait) glGetQueryObjectiv(p.queries[slot][c], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            ++p.dropped;
+            return;
+        }
+        glGetQueryObjectui64v(p.queries[slot][c], GL_QUERY_RESULT, &value[c]);
+    }
+    for (int c = 0; c < PIPE_STAT_COUNT; ++c) {
+        p.sum[c] += (double)value[c];
+        p.last[c] = (double)value[c];
+    }
+    p.lastPixels = p.issuedPixels[slot];
+    p.pixels += p.issuedPixels[slot];
+    ++p.frames;
+}
+
+// pixels: displayed pixels the pass covers (its viewport)
+static void PipeStats_BeginPass(GpuPass pass, double pixels) {
+    if (!pipeStats.ready) return;
+    PipePassStats& p = pipeStats.passes[pass];
+    int slot = pipeStats.frame % GPU_TIMER_LATENCY;
+    PipeStats_Collect(p, slot, false);
+    for (int c = 0; c < PIPE_STAT_COUNT; ++c)
+        if (pipeStats.supported[c]) glBeginQuery(pipeStatInfo[c].target, p.queries[slot][c]);
+    p.issuedFrame[slot] = pipeStats.frame;
+    p.issuedPixels[slot] = pixels;
+}
+
+static void PipeStats_EndPass(GpuPass) {
+    if (!pipeStats.ready) return;
+    for (int c = 0; c < PIPE_STAT_COUNT; ++c)
+        if (pipeStats.supported[c]) glEndQuery(pipeStatInfo[c].target);
+}
+
+static void PipeStats_EndFrame() {
+    if (pipeStats.ready) ++pipeStats.frame;
+}
+
+// Read back everything still in flight. Only between measurement runs.
+static void PipeStats_Flush() {
+    if (!pipeStats.ready) return;
+    for (PipePassStats& p : pipeStats.passes)
+        for (int slot = 0; slot < GPU_TIMER_LATENCY; ++slot) PipeStats_Collect(p, slot, true);
+}
+
+// Average of a counter per frame, or per displayed pixel; -1 if not counted
+static double PipeStats_PerFrame(GpuPass pass, PipeStat c) {
+    const PipePassStats& p = pipeStats.passes[pass];
+    return pipeStats.supported[c] && p.frames ? p.sum[c] / p.frames : -1.0;
+}
+
+static double PipeStats_PerPixel(GpuPass pass, PipeStat c) {
+    const PipePassStats& p = pipeStats.passes[pass];
+    return pipeStats.supported[c] && p.pixels > 0.0 ? p.sum[c] / p.pixels : -1.0;
+}
+
+// Per displayed pixel in the most recent frame read back (live displays)
+static double PipeStats_LastPerPixel(GpuPass pass, PipeStat c) {
+    const PipePassStats& p = pipeStats.passes[pass];
+    return pipeStats.supported[c] && p.lastPixels > 0.0 ? p.last[c] / p.lastPixels : -1.0;
+}
+
+// Samples passed per shaded fragment: about the MSAA sample count when shading runs per pixel
+static double PipeStats_SamplesPerFragment(GpuPass pass) {
+    const PipePassStats& p = pipeStats.passes[pass];
+    if (!pipeStats.supported[PIPE_FRAGMENT_INVOCATIONS] || p.sum[PIPE_FRAGMENT_INVOCATIONS] <= 0.0) return -1.0;
+    return p.sum[PIPE_SAMPLES_PASSED] / p.sum[PIPE_FRAGMENT_INVOCATIONS];
+}
+
+static void PipeStats_Print(FILE* f) {
+    if (!pipeStats.ready) return;
+    for (int k = 0; k < PASS_COUNT; ++k) {
+        GpuPass pass = (GpuPass)k;
+        if (!pipeStats.passes[k].frames) continue;
+        fprintf(f, "Pipeline %-8s:", gpuPasses[k].name);
+        if (pipeStats.supported[PIPE_FRAGMENT_INVOCATIONS])
+            fprintf(f, " %.3f fragments/pixel, %.2f samples/fragment,",
+                PipeStats_PerPixel(pass, PIPE_FRAGMENT_INVOCATIONS), PipeStats_SamplesPerFragment(pass));
+        fprintf(f, " %.3f samples passed/pixel", PipeStats_PerPixel(pass, PIPE_SAMPLES_PASSED));
+        for (int c = PIPE_VERTICES_SUBMITTED; c < PIPE_STAT_COUNT; ++c)
+            if (pipeStats.supported[c])
+                fprintf(f, ", %s %.0f", pipeStatInfo[c].name, PipeStats_PerFrame(pass, (PipeStat)c));
+        fprintf(f, " (per frame, %d frames)\n", pipeStats.passes[k].frames);
+    }
+}
+
+// JSON members for a report: "<prefix>_<counter>_per_pixel" for samples and fragments,
+// "_per_frame" for the geometry counters; empty if nothing was counted
+static std::string PipeStats_Json(GpuPass pass, const char* prefix) {
+    std::string json;
+    char buf[160];
+    if (!pipeStats.ready || !pipeStats.passes[pass].frames) return json;
+    for (int c = 0; c < PIPE_STAT_COUNT; ++c) {
+        if (!pipeStats.supported[c]) continue;
+        bool perPixel = c < PIPE_VERTICES_SUBMITTED;
+        snprintf(buf, sizeof(buf), "%s\"%s_%s_per_%s\":%.4f", json.empty() ? "" : ",", prefix, pipeStatInfo[c].name,
+            perPixel ? "pixel" : "frame", perPixel ? PipeStats_PerPixel(pass, (PipeStat)c) : PipeStats_PerFrame(pass, (PipeStat)c));
+        json += buf;
+    }
+    return json;
+}
+
+static void PipeStats_Shutdown() {
+    if (!pipeStats.ready) return;
+    for (PipePassStats& p : pipeStats.passes) {
+        glDeleteQueries(GPU_TIMER_LATENCY * PIPE_STAT_COUNT, &p.queries[0][0]);
+        if (p.dropped) fprintf(stderr, "WARNING: %d pipeline statistics samples were not ready in time\n", p.dropped);
+    }
+    pipeStats.ready = false;
+}
+
+#endif //__PIPELINE_STATS_H__
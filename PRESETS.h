@@ -0,0 +1,127 @@
+//**************************************************************************************
+// File PRESETS.h
+// Named quality presets for the steep-parallax pass and an online tuner that
+// picks the highest preset meeting a GPU frame-time target. Each preset is a
+// set of the psSteepParallax.glsl knobs, compiled as its own shader
+// permutation (see Sweep_ShaderDefines); "high" is the shader's defaults.
+// Low, medium and ultra are points on the Pareto frontier of the default
+// --sweep (fetches per pixel vs. PSNR, 256x256 CPU reference, 4 views), and
+// their costs are that run's fetch ratios: low is the cheapest point above
+// 22 dB, medium the frontier point with high's trace steps, ultra the top
+// of the frontier. High itself is not on the frontier (points cheaper than
+// it score higher, mostly by spending fewer fetches on AO and PCF); it stays
+// the defaults so "high" renders exactly what the shader file says.
+//
+// The tuner is fed the per-pass GPU times and only decides on full windows of
+// samples taken after the last switch. It steps down as soon as the median
+// frame misses the target, but only steps up when the next preset is
+// predicted to fit with a margin, and backs off further every time such a
+// step up has to be undone.
+//**************************************************************************************
+#ifndef __PRESETS_H__
+#define __PRESETS_H__
+
+#include <string.h>
+#include "CPU_REFERENCE.h"
+#include "STATS.h"
+
+#define TUNER_WINDOW    30      // GPU samples per decision
+#define TUNER_SETTLE    4       // samples skipped after a switch (queries still in flight)
+#define TUNER_UP_MARGIN 0.85    // step up only if predicted to use < 85% of the target
+#define TUNER_UP_HOLD   120     // samples before a step up is tried after a step down
+
+enum QualityPreset {
+    PRESET_LOW = 0,
+    PRESET_MEDIUM,
+    PRESET_HIGH,
+    PRESET_ULTRA,
+    PRESET_COUNT
+};
+
+struct PresetInfo {
+    const char*   name;
+    float         relativeCost;     // steep-pass texture fetches vs. "high"
+    SteepSettings steep;
+};
+
+static PresetInfo Preset_Make(const char* name, float cost, float trace, int ao, int rings, float shadow) {
+    PresetInfo p;
+    p.name = name;
+    p.relativeCost = cost;
+    p.steep.traceStepsGrazing = trace;
+    p.steep.traceStepsFacing = trace * 0.5f;
+    p.steep.aoSamples = ao;
+    p.steep.pcfRings = rings;
+    p.steep.shadowStepsGrazing = shadow;
+    p.steep.shadowStepsFacing = shadow * 0.25f;
+    return p;
+}
+
+static const PresetInfo qualityPresets[PRESET_COUNT] = {
+    Preset_Make("low",    0.06f, 24.0f, 4, 0, 12.0f),
+    Preset_Make("medium", 0.17f, 72.0f, 4, 1, 12.0f),
+    Preset_Make("high",   1.00f, 72.0f, 8, 3, 48.0f),
+    Preset_Make("ultra",  1.22f, 96.0f, 4, 3, 64.0f),
+};
+
+// Preset by name, -1 if unknown
+static int Preset_Find(const char* name) {
+    for (int i = 0; i < PRESET_COUNT; ++i)
+        if (!strcmp(qualityPresets[i].name, name)) return i;
+    return -1;
+}
+
+struct AutoTuner {
+    bool   enabled = false;
+    double targetMs = 16.0;             // GPU time of both passes
+    int    preset = PRESET_HIGH;
+    int    settle = 0;
+    int    upHold = 0;
+    int    backoff = 1;                 // multiplies TUNER_UP_HOLD after a failed step up
+    bool   steppedUp = false;           // last switch was a step up
+    double lastMedianMs = 0.0;
+    RollingWindow<TUNER_WINDOW> totalMs;
+    RollingWindow<TUNER_WINDOW> steepMs;
+};
+
+static void Tuner_Switch(AutoTuner& t, int preset) {
+    t.steppedUp = preset > t.preset;
+    t.preset = preset;
+    t.settle = TUNER_SETTLE;
+    t.totalMs = RollingWindow<TUNER_WINDOW>();
+    t.steepMs = RollingWindow<TUNER_WINDOW>();
+}
+
+// Feed the GPU times of one frame; returns the preset to render with
+static int Tuner_Update(AutoTuner& t, double parallaxMs, double steepMs) {
+    if (!t.enabled) return t.preset;
+    if (t.upHold > 0) --t.upHold;
+    if (t.settle > 0) {
+        --t.settle;
+        return t.preset;
+    }
+    t.totalMs.add(parallaxMs + steepMs);
+    t.steepMs.add(steepMs);
+    if (t.totalMs.count < TUNER_WINDOW) return t.preset;
+
+    double total = t.totalMs.summary().p50;
+    double steep = t.steepMs.summary().p50;
+    t.lastMedianMs = total;
+    if (total > t.targetMs && t.preset > 0) {
+        if (t.steppedUp && t.backoff < 16) t.backoff *= 2;  // undoing a step up: wait longer next time
+        t.upHold = TUNER_UP_HOLD * t.backoff;
+        Tuner_Switch(t, t.preset - 1);
+        return t.preset;
+    }
+    if (t.steppedUp) {
+        t.backoff = 1;          // the step up held for a whole window
+        t.steppedUp = false;
+    }
+    if (t.preset + 1 < PRESET_COUNT && t.upHold == 0) {
+        double predicted = total - steep + steep * qualityPresets[t.preset + 1].relativeCost / qualityPresets[t.preset].relativeCost;
+        if (predicted < t.targetMs * TUNER_UP_MARGIN) Tuner_Switch(t, t.preset + 1);
+    }
+    return t.preset;
+}
+
+#endif //__PRESETS_H__
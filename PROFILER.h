@@ -0,0 +1,143 @@
+//**************************************************************************************
+// File PROFILER.h
+// Scoped CPU timers. PROFILE_SCOPE("name") records the scope's start time and
+// duration into a fixed-size ring buffer owned by the calling thread; the
+// recording path takes no locks, it is two clock reads, one store and one
+// release increment. Profiler_WriteTrace() dumps all rings as Chrome
+// trace-event JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Build with PROFILER_ENABLED=0 to compile every scope out completely.
+//**************************************************************************************
+#ifndef __PROFILER_H__
+#define __PROFILER_H__
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+#if PROFILER_ENABLED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+#include "JSON.h"
+
+#define PROFILER_RING_SIZE 65536   // events kept per thread (power of two)
+
+struct ProfileEvent {
+    const char* name;      // must be a string literal / static string
+    uint64_t    startNs;
+    uint64_t    durNs;
+};
+
+struct ProfileThreadBuffer {
+    ProfileEvent          events[PROFILER_RING_SIZE];
+    std::atomic<uint64_t> written{ 0 };
+    int                   tid = 0;
+    const char*           threadName = "worker";
+};
+
+static std::atomic<bool> profilerEnabled{ false };
+static std::mutex        profilerRegistryMutex;      // only taken once per thread
+static std::vector<ProfileThreadBuffer*> profilerBuffers;
+static const std::chrono::steady_clock::time_point profilerEpoch = std::chrono::steady_clock::now();
+
+static uint64_t Profiler_NowNs() {
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - profilerEpoch).count();
+}
+
+// Ring of the calling thread, registered on first use
+static ProfileThreadBuffer* Profiler_ThreadBuffer() {
+    thread_local ProfileThreadBuffer* buffer = nullptr;
+    if (!buffer) {
+        buffer = new ProfileThreadBuffer();
+        std::lock_guard<std::mutex> lock(profilerRegistryMutex);
+        buffer->tid = (int)profilerBuffers.size() + 1;
+        profilerBuffers.push_back(buffer);
+    }
+    return buffer;
+}
+
+static void Profiler_Record(const char* name, uint64_t startNs, uint64_t endNs) {
+    ProfileThreadBuffer* b = Profiler_ThreadBuffer();
+    uint64_t n = b->written.load(std::memory_order_relaxed);
+    ProfileEvent& e = b->events[n & (PROFILER_RING_SIZE - 1)];
+    e.name = name;
+    e.startNs = startNs;
+    e.durNs = endNs - startNs;
+    b->written.store(n + 1, std::memory_order_release);
+}
+
+static void Profiler_SetEnabled(bool on) {
+    profilerEnabled.store(on, std::memory_order_relaxed);
+}
+
+// Label the calling thread in the trace (string must outlive the profiler)
+static void Profiler_SetThreadName(const char* name) {
+    Profiler_ThreadBuffer()->threadName = name;
+}
+
+// RAII timer: records [construction, destruction) when profiling is on
+struct ProfileScope {
+    const char* name;
+    uint64_t    start;
+    explicit ProfileScope(const char* n) : name(n), start(0) {
+        if (profilerEnabled.load(std::memory_order_relaxed)) start = Profiler_NowNs() | 1;
+    }
+    ~ProfileScope() {
+        if (start) Profiler_Record(name, start, Profiler_NowNs());
+    }
+};
+
+// Write the contents of every thread's ring as a trace-event JSON file
+static bool Profiler_WriteTrace(const char* path) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    fprintf(f, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    bool first = true;
+    size_t total = 0;
+
+    std::lock_guard<std::mutex> lock(profilerRegistryMutex);
+    for (ProfileThreadBuffer* b : profilerBuffers) {
+        // Leave a margin so slots the owner thread may be rewriting are skipped
+        const uint64_t margin = 1024;
+        uint64_t end = b->written.load(std::memory_order_acquire);
+        uint64_t begin = end > PROFILER_RING_SIZE - margin ? end - (PROFILER_RING_SIZE - margin) : 0;
+        for (uint64_t i = begin; i < end; ++i) {
+            const ProfileEvent& e = b->events[i & (PROFILER_RING_SIZE - 1)];
+            fprintf(f, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                first ? "" : ",\n", Json_Escape(e.name).c_str(), b->tid, e.startNs * 1e-3, e.durNs * 1e-3);
+            first = false;
+            ++total;
+        }
+        fprintf(f, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"%s\"}}",
+            first ? "" : ",\n", b->tid, Json_Escape(b->threadName).c_str());
+        first = false;
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+    fprintf(stdout, "Wrote %zu trace events to '%s'\n", total, path);
+    return true;
+}
+
+#define PROFILE_CONCAT_(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_(a, b)
+#define PROFILE_SCOPE(name) ProfileScope PROFILE_CONCAT(profileScope_, __LINE__)(name)
+
+#else // !PROFILER_ENABLED
+
+#define PROFILE_SCOPE(name)
+static void Profiler_SetEnabled(bool) {}
+static void Profiler_SetThreadName(const char*) {}
+static bool Profiler_WriteTrace(const char*) { return false; }
+
+#endif // PROFILER_ENABLED
+
+#endif //__PROFILER_H__
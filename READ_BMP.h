@@ -1,46 +1,103 @@
-//**************************************************************************************
-// Copyright 2004, Huamin Wang
-//**************************************************************************************
-// File BMP_IO.h
-// Only consider 24 bits RGB color BMP files here.
-// Ignore the alpha channel.
-// The storage sequence in BITMAP is BGR, not RGB.
-//**************************************************************************************
-#ifndef __FILE_IO_BMP_IO_H__
-#define __FILE_IO_BMP_IO_H__
-#include <stdio.h>
-#include <windows.h>
-
-
-bool BMP_Read(const char *filename, BYTE** pixels, int &width, int &height)
-{
-	HBITMAP bmp_handle = (HBITMAP)LoadImage(NULL, filename, IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE | LR_CREATEDIBSECTION | LR_DEFAULTSIZE);
-	if(bmp_handle==INVALID_HANDLE_VALUE) return false;
-	BITMAP bitmap;
-	GetObject(bmp_handle, sizeof(BITMAP), (LPSTR)&bitmap);
-	if(bitmap.bmPlanes * bitmap.bmBitsPixel!=24)
-	{printf("Error: The bmp image depth is not 24.\n"); DeleteObject(bmp_handle); return false;}
-
-	width=bitmap.bmWidth;
-	height=bitmap.bmHeight;
-    if(*pixels) delete *pixels;
-	*pixels=new BYTE[bitmap.bmWidth * bitmap.bmHeight *3];
-
-	unsigned char *ptr=(unsigned char *)(bitmap.bmBits);
-	for(int j=0; j<height; j++)
-	{
-		unsigned char *line_ptr=ptr;
-		for(int i=0; i<width; i++) 
-		{
-			(*pixels)[3*(i*height+j)  ]=line_ptr[2];
-			(*pixels)[3*(i*height+j)+1]=line_ptr[1];
-			(*pixels)[3*(i*height+j)+2]=line_ptr[0];
-			line_ptr+=3;
-		}
-		ptr+=bitmap.bmWidthBytes;
-	}
-	DeleteObject(bmp_handle);
-	return true;
-}
-
-#endif //__FILE_IO_BMP_IO_H__
+//**************************************************************************************
+// Copyright 2004, Huamin Wang
+//**************************************************************************************
+// File BMP_IO.h
+// Only consider 24 bits RGB color BMP files here.
+// Ignore the alpha channel.
+// The storage sequence in BITMAP is BGR, not RGB.
+//**************************************************************************************
+#ifndef __FILE_IO_BMP_IO_H__
+#define __FILE_IO_BMP_IO_H__
+#include <stdio.h>
+
+#ifdef _WIN32
+#include <windows.h>
+
+
+bool BMP_Read(const char *filename, BYTE** pixels, int &width, int &height)
+{
+	HBITMAP bmp_handle = (HBITMAP)LoadImage(NULL, filename, IMAGE_BITMAP, 0, 0, LR_LOADFROMFILE | LR_CREATEDIBSECTION | LR_DEFAULTSIZE);
+	if(bmp_handle==INVALID_HANDLE_VALUE) return false;
+	BITMAP bitmap;
+	GetObject(bmp_handle, sizeof(BITMAP), (LPSTR)&bitmap);
+	if(bitmap.bmPlanes * bitmap.bmBitsPixel!=24)
+	{printf("Error: The bmp image depth is not 24.\n"); DeleteObject(bmp_handle); return false;}
+
+	width=bitmap.bmWidth;
+	height=bitmap.bmHeight;
+    if(*pixels) delete *pixels;
+	*pixels=new BYTE[bitmap.bmWidth * bitmap.bmHeight *3];
+
+	unsigned char *ptr=(unsigned char *)(bitmap.bmBits);
+	for(int j=0; j<height; j++)
+	{
+		unsigned char *line_ptr=ptr;
+		for(int i=0; i<width; i++) 
+		{
+			(*pixels)[3*(i*height+j)  ]=line_ptr[2];
+			(*pixels)[3*(i*height+j)+1]=line_ptr[1];
+			(*pixels)[3*(i*height+j)+2]=line_ptr[0];
+			line_ptr+=3;
+		}
+		ptr+=bitmap.bmWidthBytes;
+	}
+	DeleteObject(bmp_handle);
+	return true;
+}
+
+#else
+//**************************************************************************************
+// Portable reader for platforms without LoadImage (headless Linux builds).
+// Parses the BITMAPFILEHEADER/BITMAPINFOHEADER directly and produces exactly
+// the same transposed RGB layout as the Win32 path above.
+//**************************************************************************************
+typedef unsigned char BYTE;
+
+static unsigned int BMP_U32(const unsigned char *p) { return p[0] | (p[1]<<8) | (p[2]<<16) | ((unsigned int)p[3]<<24); }
+static unsigned int BMP_U16(const unsigned char *p) { return p[0] | (p[1]<<8); }
+
+bool BMP_Read(const char *filename, BYTE** pixels, int &width, int &height)
+{
+	FILE *f=fopen(filename, "rb");
+	if(!f) {printf("Error: cannot open '%s'.\n", filename); return false;}
+	unsigned char header[54];
+	if(fread(header, 1, 54, f)!=54 || header[0]!='B' || header[1]!='M')
+	{printf("Error: '%s' is not a BMP file.\n", filename); fclose(f); return false;}
+	if(BMP_U16(header+28)!=24 || BMP_U32(header+30)!=0)
+	{printf("Error: The bmp image depth is not 24.\n"); fclose(f); return false;}
+
+	unsigned int offset=BMP_U32(header+10);
+	int w=(int)BMP_U32(header+18);
+	int h=(int)BMP_U32(header+22);
+	bool top_down=h<0;
+	if(top_down) h=-h;
+	int row_bytes=(w*3+3)&~3;
+
+	unsigned char *data=new unsigned char[row_bytes*h];
+	if(fseek(f, offset, SEEK_SET)!=0 || fread(data, 1, row_bytes*h, f)!=(size_t)(row_bytes*h))
+	{printf("Error: '%s' is truncated.\n", filename); delete[] data; fclose(f); return false;}
+	fclose(f);
+
+	width=w;
+	height=h;
+	if(*pixels) delete[] *pixels;
+	*pixels=new BYTE[w*h*3];
+
+	// DIB rows are bottom-up; j indexes them in that order like bmBits does.
+	for(int j=0; j<height; j++)
+	{
+		unsigned char *line_ptr=data+row_bytes*(top_down ? height-1-j : j);
+		for(int i=0; i<width; i++)
+		{
+			(*pixels)[3*(i*height+j)  ]=line_ptr[2];
+			(*pixels)[3*(i*height+j)+1]=line_ptr[1];
+			(*pixels)[3*(i*height+j)+2]=line_ptr[0];
+			line_ptr+=3;
+		}
+	}
+	delete[] data;
+	return true;
+}
+#endif
+
+#endif //__FILE_IO_BMP_IO_H__
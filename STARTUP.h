@@ -0,0 +1,132 @@
+//**************************************************************************************
+// File STARTUP.h
+// Startup-time breakdown and the asset loader of the fast-start mode.
+//
+// STARTUP_PHASE(name) times a block against the process start (main); the
+// first presented frame and, in fast-start mode, the first full-quality frame
+// are recorded as latencies. Startup_Print() writes the report.
+//
+// Fast start presents the first frame with placeholder textures and the plain
+// normal-mapping shader while a loader thread reads the BMPs. Each image is
+// uploaded twice: a box-filtered 1/8 size copy as soon as it has been read,
+// then the full image on a later frame. The render thread does the uploads
+// and builds the remaining shaders one step per frame (GL calls stay on the
+// thread that owns the context).
+//**************************************************************************************
+#ifndef __STARTUP_H__
+#define __STARTUP_H__
+
+#include <stdio.h>
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+#include "PROFILER.h"
+#include "READ_BMP.h"
+
+#define STARTUP_MAX_PHASES 32
+#define STARTUP_LOW_SHIFT  3        // low-quality copy: 1/8 of each dimension
+
+struct StartupPhase {
+    char   name[48];
+    double startMs;
+    double ms;
+};
+
+struct StartupReport {
+    std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+    StartupPhase phases[STARTUP_MAX_PHASES];
+    int          count = 0;
+    double       firstFrameMs = -1.0;   // first frame presented (after the swap and a glFinish)
+    double       fullQualityMs = -1.0;  // fast start: first frame with every asset and shader
+};
+
+static StartupReport startup;
+
+static double Startup_Now() {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup.origin).count();
+}
+
+// Called first thing in main; phases and latencies are measured from here
+static void Startup_Begin() {
+    startup.origin = std::chrono::steady_clock::now();
+    startup.count = 0;
+}
+
+struct StartupScope {
+    int index;
+    explicit StartupScope(const char* name, const char* detail = nullptr) : index(-1) {
+        if (startup.count >= STARTUP_MAX_PHASES) return;
+        index = startup.count++;
+        StartupPhase& p = startup.phases[index];
+        snprintf(p.name, sizeof(p.name), detail ? "%s %s" : "%s", name, detail);
+        p.startMs = Startup_Now();
+        p.ms = 0.0;
+    }
+    ~StartupScope() {
+        if (index >= 0) startup.phases[index].ms = Startup_Now() - startup.phases[index].startMs;
+    }
+};
+#define STARTUP_CONCAT_(a, b) a##b
+#define STARTUP_CONCAT(a, b) STARTUP_CONCAT_(a, b)
+#define STARTUP_PHASE(...) StartupScope STARTUP_CONCAT(startupScope_, __LINE__)(__VA_ARGS__)
+
+static void Startup_Print(FILE* f) {
+    fprintf(f, "%-28s %10s %10s\n", "startup phase", "start ms", "ms");
+    for (int i = 0; i < startup.count; ++i)
+        fprintf(f, "%-28s %10.1f %10.1f\n", startup.phases[i].name, startup.phases[i].startMs, startup.phases[i].ms);
+    fprintf(f, "%-28s %10.1f\n", "first frame presented", startup.firstFrameMs);
+    if (startup.fullQualityMs >= 0.0)
+        fprintf(f, "%-28s %10.1f\n", "first full-quality frame", startup.fullQualityMs);
+}
+
+// ---- fast-start loader ---------------------------------------------------------------
+struct StartupImage {
+    const char*                path = nullptr;
+    std::vector<unsigned char> rgb;         // as BMP_Read returns it
+    std::vector<unsigned char> low;         // 1/2^STARTUP_LOW_SHIFT box-filtered copy
+    int                        width = 0, height = 0;
+    int                        lowWidth = 0, lowHeight = 0;
+    std::atomic<int>           state{ 0 };  // 0 loading, 1 ready, -1 failed
+    int                        uploaded = 0;    // render thread: 0 placeholder, 1 low, 2 full
+};
+
+// Box filter of an RGB image by 2^shift in both directions
+static void Startup_Downsample(const std::vector<unsigned char>& src, int w, int h, int shift,
+                               std::vector<unsigned char>& dst, int& dw, int& dh) {
+    int n = 1 << shift;
+    dw = w >> shift > 0 ? w >> shift : 1;
+    dh = h >> shift > 0 ? h >> shift : 1;
+    dst.assign((size_t)dw * dh * 3, 0);
+    for (int y = 0; y < dh; ++y)
+        for (int x = 0; x < dw; ++x)
+            for (int c = 0; c < 3; ++c) {
+                unsigned sum = 0, count = 0;
+                for (int j = y * n; j < y * n + n && j < h; ++j)
+                    for (int i = x * n; i < x * n + n && i < w; ++i, ++count)
+                        sum += src[((size_t)j * w + i) * 3 + c];
+                dst[((size_t)y * dw + x) * 3 + c] = (unsigned char)((sum + count / 2) / count);
+            }
+}
+
+// Read the images in order on a new thread; poll each image's state from the caller
+static std::thread Startup_LoadImages(StartupImage* images, int count) {
+    return std::thread([images, count]() {
+        Profiler_SetThreadName("asset loader");
+        for (int k = 0; k < count; ++k) {
+            StartupImage& img = images[k];
+            PROFILE_SCOPE("BMP_Read (loader)");
+            BYTE* pixels = nullptr;
+            if (!BMP_Read(img.path, &pixels, img.width, img.height)) {
+                img.state.store(-1, std::memory_order_release);
+                continue;
+            }
+            img.rgb.assign(pixels, pixels + (size_t)img.width * img.height * 3);
+            delete[] pixels;
+            Startup_Downsample(img.rgb, img.width, img.height, STARTUP_LOW_SHIFT, img.low, img.lowWidth, img.lowHeight);
+            img.state.store(1, std::memory_order_release);
+        }
+    });
+}
+
+#endif //__STARTUP_H__
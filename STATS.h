@@ -0,0 +1,107 @@
+//**************************************************************************************
+// File STATS.h
+// Small statistics helpers shared by the timing code: a fixed-size rolling
+// window of samples and percentile summaries over it.
+//**************************************************************************************
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <vector>
+
+// Summary of a set of samples (all in the samples' unit, usually ms)
+struct StatSummary {
+    int    count = 0;
+    double min = 0.0;
+    double avg = 0.0;
+    double stddev = 0.0;    // sample standard deviation
+    double p50 = 0.0;
+    double p95 = 0.0;
+    double p99 = 0.0;
+    double max = 0.0;
+};
+
+// Nearest-rank percentile of an already sorted vector, p in [0,100]
+static double percentileSorted(const std::vector<double>& sorted, double p) {
+    if (sorted.empty()) return 0.0;
+    size_t rank = (size_t)(p / 100.0 * (double)(sorted.size() - 1) + 0.5);
+    return sorted[rank < sorted.size() ? rank : sorted.size() - 1];
+}
+
+// Summarize an arbitrary list of samples (copied, then sorted)
+static StatSummary summarize(std::vector<double> v) {
+    StatSummary s;
+    if (v.empty()) return s;
+    std::sort(v.begin(), v.end());
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    s.count = (int)v.size();
+    s.min = v.front();
+    s.max = v.back();
+    s.avg = sum / (double)v.size();
+    if (v.size() > 1) {
+        double sq = 0.0;
+        for (double x : v) sq += (x - s.avg) * (x - s.avg);
+        s.stddev = sqrt(sq / (double)(v.size() - 1));
+    }
+    s.p50 = percentileSorted(v, 50.0);
+    s.p95 = percentileSorted(v, 95.0);
+    s.p99 = percentileSorted(v, 99.0);
+    return s;
+}
+
+// Fixed-capacity ring of the most recent samples
+template<int N>
+struct RollingWindow {
+    double samples[N];
+    int    count = 0;
+    int    next = 0;
+
+    void add(double v) {
+        samples[next] = v;
+        next = (next + 1) % N;
+        if (count < N) ++count;
+    }
+    double last() const {
+        return count ? samples[(next + N - 1) % N] : 0.0;
+    }
+    StatSummary summary() const {
+        return summarize(std::vector<double>(samples, samples + count));
+    }
+};
+
+static double mean(const std::vector<double>& v) {
+    double sum = 0.0;
+    for (double x : v) sum += x;
+    return v.empty() ? 0.0 : sum / (double)v.size();
+}
+
+// Paired bootstrap confidence interval of mean(b) / mean(a). a[i] and b[i] must come
+// from the same trial; trials are resampled with replacement. level is e.g. 0.95.
+static void bootstrapRatioCI(const std::vector<double>& a, const std::vector<double>& b,
+                             int iterations, unsigned seed, double level, double* lo, double* hi) {
+    *lo = *hi = 0.0;
+    size_t n = std::min(a.size(), b.size());
+    if (n == 0 || iterations <= 0) return;
+    std::mt19937 rng(seed);
+    std::uniform_int_distribution<size_t> pick(0, n - 1);
+    std::vector<double> ratios;
+    ratios.reserve(iterations);
+    for (int it = 0; it < iterations; ++it) {
+        double sa = 0.0, sb = 0.0;
+        for (size_t k = 0; k < n; ++k) {
+            size_t i = pick(rng);
+            sa += a[i];
+            sb += b[i];
+        }
+        if (sa > 0.0) ratios.push_back(sb / sa);
+    }
+    std::sort(ratios.begin(), ratios.end());
+    double tail = (1.0 - level) * 0.5 * 100.0;
+    *lo = percentileSorted(ratios, tail);
+    *hi = percentileSorted(ratios, 100.0 - tail);
+}
+
+#endif //__STATS_H__
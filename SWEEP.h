@@ -0,0 +1,203 @@
+//**************************************************************************************
+// File SWEEP.h
+// Parameter sweep of the steep-parallax quality knobs (trace steps, AO samples
+// and radius, PCF rings, shadow steps). Every point of the grid is scored for
+// cost (time, texture fetches) and error (PSNR/SSIM against the high-sample
+// reference); the Pareto frontier of cost vs. PSNR is marked and presets are
+// recommended as the best frontier point within a fraction of the cost of the
+// shader's default settings.
+//**************************************************************************************
+#ifndef __SWEEP_H__
+#define __SWEEP_H__
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "CPU_REFERENCE.h"
+#include "JSON.h"
+
+// Axes of the grid. Step axes keep the shader's grazing:facing ratios
+// (trace 72:36, shadow 48:12), the value swept is the grazing count.
+enum SweepAxisId {
+    SWEEP_TRACE_STEPS = 0,
+    SWEEP_AO_SAMPLES,
+    SWEEP_AO_RADIUS,
+    SWEEP_PCF_RINGS,
+    SWEEP_SHADOW_STEPS,
+    SWEEP_AXIS_COUNT
+};
+
+struct SweepAxis {
+    const char*        name;
+    std::vector<float> values;
+};
+
+static SweepAxis sweepAxes[SWEEP_AXIS_COUNT] = {
+    { "trace_steps",  { 16, 24, 36, 48, 72, 96 } },
+    { "ao_samples",   { 4, 8, 12, 16 } },
+    { "ao_radius",    { 0.012f } },   // cost-neutral; the reference uses 0.012 too
+    { "pcf_rings",    { 0, 1, 2, 3 } },
+    { "shadow_steps", { 12, 24, 48, 64 } },
+};
+
+// Replace the values of an axis from "name=v1,v2,..."
+static bool Sweep_SetAxis(const char* spec) {
+    const char* eq = strchr(spec, '=');
+    if (!eq) return false;
+    for (int a = 0; a < SWEEP_AXIS_COUNT; ++a) {
+        if (strncmp(spec, sweepAxes[a].name, eq - spec) || sweepAxes[a].name[eq - spec]) continue;
+        std::vector<float> values;
+        for (const char* p = eq + 1; *p; ) {
+            char* end = nullptr;
+            float v = strtof(p, &end);
+            if (end == p) return false;
+            values.push_back(v);
+            p = (*end == ',') ? end + 1 : end;
+        }
+        if (values.empty()) return false;
+        sweepAxes[a].values = values;
+        return true;
+    }
+    return false;
+}
+
+static void Sweep_Apply(int axis, float value, SteepSettings& s) {
+    switch (axis) {
+    case SWEEP_TRACE_STEPS:  s.traceStepsGrazing = value; s.traceStepsFacing = value * 0.5f; break;
+    case SWEEP_AO_SAMPLES:   s.aoSamples = (int)value; break;
+    case SWEEP_AO_RADIUS:    s.aoRadius = value; break;
+    case SWEEP_PCF_RINGS:    s.pcfRings = (int)value; break;
+    case SWEEP_SHADOW_STEPS: s.shadowStepsGrazing = value; s.shadowStepsFacing = value * 0.25f; break;
+    }
+}
+
+// Cartesian product of all axes; the shader defaults are always point 0
+static std::vector<SteepSettings> Sweep_Grid() {
+    std::vector<SteepSettings> grid(1);
+    size_t total = 1;
+    for (int a = 0; a < SWEEP_AXIS_COUNT; ++a) total *= sweepAxes[a].values.size();
+    for (size_t i = 0; i < total; ++i) {
+        SteepSettings s;
+        size_t rest = i;
+        for (int a = 0; a < SWEEP_AXIS_COUNT; ++a) {
+            size_t n = sweepAxes[a].values.size();
+            Sweep_Apply(a, sweepAxes[a].values[rest % n], s);
+            rest /= n;
+        }
+        const SteepSettings& d = grid[0];
+        if (s.traceStepsGrazing == d.traceStepsGrazing && s.traceStepsFacing == d.traceStepsFacing &&
+            s.aoSamples == d.aoSamples && s.aoRadius == d.aoRadius && s.pcfRings == d.pcfRings &&
+            s.shadowStepsGrazing == d.shadowStepsGrazing && s.shadowStepsFacing == d.shadowStepsFacing) continue;
+        grid.push_back(s);
+    }
+    return grid;
+}
+
+// #define block for psSteepParallax.glsl, inserted after its #version line
+static std::string Sweep_ShaderDefines(const SteepSettings& s) {
+    char buf[512];
+    snprintf(buf, sizeof(buf),
+        "#define TRACE_STEPS_GRAZING %.1f\n#define TRACE_STEPS_FACING %.1f\n"
+        "#define AO_SAMPLES %d\n#define AO_RADIUS %.6f\n#define PCF_RINGS %d\n"
+        "#define SHADOW_STEPS_GRAZING %.1f\n#define SHADOW_STEPS_FACING %.1f\n",
+        s.traceStepsGrazing, s.traceStepsFacing, s.aoSamples, s.aoRadius, s.pcfRings,
+        s.shadowStepsGrazing, s.shadowStepsFacing);
+    return buf;
+}
+
+struct SweepPoint {
+    SteepSettings settings;
+    double ms = 0.0;                // mean render time per view
+    double fetchesPerPixel = 0.0;   // CPU backend only
+    double psnr = 0.0;              // mean over views, dB
+    double ssim = 0.0;
+    bool   pareto = false;
+};
+
+static double Sweep_Cost(const SweepPoint& p, bool byFetches) {
+    return byFetches ? p.fetchesPerPixel : p.ms;
+}
+
+// Mark the points no other point beats on both cost and PSNR
+static void Sweep_MarkPareto(std::vector<SweepPoint>& points, bool byFetches) {
+    for (SweepPoint& p : points) {
+        p.pareto = true;
+        for (const SweepPoint& q : points) {
+            double pc = Sweep_Cost(p, byFetches), qc = Sweep_Cost(q, byFetches);
+            if (qc <= pc && q.psnr >= p.psnr && (qc < pc || q.psnr > p.psnr)) {
+                p.pareto = false;
+                break;
+            }
+        }
+    }
+}
+
+// Recommended presets: best frontier point within a share of the default cost
+struct SweepPreset {
+    const char* name;
+    double      budget;     // x cost of point 0 (the shader defaults)
+};
+
+static const SweepPreset sweepPresets[] = {
+    { "low",    0.25 },
+    { "medium", 0.5 },
+    { "high",   1.0 },
+    { "ultra",  2.0 },
+};
+static const int sweepPresetCount = sizeof(sweepPresets) / sizeof(sweepPresets[0]);
+
+static int Sweep_Recommend(const std::vector<SweepPoint>& points, bool byFetches, double budget) {
+    int best = -1;
+    double limit = Sweep_Cost(points[0], byFetches) * budget;
+    for (size_t i = 0; i < points.size(); ++i) {
+        if (!points[i].pareto || Sweep_Cost(points[i], byFetches) > limit) continue;
+        if (best < 0 || points[i].psnr > points[best].psnr) best = (int)i;
+    }
+    return best;
+}
+
+static void Sweep_WriteSettings(FILE* f, const SteepSettings& s) {
+    fprintf(f, "\"trace_steps\":[%.0f,%.0f],\"ao_samples\":%d,\"ao_radius\":%.4f,\"pcf_rings\":%d,\"shadow_steps\":[%.0f,%.0f]",
+        s.traceStepsGrazing, s.traceStepsFacing, s.aoSamples, s.aoRadius, s.pcfRings,
+        s.shadowStepsGrazing, s.shadowStepsFacing);
+}
+
+// Report: every point, the frontier in cost order and the presets
+static bool Sweep_WriteJson(const char* path, const char* backend, const char* renderer, int size, int views,
+                            const std::vector<SweepPoint>& points, bool byFetches) {
+    FILE* f = fopen(path, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    fprintf(f, "{\n  \"backend\": \"%s\",\n  \"renderer\": \"%s\",\n  \"size\": %d,\n  \"views\": %d,\n"
+               "  \"cost\": \"%s\",\n  \"points\": [\n",
+        backend, Json_Escape(renderer).c_str(), size, views, byFetches ? "fetches_per_pixel" : "ms");
+    for (size_t i = 0; i < points.size(); ++i) {
+        const SweepPoint& p = points[i];
+        fprintf(f, "    {");
+        Sweep_WriteSettings(f, p.settings);
+        fprintf(f, ",\"ms\":%.4f,\"fetches_per_pixel\":%.2f,\"psnr_db\":%.3f,\"ssim\":%.5f,\"pareto\":%s,\"default\":%s}%s\n",
+            p.ms, p.fetchesPerPixel, p.psnr, p.ssim, p.pareto ? "true" : "false", i == 0 ? "true" : "false",
+            i + 1 < points.size() ? "," : "");
+    }
+    fprintf(f, "  ],\n  \"presets\": {");
+    for (int k = 0; k < sweepPresetCount; ++k) {
+        int i = Sweep_Recommend(points, byFetches, sweepPresets[k].budget);
+        fprintf(f, "%s\n    \"%s\": ", k ? "," : "", sweepPresets[k].name);
+        if (i < 0) {
+            fprintf(f, "null");
+            continue;
+        }
+        fprintf(f, "{\"cost_budget\":%.2f,\"point\":%d,", sweepPresets[k].budget, i);
+        Sweep_WriteSettings(f, points[i].settings);
+        fprintf(f, ",\"psnr_db\":%.3f,\"ssim\":%.5f}", points[i].psnr, points[i].ssim);
+    }
+    fprintf(f, "\n  }\n}\n");
+    fclose(f);
+    return true;
+}
+
+#endif //__SWEEP_H__
@@ -0,0 +1,767 @@
+//**************************************************************************************
+// File TERRAIN.h
+// Large-terrain mode: the steep pass ray-marches a world far too big for one
+// texture, a sparse virtual texture streamed in pages while a window flies
+// over it.
+//
+// The world file holds a mip pyramid of TERRAIN_TILE² pages, level 0 first,
+// each page row-major. A page stores three sets - diffuse RGB, height and a
+// tangent-space normal (xy) - with a TERRAIN_BORDER texel apron copied from
+// its neighbours so bilinear fetches never cross a page:
+//   header | level 0 pages | level 1 pages | ... | one page
+// Terrain_Generate() writes one from fractal value noise, each level
+// band-limited to its texel size. The noise is placed relative to the world
+// centre, so every world size shows the same ground under the flight path
+// and only the streaming load differs.
+//
+// On the GPU the resident pages live in three atlases (one per set) of
+// TERRAIN_ATLAS_SLOTS² slots, of which --terrain-slots may leave only the
+// first few in use to force evictions on a small world. The page table is an RGBA8 texture with a mip
+// level per pyramid level and a texel per page: rg = atlas slot, b = level
+// of the page actually resident there. A missing page maps to its nearest
+// resident ancestor, so psSteepParallax.glsl (built with TERRAIN) always
+// finds something to sample. The levels of at most TERRAIN_PINNED_TILES²
+// pages are loaded at startup and never evicted.
+//
+// Pages are requested by the GPU (VT_FEEDBACK.h): each frame the steep view
+// is drawn again at low resolution with psTerrainFeedback.glsl, which writes
+// the page and level each pixel samples. Terrain_Update() takes the latest
+// resolved list, ranks it by pixels times how much coarser the page's
+// stand-in is, adds the ancestors and the window TERRAIN_PREFETCH_FRAMES
+// ahead along the flight, and marks the resident requested ones used. Missing
+// pages are queued for a pool of pread() workers, no more per frame than the
+// bandwidth budget allows and no more in flight than slots that may be
+// evicted; the render thread uploads up to TERRAIN_UPLOADS_PER_FRAME of them,
+// evicting the least recently used slot the view did not sample this frame. All
+// per-frame work is bounded by the view, not the world, so frame time stays
+// flat as the world grows.
+//**************************************************************************************
+#ifndef __TERRAIN_H__
+#define __TERRAIN_H__
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+#include "GPU_MEMORY.h"
+#include "PARALLEL.h"
+#include "PROFILER.h"
+#include "STATS.h"
+#include "VT_FEEDBACK.h"
+
+#define TERRAIN_MAGIC             "SPTR"
+#define TERRAIN_VERSION           2
+#define TERRAIN_TILE              128     // payload texels per page side
+#define TERRAIN_BORDER            1       // apron texels on each side
+#define TERRAIN_SLOT              (TERRAIN_TILE + 2 * TERRAIN_BORDER)
+#define TERRAIN_PAGE_BYTES        (TERRAIN_SLOT * TERRAIN_SLOT * 6)     // diffuse RGB, height, normal xy
+#define TERRAIN_ATLAS_SLOTS       16      // atlases are 16 x 16 slots
+#define TERRAIN_PINNED_TILES      4       // levels of at most 4 x 4 pages stay resident
+#define TERRAIN_MIN_SLOTS         32      // the pinned levels (21 pages) and room to stream
+#define TERRAIN_MIN_SIZE          4096    // the flight path must fit
+#define TERRAIN_MAX_TILES         4096    // page ids hold 12 bits per axis
+#define TERRAIN_MAX_LEVELS        13      // of a TERRAIN_MAX_TILES² level 0
+#define TERRAIN_WORKERS           4
+#define TERRAIN_MAX_QUEUED        64      // requests waiting for a worker
+#define TERRAIN_UPLOADS_PER_FRAME 16
+#define TERRAIN_BUDGET_KB         2048    // default bytes queued per frame, --terrain-budget
+#define TERRAIN_WINDOW            1024.0  // world texels across the quad
+#define TERRAIN_PREFETCH_FRAMES   30      // lookahead along the flight
+#define TERRAIN_FLIGHT_RADIUS     1024.0  // circle around the world centre, in texels
+#define TERRAIN_FLIGHT_SPEED      6.0     // texels per frame
+#define TERRAIN_OCTAVES           7       // noise wavelengths 512 down to 8 texels
+#define TERRAIN_WAVELENGTH_SHIFT  9
+#define TERRAIN_NORMAL_RELIEF     64.0f   // height units per texel of slope in the normal set
+
+struct TerrainHeader {
+    char     magic[4];
+    uint32_t version;
+    uint32_t size;              // level 0 texels per side, a power of two
+    uint32_t tileSize;          // TERRAIN_TILE
+    uint32_t border;            // TERRAIN_BORDER
+    uint32_t tilesPerSide;      // level 0 pages per side
+    uint32_t levels;            // down to a single page
+    uint32_t pageBytes;         // TERRAIN_PAGE_BYTES
+    uint64_t dataOffset;        // from the start of the file
+};
+
+struct TerrainTile {
+    int                        page = -1;
+    std::vector<unsigned char> texels;  // TERRAIN_PAGE_BYTES
+    bool                       ok = false;
+};
+
+struct TerrainSlot {
+    int      page = -1;
+    uint32_t lastUsed = 0;      // frame the view last sampled the page, or it was loaded for
+    bool     pinned = false;
+};
+
+struct TerrainStats {
+    uint64_t            queued = 0;         // requests handed to the workers
+    uint64_t            loaded = 0;         // pages uploaded
+    uint64_t            evicted = 0;
+    uint64_t            dropped = 0;        // arrived with every slot in use
+    uint64_t            failed = 0;
+    uint64_t            requestedPixels = 0;    // feedback pixels, summed over resolved lists
+    uint64_t            servedPixels = 0;       // of those, resident at the level asked for
+    double              readMs = 0.0;       // worker time in pread, summed
+    std::vector<double> updateMs;           // render thread per frame, uploads included
+};
+
+struct Terrain {
+    bool                       active = false;
+    TerrainHeader              header = {};
+    std::vector<uint32_t>      levelBase;   // first page of each level
+    std::vector<unsigned char> table;       // the page table texture's texels, level by level
+    std::vector<int16_t>       slotOf;      // per page: atlas slot or -1
+    std::vector<uint8_t>       pending;     // per page: queued or being read
+    std::vector<uint32_t>      wantedFrame; // per page: last frame it was wanted
+    TerrainSlot                slots[TERRAIN_ATLAS_SLOTS * TERRAIN_ATLAS_SLOTS];
+    int                        slotLimit = TERRAIN_ATLAS_SLOTS * TERRAIN_ATLAS_SLOTS;  // in use, --terrain-slots
+    GLuint                     diffuse = 0, height = 0, normal = 0;     // atlases
+    GLuint                     pages = 0;
+    size_t                     budgetBytes = (size_t)TERRAIN_BUDGET_KB * 1024;
+    double                     credit = 0.0;    // bytes that may still be queued
+    int                        inFlight = 0;    // pages queued or read but not uploaded yet
+
+    // Requests from the GPU
+    VtFeedback                 feedback;
+    std::vector<VtRequest>     requests;    // latest resolved feedback
+
+    // Flight: the window's origin and size in level 0 texels
+    uint32_t                   frame = 0;
+    double                     angle = 0.0;
+    float                      window[4] = { 0.0f, 0.0f, (float)TERRAIN_WINDOW, (float)TERRAIN_WINDOW };
+
+    // Loader; the queue and the completions are shared with the workers
+#ifdef _WIN32
+    HANDLE                     file = INVALID_HANDLE_VALUE;
+#else
+    int                        fd = -1;
+#endif
+    std::vector<std::thread>   workers;
+    std::mutex                 lock;
+    std::condition_variable    wake;
+    std::deque<int>            queue;       // front is the most wanted
+    std::deque<TerrainTile>    done;
+    bool                       stop = false;
+    double                     readMs = 0.0;    // under lock, moved to stats each frame
+
+    TerrainStats               stats;
+};
+
+static Terrain terrain;
+
+static int Terrain_LevelTiles(const Terrain& t, int level) { return (int)(t.header.tilesPerSide >> level); }
+
+static int Terrain_Page(const Terrain& t, int level, int x, int y) {
+    return (int)t.levelBase[level] + y * Terrain_LevelTiles(t, level) + x;
+}
+
+// ---- world generation ----------------------------------------------------------------
+static float Terrain_Lattice(int64_t x, int64_t y, int octave) {
+    uint32_t h = (uint32_t)x * 0x8DA6B343u ^ (uint32_t)y * 0xD8163841u ^ (uint32_t)octave * 0xCB1AB31Fu;
+    h ^= h >> 13;
+    h *= 0x5BD1E995u;
+    h ^= h >> 15;
+    return (float)(h & 0xFFFF) / 65535.0f;
+}
+
+// Value noise of wavelength 2^shift texels
+static float Terrain_Noise(float x, float y, int shift, int octave) {
+    float s = 1.0f / (float)(1 << shift);
+    float gx = floorf(x * s), gy = floorf(y * s);
+    float fx = x * s - gx, fy = y * s - gy;
+    fx = fx * fx * (3.0f - 2.0f * fx);
+    fy = fy * fy * (3.0f - 2.0f * fy);
+    int64_t cx = (int64_t)gx, cy = (int64_t)gy;
+    float a = Terrain_Lattice(cx, cy, octave), b = Terrain_Lattice(cx + 1, cy, octave);
+    float c = Terrain_Lattice(cx, cy + 1, octave), d = Terrain_Lattice(cx + 1, cy + 1, octave);
+    float top = a + (b - a) * fx, bottom = c + (d - c) * fx;
+    return top + (bottom - top) * fy;
+}
+
+// Height in [0,1] at a point in level 0 texels from the world centre, for a level
+// whose texels are 2^level wide: octaves shorter than two texels contribute their mean
+static float Terrain_Height(float x, float y, int level) {
+    float sum = 0.0f, amplitude = 0.5f, norm = 0.0f;
+    for (int o = 0; o < TERRAIN_OCTAVES; ++o) {
+        int shift = TERRAIN_WAVELENGTH_SHIFT - o;
+        sum += amplitude * (shift > level ? Terrain_Noise(x, y, shift, o) : 0.5f);
+        norm += amplitude;
+        amplitude *= 0.5f;
+    }
+    float h = (sum / norm - 0.2f) / 0.6f;
+    return h < 0.0f ? 0.0f : h > 1.0f ? 1.0f : h;
+}
+
+static float Terrain_Smoothstep(float e0, float e1, float x) {
+    float t = (x - e0) / (e1 - e0);
+    t = t < 0.0f ? 0.0f : t > 1.0f ? 1.0f : t;
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// Grass to dirt with height, rock on slopes, snow on the peaks
+static void Terrain_Albedo(float h, float slope, float detail, unsigned char rgb[3]) {
+    static const float grass[3] = { 0.24f, 0.30f, 0.16f }, dirt[3] = { 0.45f, 0.42f, 0.30f };
+    static const float rock[3] = { 0.42f, 0.40f, 0.38f }, snow[3] = { 0.85f, 0.85f, 0.88f };
+    float d = Terrain_Smoothstep(0.2f, 0.5f, h), r = Terrain_Smoothstep(0.35f, 0.8f, slope);
+    float s = Terrain_Smoothstep(0.7f, 0.9f, h);
+    for (int c = 0; c < 3; ++c) {
+        float v = grass[c] + (dirt[c] - grass[c]) * d;
+        v += (rock[c] - v) * r;
+        v += (snow[c] - v) * s;
+        v *= detail;
+        rgb[c] = (unsigned char)(std::min(v, 1.0f) * 255.0f + 0.5f);
+    }
+}
+
+// One page of a level: the three sets, aprons included
+static void Terrain_GeneratePage(int size, int level, int tx, int ty, unsigned char* page) {
+    const int n = TERRAIN_SLOT + 2;         // one more texel around for the normals
+    const int levelSize = size >> level;
+    const float span = (float)(1 << level);
+    std::vector<float> h((size_t)n * n);
+    for (int sy = 0; sy < n; ++sy)
+        for (int sx = 0; sx < n; ++sx) {
+            int lx = std::min(std::max(tx * TERRAIN_TILE + sx - TERRAIN_BORDER - 1, 0), levelSize - 1);
+            int ly = std::min(std::max(ty * TERRAIN_TILE + sy - TERRAIN_BORDER - 1, 0), levelSize - 1);
+            h[sy * n + sx] = Terrain_Height((lx + 0.5f) * span - 0.5f - size / 2, (ly + 0.5f) * span - 0.5f - size / 2, level);
+        }
+    const int texels = TERRAIN_SLOT * TERRAIN_SLOT;
+    unsigned char* diffuse = page;
+    unsigned char* height = page + texels * 3;
+    unsigned char* normal = page + texels * 4;
+    for (int sy = 0; sy < TERRAIN_SLOT; ++sy)
+        for (int sx = 0; sx < TERRAIN_SLOT; ++sx) {
+            const float* c = &h[(sy + 1) * n + sx + 1];
+            float dx = (c[1] - c[-1]) / (2.0f * span) * TERRAIN_NORMAL_RELIEF;
+            float dy = (c[n] - c[-n]) / (2.0f * span) * TERRAIN_NORMAL_RELIEF;
+            float inv = 1.0f / sqrtf(dx * dx + dy * dy + 1.0f);
+            int k = sy * TERRAIN_SLOT + sx;
+            int lx = tx * TERRAIN_TILE + sx - TERRAIN_BORDER, ly = ty * TERRAIN_TILE + sy - TERRAIN_BORDER;
+            float detail = level < 2 ? 0.85f + 0.3f * Terrain_Noise((float)lx, (float)ly, 3 - level, TERRAIN_OCTAVES) : 1.0f;
+            Terrain_Albedo(c[0], sqrtf(dx * dx + dy * dy), detail, diffuse + k * 3);
+            height[k] = (unsigned char)(c[0] * 255.0f + 0.5f);
+            normal[k * 2 + 0] = (unsigned char)((-dx * inv * 0.5f + 0.5f) * 255.0f + 0.5f);
+            normal[k * 2 + 1] = (unsigned char)((-dy * inv * 0.5f + 0.5f) * 255.0f + 0.5f);
+        }
+}
+
+// Write a size² world; size is a power of two
+static bool Terrain_Generate(const char* path, int size) {
+    if (size < TERRAIN_MIN_SIZE || size > TERRAIN_MAX_TILES * TERRAIN_TILE || (size & (size - 1))) {
+        fprintf(stderr, "ERROR: terrain size must be a power of two from %d to %d\n", TERRAIN_MIN_SIZE,
+            TERRAIN_MAX_TILES * TERRAIN_TILE);
+        return false;
+    }
+    FILE* f = fopen(path, "wb");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+        return false;
+    }
+    int tiles = size / TERRAIN_TILE, levels = 1;
+    while ((tiles >> (levels - 1)) > 1) ++levels;
+    TerrainHeader h = {};
+    memcpy(h.magic, TERRAIN_MAGIC, 4);
+    h.version = TERRAIN_VERSION;
+    h.size = (uint32_t)size;
+    h.tileSize = TERRAIN_TILE;
+    h.border = TERRAIN_BORDER;
+    h.tilesPerSide = (uint32_t)tiles;
+    h.levels = (uint32_t)levels;
+    h.pageBytes = TERRAIN_PAGE_BYTES;
+    h.dataOffset = sizeof(TerrainHeader);
+    bool ok = fwrite(&h, sizeof(h), 1, f) == 1;
+
+    // One row of pages at a time, the pages of a row in parallel
+    std::vector<unsigned char> row((size_t)TERRAIN_PAGE_BYTES * tiles);
+    for (int level = 0; level < levels && ok; ++level) {
+        int n = tiles >> level;
+        for (int ty = 0; ty < n && ok; ++ty) {
+            Parallel_Rows(n, [&](int tx) {
+                Terrain_GeneratePage(size, level, tx, ty, &row[(size_t)TERRAIN_PAGE_BYTES * tx]);
+            });
+            ok = fwrite(row.data(), 1, (size_t)TERRAIN_PAGE_BYTES * n, f) == (size_t)TERRAIN_PAGE_BYTES * n;
+            if (level == 0 && (ty + 1) % std::max(n / 8, 1) == 0) fprintf(stdout, "Terrain: %d/%d level 0 page rows\n", ty + 1, n);
+        }
+    }
+    ok = fclose(f) == 0 && ok;
+    if (!ok) fprintf(stderr, "ERROR: cannot write '%s'\n", path);
+    return ok;
+}
+
+// ---- loader --------------------------------------------------------------------------
+static bool Terrain_ReadAt(Terrain& t, uint64_t offset, void* dst, size_t bytes) {
+#ifdef _WIN32
+    OVERLAPPED at = {};
+    at.Offset = (DWORD)offset;
+    at.OffsetHigh = (DWORD)(offset >> 32);
+    DWORD got = 0;
+    return ReadFile(t.file, dst, (DWORD)bytes, &got, &at) && got == bytes;
+#else
+    return pread(t.fd, dst, bytes, (off_t)offset) == (ssize_t)bytes;
+#endif
+}
+
+static void Terrain_Worker(Terrain& t, int index) {
+    char name[32];
+    snprintf(name, sizeof(name), "terrain loader %d", index);
+    Profiler_SetThreadName(name);
+    for (;;) {
+        TerrainTile tile;
+        {
+            std::unique_lock<std::mutex> hold(t.lock);
+            t.wake.wait(hold, [&]() { return t.stop || !t.queue.empty(); });
+            if (t.stop) return;
+            tile.page = t.queue.front();
+            t.queue.pop_front();
+        }
+        auto start = std::chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("terrain pread");
+            tile.texels.resize(TERRAIN_PAGE_BYTES);
+            tile.ok = Terrain_ReadAt(t, t.header.dataOffset + (uint64_t)TERRAIN_PAGE_BYTES * tile.page,
+                                     tile.texels.data(), TERRAIN_PAGE_BYTES);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> hold(t.lock);
+        t.readMs += ms;
+        t.done.push_back(std::move(tile));
+    }
+}
+
+// ---- page table ----------------------------------------------------------------------
+// Point page (level, x, y) and every finer entry under it that maps to this level or a
+// coarser one at entry[]; upload the changed rectangles
+static void Terrain_MapSubtree(Terrain& t, int level, int x, int y, const unsigned char entry[4]) {
+    PROFILE_SCOPE("Terrain_MapSubtree");
+    glBindTexture(GL_TEXTURE_2D, t.pages);
+    for (int k = level; k >= 0; --k) {
+        int span = 1 << (level - k), n = Terrain_LevelTiles(t, k);
+        unsigned char* rect = &t.table[((size_t)t.levelBase[k] + (size_t)y * span * n + (size_t)x * span) * 4];
+        for (int j = 0; j < span; ++j)
+            for (int i = 0; i < span; ++i) {
+                unsigned char* e = rect + ((size_t)j * n + i) * 4;
+                if (e[2] >= level) memcpy(e, entry, 4);
+            }
+        glPixelStorei(GL_UNPACK_ROW_LENGTH, n);
+        glTexSubImage2D(GL_TEXTURE_2D, k, x * span, y * span, span, span, GL_RGBA, GL_UNSIGNED_BYTE, rect);
+    }
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+}
+
+// An empty slot, else the least recently used unpinned one the view did not sample this frame,
+// preferring pages not wanted at all this frame; -1 if there is none
+static int Terrain_FreeSlot(Terrain& t) {
+    int best = -1;
+    bool bestWanted = true;
+    for (int s = 0; s < t.slotLimit; ++s) {
+        const TerrainSlot& slot = t.slots[s];
+        if (slot.page < 0) return s;
+        if (slot.pinned || slot.lastUsed >= t.frame) continue;
+        bool wanted = t.wantedFrame[slot.page] == t.frame;
+        if (best < 0 || wanted < bestWanted || (wanted == bestWanted && slot.lastUsed < t.slots[best].lastUsed)) {
+            best = s;
+            bestWanted = wanted;
+        }
+    }
+    return best;
+}
+
+static void Terrain_PageCoords(const Terrain& t, int page, int& level, int& x, int& y) {
+    level = 0;
+    while (level + 1 < (int)t.header.levels && page >= (int)t.levelBase[level + 1]) ++level;
+    int n = Terrain_LevelTiles(t, level), i = page - (int)t.levelBase[level];
+    x = i % n;
+    y = i / n;
+}
+
+static void Terrain_Upload(Terrain& t, TerrainTile& tile, bool pin) {
+    t.pending[tile.page] = 0;
+    --t.inFlight;
+    if (!tile.ok) {
+        ++t.stats.failed;
+        return;
+    }
+    int slot = Terrain_FreeSlot(t);
+    if (slot < 0) {
+        ++t.stats.dropped;
+        return;
+    }
+    int level, x, y;
+    if (t.slots[slot].page >= 0) {
+        // The evicted page's entries fall back to its parent's mapping
+        int old = t.slots[slot].page;
+        Terrain_PageCoords(t, old, level, x, y);
+        t.slotOf[old] = -1;
+        Terrain_MapSubtree(t, level, x, y, &t.table[(size_t)Terrain_Page(t, level + 1, x / 2, y / 2) * 4]);
+        ++t.stats.evicted;
+    }
+    t.slots[slot].page = tile.page;
+    t.slots[slot].lastUsed = t.wantedFrame[tile.page];
+    t.slots[slot].pinned = pin;
+    t.slotOf[tile.page] = (int16_t)slot;
+
+    int sx = (slot % TERRAIN_ATLAS_SLOTS) * TERRAIN_SLOT, sy = (slot / TERRAIN_ATLAS_SLOTS) * TERRAIN_SLOT;
+    const unsigned char* texels = tile.texels.data();
+    const int setTexels = TERRAIN_SLOT * TERRAIN_SLOT;
+    glBindTexture(GL_TEXTURE_2D, t.diffuse);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, sx, sy, TERRAIN_SLOT, TERRAIN_SLOT, GL_RGB, GL_UNSIGNED_BYTE, texels);
+    glBindTexture(GL_TEXTURE_2D, t.height);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, sx, sy, TERRAIN_SLOT, TERRAIN_SLOT, GL_RED, GL_UNSIGNED_BYTE, texels + setTexels * 3);
+    glBindTexture(GL_TEXTURE_2D, t.normal);
+    glTexSubImage2D(GL_TEXTURE_2D, 0, sx, sy, TERRAIN_SLOT, TERRAIN_SLOT, GL_RG, GL_UNSIGNED_BYTE, texels + setTexels * 4);
+
+    Terrain_PageCoords(t, tile.page, level, x, y);
+    unsigned char entry[4] = { (unsigned char)(slot % TERRAIN_ATLAS_SLOTS), (unsigned char)(slot / TERRAIN_ATLAS_SLOTS),
+                               (unsigned char)level, 255 };
+    Terrain_MapSubtree(t, level, x, y, entry);
+    ++t.stats.loaded;
+}
+
+// Upload finished pages, at most max of them (all with max < 0)
+static void Terrain_Drain(Terrain& t, int max, bool pin = false) {
+    std::deque<TerrainTile> arrived;
+    {
+        std::lock_guard<std::mutex> hold(t.lock);
+        size_t n = max < 0 ? t.done.size() : std::min(t.done.size(), (size_t)max);
+        for (size_t k = 0; k < n; ++k) {
+            arrived.push_back(std::move(t.done.front()));
+            t.done.pop_front();
+        }
+        t.stats.readMs += t.readMs;
+        t.readMs = 0.0;
+    }
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    for (size_t k = 0; k < arrived.size(); ++k) Terrain_Upload(t, arrived[k], pin);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+}
+
+// ---- streaming -----------------------------------------------------------------------
+// Pages of a level overlapping a square around (cx, cy), nearest first, not wanted yet
+static void Terrain_WantSquare(Terrain& t, int level, double cx, double cy, double half, std::vector<int>& wanted) {
+    int n = Terrain_LevelTiles(t, level);
+    double size = (double)TERRAIN_TILE * (1 << level);
+    int x0 = std::max((int)floor((cx - half) / size), 0), x1 = std::min((int)floor((cx + half) / size), n - 1);
+    int y0 = std::max((int)floor((cy - half) / size), 0), y1 = std::min((int)floor((cy + half) / size), n - 1);
+    std::vector<std::pair<double, int>> found;
+    for (int y = y0; y <= y1; ++y)
+        for (int x = x0; x <= x1; ++x) {
+            int page = Terrain_Page(t, level, x, y);
+            if (t.wantedFrame[page] == t.frame) continue;
+            t.wantedFrame[page] = t.frame;
+            double dx = (x + 0.5) * size - cx, dy = (y + 0.5) * size - cy;
+            found.push_back(std::make_pair(dx * dx + dy * dy, page));
+        }
+    std::sort(found.begin(), found.end());
+    for (size_t k = 0; k < found.size(); ++k) wanted.push_back(found[k].second);
+}
+
+// Window centre on the flight circle at an angle
+static void Terrain_FlightPoint(const Terrain& t, double angle, double& x, double& y) {
+    x = t.header.size * 0.5 + TERRAIN_FLIGHT_RADIUS * cos(angle);
+    y = t.header.size * 0.5 + TERRAIN_FLIGHT_RADIUS * sin(angle);
+}
+
+// Hand the missing wanted pages to the loaders, most wanted first, within the budget and no
+// more in flight than there are slots to take them: a page read with nowhere to go is dropped.
+// The first `requested` pages may take any slot the view did not sample this frame, the rest
+// (ancestors, prefetch) only slots holding pages not wanted at all, or they evict each other.
+static void Terrain_Queue(Terrain& t, const std::vector<int>& wanted, size_t requested, bool budgeted) {
+    {
+        std::lock_guard<std::mutex> hold(t.lock);
+        for (size_t k = 0; k < t.queue.size(); ++k) t.pending[t.queue[k]] = 0;
+        t.credit += (double)t.queue.size() * TERRAIN_PAGE_BYTES;   // not started: refund
+        t.inFlight -= (int)t.queue.size();
+        t.queue.clear();
+        int room = -t.inFlight, spare = -t.inFlight;
+        for (int s = 0; s < t.slotLimit; ++s) {
+            const TerrainSlot& slot = t.slots[s];
+            room += slot.page < 0 || (!slot.pinned && slot.lastUsed < t.frame);
+            spare += slot.page < 0 || (!slot.pinned && t.wantedFrame[slot.page] < t.frame);
+        }
+        for (size_t k = 0; k < wanted.size() && t.queue.size() < TERRAIN_MAX_QUEUED; ++k) {
+            if ((int)t.queue.size() >= (k < requested ? room : spare)) break;
+            int page = wanted[k];
+            if (t.slotOf[page] >= 0 || t.pending[page]) continue;
+            if (budgeted && t.credit < TERRAIN_PAGE_BYTES) break;
+            if (budgeted) t.credit -= TERRAIN_PAGE_BYTES;
+            t.pending[page] = 1;
+            t.queue.push_back(page);
+            ++t.inFlight;
+            ++t.stats.queued;
+        }
+    }
+    t.wake.notify_all();
+}
+
+// Once per frame, before the steep pass
+static void Terrain_Update(Terrain& t) {
+    PROFILE_SCOPE("Terrain_Update");
+    auto start = std::chrono::steady_clock::now();
+    ++t.frame;
+    t.angle += TERRAIN_FLIGHT_SPEED / TERRAIN_FLIGHT_RADIUS;
+    double cx, cy, ax, ay;
+    Terrain_FlightPoint(t, t.angle, cx, cy);
+    Terrain_FlightPoint(t, t.angle + TERRAIN_PREFETCH_FRAMES * TERRAIN_FLIGHT_SPEED / TERRAIN_FLIGHT_RADIUS, ax, ay);
+    t.window[0] = (float)(cx - TERRAIN_WINDOW * 0.5);
+    t.window[1] = (float)(cy - TERRAIN_WINDOW * 0.5);
+    bool fresh = VtFeedback_Poll(t.feedback, t.requests);
+
+    // Requested pages by pixels times the levels between them and what stands in for them. Without
+    // a new list the last one is ranked again (it keeps its pages in use) but not counted again.
+    std::vector<std::pair<double, int>> ranked;
+    int finest = (int)t.header.levels - 1;
+    for (size_t k = 0; k < t.requests.size(); ++k) {
+        uint32_t id = t.requests[k].id;
+        int level = VtFeedback_Level(id), x = VtFeedback_X(id), y = VtFeedback_Y(id);
+        if (level >= (int)t.header.levels || x >= Terrain_LevelTiles(t, level) || y >= Terrain_LevelTiles(t, level)) continue;
+        int page = Terrain_Page(t, level, x, y);
+        if (t.wantedFrame[page] == t.frame) continue;
+        t.wantedFrame[page] = t.frame;
+        int gap = t.table[(size_t)page * 4 + 2] - level;
+        if (fresh) {
+            t.stats.requestedPixels += t.requests[k].pixels;
+            if (gap == 0) t.stats.servedPixels += t.requests[k].pixels;
+        }
+        ranked.push_back(std::make_pair(-(double)t.requests[k].pixels * (1 << std::min(gap, 16)), page));
+        finest = std::min(finest, level);
+    }
+    std::sort(ranked.begin(), ranked.end());
+    std::vector<int> wanted;
+    for (size_t k = 0; k < ranked.size(); ++k) wanted.push_back(ranked[k].second);
+
+    // Their ancestors keep the fallbacks resident; then the window ahead at the finest level asked for
+    size_t requested = wanted.size();
+    for (size_t k = 0; k < requested; ++k) {
+        int level, x, y;
+        Terrain_PageCoords(t, wanted[k], level, x, y);
+        while (++level < (int)t.header.levels) {
+            x /= 2;
+            y /= 2;
+            int page = Terrain_Page(t, level, x, y);
+            if (t.wantedFrame[page] == t.frame) break;
+            t.wantedFrame[page] = t.frame;
+            wanted.push_back(page);
+        }
+    }
+    if (requested) Terrain_WantSquare(t, finest, ax, ay, TERRAIN_WINDOW * 0.5, wanted);
+    // Only what the view samples is kept from eviction; ancestors and prefetch load into the rest
+    for (size_t k = 0; k < requested; ++k)
+        if (t.slotOf[wanted[k]] >= 0) t.slots[t.slotOf[wanted[k]]].lastUsed = t.frame;
+
+    Terrain_Drain(t, TERRAIN_UPLOADS_PER_FRAME);
+    t.credit = std::min(t.credit + (double)t.budgetBytes, 4.0 * t.budgetBytes);
+    Terrain_Queue(t, wanted, requested, true);
+    t.stats.updateMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+}
+
+// ---- setup ---------------------------------------------------------------------------
+static void Terrain_Close(Terrain& t) {
+    {
+        std::lock_guard<std::mutex> hold(t.lock);
+        t.stop = true;
+    }
+    t.wake.notify_all();
+    for (size_t k = 0; k < t.workers.size(); ++k) t.workers[k].join();
+    t.workers.clear();
+#ifdef _WIN32
+    if (t.file != INVALID_HANDLE_VALUE) CloseHandle(t.file);
+    t.file = INVALID_HANDLE_VALUE;
+#else
+    if (t.fd >= 0) close(t.fd);
+    t.fd = -1;
+#endif
+    VtFeedback_Shutdown(t.feedback);
+    GLuint* textures[4] = { &t.diffuse, &t.height, &t.normal, &t.pages };
+    for (int k = 0; k < 4; ++k) {
+        if (!*textures[k]) continue;
+        GpuMem_Release(GPUMEM_TEXTURE, *textures[k]);
+        glDeleteTextures(1, textures[k]);
+        *textures[k] = 0;
+    }
+    t.active = false;
+}
+
+static GLuint Terrain_CreateAtlas(GLenum internalFormat, GLenum format, int bytesPerTexel, const char* name) {
+    const int size = TERRAIN_ATLAS_SLOTS * TERRAIN_SLOT;
+    std::vector<unsigned char> zero((size_t)size * size * bytesPerTexel, 0);
+    GLuint id = 0;
+    glGenTextures(1, &id);
+    glBindTexture(GL_TEXTURE_2D, id);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, size, size, 0, format, GL_UNSIGNED_BYTE, zero.data());
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    GpuMem_Track(GPUMEM_TEXTURE, id, GPUMEM_MATERIAL, name, GpuMem_TextureBytes(size, size, bytesPerTexel == 3 ? 4 : bytesPerTexel));
+    return id;
+}
+
+// Open a world, create the atlases and the page table, start the loaders and the
+// feedback resolver and load the pinned levels
+static bool Terrain_Open(Terrain& t, const char* path) {
+    PROFILE_SCOPE("Terrain_Open");
+    uint64_t fileSize = 0;
+#ifdef _WIN32
+    t.file = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_RANDOM_ACCESS, NULL);
+    LARGE_INTEGER size;
+    bool opened = t.file != INVALID_HANDLE_VALUE && GetFileSizeEx(t.file, &size);
+    if (opened) fileSize = (uint64_t)size.QuadPart;
+#else
+    t.fd = open(path, O_RDONLY);
+    struct stat st;
+    bool opened = t.fd >= 0 && fstat(t.fd, &st) == 0;
+    if (opened) fileSize = (uint64_t)st.st_size;
+#endif
+    if (!opened) {
+        fprintf(stderr, "ERROR: cannot open terrain '%s'\n", path);
+        Terrain_Close(t);
+        return false;
+    }
+    TerrainHeader& h = t.header;
+    bool valid = fileSize >= sizeof(h) && Terrain_ReadAt(t, 0, &h, sizeof(h)) && memcmp(h.magic, TERRAIN_MAGIC, 4) == 0 &&
+                 h.version == TERRAIN_VERSION && h.tileSize == TERRAIN_TILE && h.border == TERRAIN_BORDER &&
+                 h.pageBytes == TERRAIN_PAGE_BYTES && h.size >= TERRAIN_MIN_SIZE && h.tilesPerSide * TERRAIN_TILE == h.size &&
+                 h.tilesPerSide <= TERRAIN_MAX_TILES && (h.tilesPerSide & (h.tilesPerSide - 1)) == 0 &&
+                 h.levels >= 1 && h.levels <= TERRAIN_MAX_LEVELS && (h.tilesPerSide >> (h.levels - 1)) == 1 &&
+                 h.dataOffset >= sizeof(TerrainHeader) && h.dataOffset <= fileSize;
+    size_t pages = 0;
+    t.levelBase.clear();
+    for (uint32_t level = 0; valid && level < h.levels; ++level) {
+        t.levelBase.push_back((uint32_t)pages);
+        pages += (size_t)(h.tilesPerSide >> level) * (h.tilesPerSide >> level);
+    }
+    if (!valid || fileSize < h.dataOffset + (uint64_t)pages * TERRAIN_PAGE_BYTES) {
+        fprintf(stderr, "ERROR: '%s' is not a terrain this build can read (regenerate it with --terrain-gen)\n", path);
+        Terrain_Close(t);
+        return false;
+    }
+    t.slotOf.assign(pages, -1);
+    t.pending.assign(pages, 0);
+    t.wantedFrame.assign(pages, 0);
+
+    // Atlases, cleared; bilinear inside a slot, the aprons make the seams exact
+    t.diffuse = Terrain_CreateAtlas(GL_RGB8, GL_RGB, 3, "terrain diffuse atlas");
+    t.height = Terrain_CreateAtlas(GL_R8, GL_RED, 1, "terrain height atlas");
+    t.normal = Terrain_CreateAtlas(GL_RG8, GL_RG, 2, "terrain normal atlas");
+
+    // Page table, one level per pyramid level; nothing resident yet (level 255)
+    t.table.assign(pages * 4, 0);
+    for (size_t k = 0; k < pages; ++k) t.table[k * 4 + 2] = t.table[k * 4 + 3] = 255;
+    glGenTextures(1, &t.pages);
+    glBindTexture(GL_TEXTURE_2D, t.pages);
+    for (uint32_t level = 0; level < h.levels; ++level) {
+        int n = (int)(h.tilesPerSide >> level);
+        glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, n, n, 0, GL_RGBA, GL_UNSIGNED_BYTE, &t.table[(size_t)t.levelBase[level] * 4]);
+    }
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, h.levels - 1);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    GpuMem_Track(GPUMEM_TEXTURE, t.pages, GPUMEM_MATERIAL, "terrain page table",
+                 GpuMem_TextureBytes(h.tilesPerSide, h.tilesPerSide, 4, true));
+
+    t.stop = false;
+    for (int k = 0; k < TERRAIN_WORKERS; ++k) t.workers.push_back(std::thread(Terrain_Worker, std::ref(t), k));
+    VtFeedback_Init(t.feedback);
+    t.active = true;
+
+    // Pinned levels, coarsest first, ignoring the budget
+    std::vector<int> pinned;
+    for (int level = (int)h.levels - 1; level >= 0 && Terrain_LevelTiles(t, level) <= TERRAIN_PINNED_TILES; --level)
+        for (int y = 0; y < Terrain_LevelTiles(t, level); ++y)
+            for (int x = 0; x < Terrain_LevelTiles(t, level); ++x) pinned.push_back(Terrain_Page(t, level, x, y));
+    for (size_t loaded = 0; loaded < pinned.size();) {
+        Terrain_Queue(t, pinned, pinned.size(), false);
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        Terrain_Drain(t, -1, true);
+        loaded = 0;
+        for (size_t k = 0; k < pinned.size(); ++k) loaded += t.slotOf[pinned[k]] >= 0;
+        // A page that failed to read or found no slot is not queued again: stop rather than wait forever
+        if (t.stats.failed || t.stats.dropped) {
+            fprintf(stderr, "ERROR: cannot %s the pinned levels of '%s'\n", t.stats.failed ? "read" : "place", path);
+            Terrain_Close(t);
+            return false;
+        }
+    }
+    t.credit = 0.0;
+    double cx, cy;
+    Terrain_FlightPoint(t, t.angle, cx, cy);
+    t.window[0] = (float)(cx - TERRAIN_WINDOW * 0.5);
+    t.window[1] = (float)(cy - TERRAIN_WINDOW * 0.5);
+    return true;
+}
+
+// Defines of the steep and feedback shaders' terrain builds
+static std::string Terrain_ShaderDefines() {
+    char buf[160];
+    snprintf(buf, sizeof(buf), "#define TERRAIN 1\n#define TERRAIN_TILE %.1f\n#define TERRAIN_BORDER %.1f\n#define TERRAIN_SLOT %.1f\n",
+        (double)TERRAIN_TILE, (double)TERRAIN_BORDER, (double)TERRAIN_SLOT);
+    return buf;
+}
+
+// Atlases on units 3-5, the page table on 6 and the window, for the steep program
+static void Terrain_Bind(const Terrain& t, GLuint prog) {
+    glUniform1i(glGetUniformLocation(prog, "terrainDiffuse"), 3);
+    glUniform1i(glGetUniformLocation(prog, "terrainHeight"), 4);
+    glUniform1i(glGetUniformLocation(prog, "terrainNormal"), 5);
+    glUniform1i(glGetUniformLocation(prog, "terrainPages"), 6);
+    glUniform1i(glGetUniformLocation(prog, "terrainLevels"), (GLint)t.header.levels);
+    glUniform4fv(glGetUniformLocation(prog, "terrainWindow"), 1, t.window);
+    const GLuint textures[4] = { t.diffuse, t.height, t.normal, t.pages };
+    for (int k = 0; k < 4; ++k) {
+        glActiveTexture(GL_TEXTURE3 + k);
+        glBindTexture(GL_TEXTURE_2D, textures[k]);
+    }
+    glActiveTexture(GL_TEXTURE0);
+}
+
+// Window and pyramid for psTerrainFeedback.glsl, whose pixels are VT_FEEDBACK_SCALE view pixels wide
+static void Terrain_BindFeedback(const Terrain& t, GLuint prog) {
+    glUniform1i(glGetUniformLocation(prog, "terrainLevels"), (GLint)t.header.levels);
+    glUniform1i(glGetUniformLocation(prog, "terrainTiles"), (GLint)t.header.tilesPerSide);
+    glUniform1f(glGetUniformLocation(prog, "terrainLodBias"), -log2f((float)VT_FEEDBACK_SCALE));
+    glUniform4fv(glGetUniformLocation(prog, "terrainWindow"), 1, t.window);
+}
+
+static void Terrain_Print(const Terrain& t, FILE* f) {
+    const TerrainStats& s = t.stats;
+    StatSummary u = summarize(s.updateMs);
+    size_t pinned = 0;
+    for (int k = 0; k < t.slotLimit; ++k) pinned += t.slots[k].pinned;
+    fprintf(f, "Terrain: %ux%u texels, %u levels, %zu pages of %d^2 (%d KB each), %d atlas slots, %zu pinned\n",
+        t.header.size, t.header.size, t.header.levels, t.slotOf.size(), TERRAIN_TILE, TERRAIN_PAGE_BYTES / 1024,
+        t.slotLimit, pinned);
+    fprintf(f, "Terrain: %llu pages loaded (%.1f MB, %.3f ms pread each, budget %zu KB/frame), %llu evicted, "
+               "%llu dropped, %llu failed\n",
+        (unsigned long long)s.loaded, s.loaded * (double)TERRAIN_PAGE_BYTES / (1024.0 * 1024.0),
+        s.loaded ? s.readMs / s.loaded : 0.0, t.budgetBytes / 1024, (unsigned long long)s.evicted,
+        (unsigned long long)s.dropped, (unsigned long long)s.failed);
+    fprintf(f, "Terrain: %.2f%% of %llu requested pixels served at the level they asked for\n",
+        s.requestedPixels ? 100.0 * s.servedPixels / s.requestedPixels : 0.0, (unsigned long long)s.requestedPixels);
+    fprintf(f, "Terrain: streaming update %.3f ms median, %.3f ms p95, %.3f ms max over %d frames\n",
+        u.p50, u.p95, u.max, u.count);
+    VtFeedback_Print(t.feedback, f);
+}
+
+#endif //__TERRAIN_H__
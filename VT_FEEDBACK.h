@@ -0,0 +1,333 @@
+//**************************************************************************************
+// File VT_FEEDBACK.h
+// GPU feedback for virtual texturing: which pages the last frames sampled,
+// at which mip level, gathered without stalling the render loop.
+//
+// The caller draws the view a second time between VtFeedback_Begin() and
+// VtFeedback_End() at 1/VT_FEEDBACK_SCALE of its size, into an R32UI target
+// cleared to VT_FEEDBACK_NONE, with a shader that writes a packed page id
+// per pixel (level << 24 | y << 12 | x). End() starts a readback into one of
+// VT_FEEDBACK_RING pixel-pack buffers and fences it, like CAPTURE.h.
+// VtFeedback_Poll() maps the newest signalled buffer and hands it to the
+// resolver thread, which reduces it to the unique pages with their pixel
+// counts, most requested first; Poll() returns that list once it is ready.
+// Readbacks that arrive while the resolver is busy are dropped: the next one
+// is newer anyway.
+//
+// The resolver collapses runs of equal ids first, four at a time with SSE2
+// (neighbouring pixels nearly always want the same page), and counts only
+// the run heads in a small open-addressing histogram.
+//**************************************************************************************
+#ifndef __VT_FEEDBACK_H__
+#define __VT_FEEDBACK_H__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "GL_DEBUG.h"
+#include "GPU_MEMORY.h"
+#include "PROFILER.h"
+#include "STATS.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define VT_FEEDBACK_SSE2 1
+#include <emmintrin.h>
+#else
+#define VT_FEEDBACK_SSE2 0
+#endif
+
+#define VT_FEEDBACK_SCALE 8             // feedback pixels are 8x8 view pixels
+#define VT_FEEDBACK_RING  3             // pixel-pack buffers in flight
+#define VT_FEEDBACK_NONE  0xFFFFFFFFu   // clear value: no page
+
+static inline uint32_t VtFeedback_PageId(int level, int x, int y) {
+    return (uint32_t)level << 24 | (uint32_t)y << 12 | (uint32_t)x;
+}
+static inline int VtFeedback_Level(uint32_t id) { return (int)(id >> 24); }
+static inline int VtFeedback_X(uint32_t id) { return (int)(id & 0xFFF); }
+static inline int VtFeedback_Y(uint32_t id) { return (int)(id >> 12 & 0xFFF); }
+
+struct VtRequest {
+    uint32_t id;
+    uint32_t pixels;            // feedback pixels that sampled the page
+};
+
+struct VtFeedbackSlot {
+    GLuint pbo = 0;
+    GLsync fence = 0;           // 0 = free
+    int    width = 0, height = 0;
+};
+
+struct VtFeedback {
+    bool           active = false;
+    GLuint         fbo = 0, color = 0, depth = 0;
+    int            width = 0, height = 0;
+    VtFeedbackSlot slots[VT_FEEDBACK_RING];
+    int            next = 0;
+    GLint          savedDraw = 0, savedRead = 0, savedViewport[4] = { 0, 0, 0, 0 };
+    std::vector<uint32_t> mapped;       // render thread: last harvested readback
+
+    // Resolver; input and output are shared with it
+    std::thread            resolver;
+    std::mutex             lock;
+    std::condition_variable wake;
+    std::vector<uint32_t>  input;
+    bool                   inputReady = false;
+    std::vector<VtRequest> output;
+    bool                   outputReady = false;
+    bool                   stop = false;
+
+    uint64_t               readbacks = 0;
+    uint64_t               ringFull = 0;    // frames without a feedback readback
+    uint64_t               resolverBusy = 0;
+    uint64_t               resolved = 0;
+    uint64_t               uniquePages = 0; // summed over resolves
+    std::vector<double>    resolveMs;
+};
+
+// Unique ids of n feedback pixels with their pixel counts, most pixels first
+static void VtFeedback_Resolve(const uint32_t* ids, size_t n, std::vector<VtRequest>& out) {
+    // Open-addressing histogram, at most half full
+    size_t capacity = 1024;
+    while (capacity < 2 * n) capacity <<= 1;
+    std::vector<VtRequest> table(capacity, VtRequest{ VT_FEEDBACK_NONE, 0 });
+    auto add = [&](uint32_t id, uint32_t count) {
+        if (id == VT_FEEDBACK_NONE) return;
+        size_t h = (id * 0x9E3779B1u) & (capacity - 1);
+        while (table[h].id != id && table[h].id != VT_FEEDBACK_NONE) h = (h + 1) & (capacity - 1);
+        table[h].id = id;
+        table[h].pixels += count;
+    };
+
+    // Run-length collapse: only a pixel that differs from its predecessor starts a new entry
+    uint32_t run = n ? ids[0] : VT_FEEDBACK_NONE, length = 0;
+    size_t i = 0;
+#if VT_FEEDBACK_SSE2
+    for (; i + 4 <= n; i += 4) {
+        __m128i cur = _mm_loadu_si128((const __m128i*)(ids + i));
+        __m128i same = _mm_cmpeq_epi32(cur, _mm_set1_epi32((int)run));
+        if (_mm_movemask_epi8(same) == 0xFFFF) {
+            length += 4;
+            continue;
+        }
+        for (size_t k = i; k < i + 4; ++k) {
+            if (ids[k] == run) {
+                ++length;
+                continue;
+            }
+            add(run, length);
+            run = ids[k];
+            length = 1;
+        }
+    }
+#endif
+    for (; i < n; ++i) {
+        if (ids[i] == run) {
+            ++length;
+            continue;
+        }
+        add(run, length);
+        run = ids[i];
+        length = 1;
+    }
+    if (length) add(run, length);
+
+    out.clear();
+    for (size_t k = 0; k < capacity; ++k)
+        if (table[k].id != VT_FEEDBACK_NONE) out.push_back(table[k]);
+    std::sort(out.begin(), out.end(), [](const VtRequest& a, const VtRequest& b) {
+        return a.pixels != b.pixels ? a.pixels > b.pixels : a.id < b.id;
+    });
+}
+
+static void VtFeedback_ResolverLoop(VtFeedback& fb) {
+    Profiler_SetThreadName("vt resolver");
+    std::vector<uint32_t> ids;
+    std::vector<VtRequest> requests;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> hold(fb.lock);
+            fb.wake.wait(hold, [&]() { return fb.stop || fb.inputReady; });
+            if (fb.stop) return;
+            ids.swap(fb.input);
+            fb.inputReady = false;
+        }
+        auto start = std::chrono::steady_clock::now();
+        {
+            PROFILE_SCOPE("VtFeedback_Resolve");
+            VtFeedback_Resolve(ids.data(), ids.size(), requests);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        std::lock_guard<std::mutex> hold(fb.lock);
+        fb.output.swap(requests);
+        fb.outputReady = true;
+        fb.resolveMs.push_back(ms);
+        fb.uniquePages += fb.output.size();
+        ++fb.resolved;
+    }
+}
+
+static void VtFeedback_Init(VtFeedback& fb) {
+    for (VtFeedbackSlot& s : fb.slots) {
+        glGenBuffers(1, &s.pbo);
+        GLDebug_Label(GL_BUFFER, s.pbo, "vt feedback PBO");
+    }
+    glGenFramebuffers(1, &fb.fbo);
+    glGenRenderbuffers(1, &fb.color);
+    glGenRenderbuffers(1, &fb.depth);
+    fb.stop = false;
+    fb.resolver = std::thread(VtFeedback_ResolverLoop, std::ref(fb));
+    fb.active = true;
+}
+
+// (Re)size the target to a view of viewW x viewH pixels
+static bool VtFeedback_Resize(VtFeedback& fb, int viewW, int viewH) {
+    int w = std::max(viewW / VT_FEEDBACK_SCALE, 1), h = std::max(viewH / VT_FEEDBACK_SCALE, 1);
+    if (w == fb.width && h == fb.height) return true;
+    fb.width = w;
+    fb.height = h;
+    glBindRenderbuffer(GL_RENDERBUFFER, fb.color);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_R32UI, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, fb.depth);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, w, h);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+    GpuMem_Track(GPUMEM_RENDERBUFFER, fb.color, GPUMEM_RENDER_TARGET, "vt feedback", (size_t)w * h * 4);
+    GpuMem_Track(GPUMEM_RENDERBUFFER, fb.depth, GPUMEM_RENDER_TARGET, "vt feedback depth", (size_t)w * h * 4);
+
+    GLint saved = 0;
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &saved);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb.fbo);
+    glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, fb.color);
+    glFramebufferRenderbuffer(GL_DRAW_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, fb.depth);
+    GLenum status = glCheckFramebufferStatus(GL_DRAW_FRAMEBUFFER);
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, saved);
+    if (status != GL_FRAMEBUFFER_COMPLETE) {
+        fprintf(stderr, "ERROR: VT feedback framebuffer incomplete (0x%04X)\n", status);
+        return false;
+    }
+    return true;
+}
+
+// Redirect drawing to the feedback target of a viewW x viewH view
+static bool VtFeedback_Begin(VtFeedback& fb, int viewW, int viewH) {
+    if (!fb.active || !VtFeedback_Resize(fb, viewW, viewH)) return false;
+    if (fb.slots[fb.next].fence) {
+        ++fb.ringFull;          // every buffer still in flight: skip this frame's feedback
+        return false;
+    }
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &fb.savedDraw);
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &fb.savedRead);
+    glGetIntegerv(GL_VIEWPORT, fb.savedViewport);
+    glBindFramebuffer(GL_FRAMEBUFFER, fb.fbo);
+    glViewport(0, 0, fb.width, fb.height);
+    glDisable(GL_SCISSOR_TEST);
+    const GLuint none[4] = { VT_FEEDBACK_NONE, 0, 0, 0 };
+    glClearBufferuiv(GL_COLOR, 0, none);
+    glClear(GL_DEPTH_BUFFER_BIT);
+    return true;
+}
+
+// Start the readback of what was drawn since Begin() and restore the caller's target
+static void VtFeedback_End(VtFeedback& fb) {
+    VtFeedbackSlot& s = fb.slots[fb.next];
+    size_t bytes = (size_t)fb.width * fb.height * 4;
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+    if (s.width != fb.width || s.height != fb.height) {
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)bytes, nullptr, GL_STREAM_READ);
+        GpuMem_Track(GPUMEM_BUFFER, s.pbo, GPUMEM_STAGING, "vt feedback ring", bytes);
+        s.width = fb.width;
+        s.height = fb.height;
+    }
+    glPixelStorei(GL_PACK_ALIGNMENT, 4);
+    glReadPixels(0, 0, fb.width, fb.height, GL_RED_INTEGER, GL_UNSIGNED_INT, nullptr);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    s.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    fb.next = (fb.next + 1) % VT_FEEDBACK_RING;
+    ++fb.readbacks;
+
+    glBindFramebuffer(GL_DRAW_FRAMEBUFFER, fb.savedDraw);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, fb.savedRead);
+    glViewport(fb.savedViewport[0], fb.savedViewport[1], fb.savedViewport[2], fb.savedViewport[3]);
+}
+
+// Hand the newest finished readback to the resolver; true with a new request list
+static bool VtFeedback_Poll(VtFeedback& fb, std::vector<VtRequest>& requests) {
+    if (!fb.active) return false;
+    PROFILE_SCOPE("VtFeedback_Poll");
+    bool harvested = false;
+    for (int k = 0; k < VT_FEEDBACK_RING; ++k) {
+        VtFeedbackSlot& s = fb.slots[(fb.next + k) % VT_FEEDBACK_RING];    // oldest first
+        if (!s.fence) continue;
+        GLenum r = glClientWaitSync(s.fence, 0, 0);
+        if (r != GL_ALREADY_SIGNALED && r != GL_CONDITION_SATISFIED) break;
+        glDeleteSync(s.fence);
+        s.fence = 0;
+        size_t count = (size_t)s.width * s.height;
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, s.pbo);
+        const void* data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, count * 4, GL_MAP_READ_BIT);
+        if (data) {
+            fb.mapped.assign((const uint32_t*)data, (const uint32_t*)data + count);
+            glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+            harvested = true;
+        }
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    }
+
+    bool ready = false;
+    {
+        std::lock_guard<std::mutex> hold(fb.lock);
+        if (harvested) {
+            if (fb.inputReady) ++fb.resolverBusy;   // the older one is replaced unread
+            fb.input.swap(fb.mapped);
+            fb.inputReady = true;
+        }
+        if (fb.outputReady) {
+            requests.swap(fb.output);
+            fb.outputReady = false;
+            ready = true;
+        }
+    }
+    if (harvested) fb.wake.notify_all();
+    return ready;
+}
+
+static void VtFeedback_Shutdown(VtFeedback& fb) {
+    if (!fb.active) return;
+    {
+        std::lock_guard<std::mutex> hold(fb.lock);
+        fb.stop = true;
+    }
+    fb.wake.notify_all();
+    fb.resolver.join();
+    for (VtFeedbackSlot& s : fb.slots) {
+        if (s.fence) glDeleteSync(s.fence);
+        s.fence = 0;
+        GpuMem_Release(GPUMEM_BUFFER, s.pbo);
+        glDeleteBuffers(1, &s.pbo);
+    }
+    GpuMem_Release(GPUMEM_RENDERBUFFER, fb.color);
+    GpuMem_Release(GPUMEM_RENDERBUFFER, fb.depth);
+    glDeleteRenderbuffers(1, &fb.color);
+    glDeleteRenderbuffers(1, &fb.depth);
+    glDeleteFramebuffers(1, &fb.fbo);
+    fb.width = fb.height = 0;
+    fb.active = false;
+}
+
+static void VtFeedback_Print(const VtFeedback& fb, FILE* f) {
+    StatSummary r = summarize(fb.resolveMs);
+    fprintf(f, "VT feedback: %llu readbacks, %llu resolved (%.1f unique pages each, %.3f ms median), "
+               "%llu dropped while the resolver was busy, %llu frames with the ring full\n",
+        (unsigned long long)fb.readbacks, (unsigned long long)fb.resolved,
+        fb.resolved ? (double)fb.uniquePages / fb.resolved : 0.0, r.p50,
+        (unsigned long long)fb.resolverBusy, (unsigned long long)fb.ringFull);
+}
+
+#endif //__VT_FEEDBACK_H__
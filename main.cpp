@@ -1,515 +1,2442 @@
-﻿// Port of Cg prototype to GLSL with debug logging.
-// Author: Morgan McGuire, updated by Dayuppy
-
-#include <windows.h>
-
-#ifndef M_PI
-#define M_PI 3.14159265358979323846
-#endif
-
-#pragma comment(lib, "glew32.lib")
-#pragma comment(lib, "freeglut.lib")
-#include "GL/glew.h"
-#include "GL/glut.h"
-#include "READ_BMP.h"
-#include <fstream>
-#include <sstream>
-
-// Camera and window
-static float camera_rotate_angle = 0.0f;
-static float camera_elevate_angle = -20.0f;
-static int   screenWidth = 1400;
-static int   screenHeight = 700;
-
-// Mouse state
-static int mouseButton = -1, mouseX = 0, mouseY = 0;
-
-// Quality toggles
-static bool multisampling = true;
-static bool bumpy = false;
-static bool selfShadowing = true;
-static bool parallaxEnabled = true;
-
-// Light
-static float lightPosition[3] = { 0.0f, 0.0f, 8.0f };
-static float lightModelViewMat[16];
-
-// Textures
-static GLuint  texture_id;
-static GLuint  bumpTexture_id;
-static GLuint  normalTexture_id;
-static BYTE* image_data = nullptr;
-static int     image_width = 0;
-static int     image_height = 0;
-
-// Shader programs
-static GLuint vsProg = 0;
-static GLuint psProg = 0;
-static GLuint psSteepProg = 0;
-
-// Geometry
-static GLuint VBO = 0;
-static GLuint VAO = 0;
-
-// Forward declarations
-static void initPrograms();
-static void initGeometry();
-static void Handle_Display();
-static void Handle_Keyboard(unsigned char key, int x, int y);
-static void Handle_Reshape(int w, int h);
-static void Handle_Mouse(int button, int state, int x, int y);
-static void Handle_Motion(int x, int y);
-
-template<typename T>
-constexpr T clamp(T v, T lo, T hi) {
-    return (v < lo) ? lo : (v > hi) ? hi : v;
-}
-
-// Helper: multiply two 4×4 matrices (column-major) ⇒ out = A * B
-static void multiply4x4(const float A[16], const float B[16], float out[16]) {
-    for (int r = 0; r < 4; ++r) {
-        for (int c = 0; c < 4; ++c) {
-            float sum = 0.0f;
-            for (int k = 0; k < 4; ++k) {
-                sum += A[k * 4 + r] * B[c * 4 + k];
-            }
-            out[c * 4 + r] = sum;
-        }
-    }
-}
-
-// Helper: invert an affine rigid‐body transform M (rotation + translation only)
-static void invertRigid(const float M[16], float out[16]) {
-    // Transpose the 3×3 rotation
-    out[0] = M[0];  out[1] = M[4];  out[2] = M[8];   out[3] = 0.0f;
-    out[4] = M[1];  out[5] = M[5];  out[6] = M[9];   out[7] = 0.0f;
-    out[8] = M[2];  out[9] = M[6];  out[10] = M[10];  out[11] = 0.0f;
-    // Compute -Rᵀ * T
-    out[12] = -(out[0] * M[12] + out[4] * M[13] + out[8] * M[14]);
-    out[13] = -(out[1] * M[12] + out[5] * M[13] + out[9] * M[14]);
-    out[14] = -(out[2] * M[12] + out[6] * M[13] + out[10] * M[14]);
-    out[15] = 1.0f;
-}
-
-// Utility: read entire file into string
-static std::string readFile(const char* path) {
-    std::ifstream f(path, std::ios::binary);
-    if (!f.is_open()) {
-        fprintf(stderr, "ERROR: cannot open '%s'\n", path);
-        return "";
-    }
-    std::ostringstream ss;
-    ss << f.rdbuf();
-    return ss.str();
-}
-
-// Compile a shader and print any errors
-static GLuint compileShader(GLenum type, const std::string& src) {
-    GLuint s = glCreateShader(type);
-    const char* c = src.c_str();
-    glShaderSource(s, 1, &c, nullptr);
-    glCompileShader(s);
-    GLint status = GL_FALSE;
-    glGetShaderiv(s, GL_COMPILE_STATUS, &status);
-    if (status != GL_TRUE) {
-        char log[512];
-        glGetShaderInfoLog(s, 512, nullptr, log);
-        fprintf(stderr, "Shader compile error (%s):\n%s\n",
-            type == GL_VERTEX_SHADER ? "VERT" : "FRAG", log);
-        glDeleteShader(s);
-        return 0;
-    }
-    return s;
-}
-
-// Link program, bind attributes and fragment output
-static GLuint linkProgram(GLuint vs, GLuint fs) {
-    GLuint p = glCreateProgram();
-    // Attribute locations must match VAO layout:
-    glBindAttribLocation(p, 0, "Position");
-    glBindAttribLocation(p, 1, "UV");
-    glBindAttribLocation(p, 2, "Normal");
-    glBindAttribLocation(p, 3, "Tangent");
-    glAttachShader(p, vs);
-    glAttachShader(p, fs);
-    glBindFragDataLocation(p, 0, "fragColor");
-    glLinkProgram(p);
-    GLint status = GL_FALSE;
-    glGetProgramiv(p, GL_LINK_STATUS, &status);
-    if (status != GL_TRUE) {
-        char log[512];
-        glGetProgramInfoLog(p, 512, nullptr, log);
-        fprintf(stderr, "Program link error:\n%s\n", log);
-        glDeleteProgram(p);
-        return 0;
-    }
-    return p;
-}
-
-// Build a complete shader program from two GLSL files
-static GLuint createShaderProgram(const char* vsFile, const char* fsFile) {
-    std::string vsSrc = readFile(vsFile);
-    std::string fsSrc = readFile(fsFile);
-    if (vsSrc.empty() || fsSrc.empty()) return 0;
-    GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
-    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
-    if (!vs || !fs) return 0;
-    GLuint prog = linkProgram(vs, fs);
-    glDeleteShader(vs);
-    glDeleteShader(fs);
-    return prog;
-}
-
-// Debug helper for uniform locations
-static void debugUniform(GLuint prog, const char* name, GLint loc) {
-    if (loc < 0) {
-        fprintf(stderr, "DEBUG: Uniform '%s' not found in program %u\n", name, prog);
-    }
-    else {
-        fprintf(stdout, "DEBUG: Uniform '%s' loc=%d in program %u\n", name, loc, prog);
-    }
-}
-
-// Bind and set up uniforms & textures for basic parallax
-static void bindParallax(GLuint prog) {
-    glUseProgram(prog);
-    GLint uMVP = glGetUniformLocation(prog, "ModelViewProj");
-    GLint uMVI = glGetUniformLocation(prog, "ModelViewI");
-    GLint uLight = glGetUniformLocation(prog, "lightPosition");
-    GLint uDiffuse = glGetUniformLocation(prog, "diffuseTexture");
-    GLint uHeight = glGetUniformLocation(prog, "heightMap");
-    GLint uNormal = glGetUniformLocation(prog, "normalMap");
-    GLint uScale = glGetUniformLocation(prog, "bumpScale");
-    GLint uParallax = glGetUniformLocation(prog, "parralax");
-
-    debugUniform(prog, "ModelViewProj", uMVP);
-    debugUniform(prog, "ModelViewI", uMVI);
-    debugUniform(prog, "lightPosition", uLight);
-    debugUniform(prog, "diffuseTexture", uDiffuse);
-    debugUniform(prog, "heightMap", uHeight);
-    debugUniform(prog, "normalMap", uNormal);
-    debugUniform(prog, "bumpScale", uScale);
-    debugUniform(prog, "parralax", uParallax);
-
-    // Sampler bindings
-    glUniform1i(uDiffuse, 0);
-    glUniform1i(uHeight, 1);
-    glUniform1i(uNormal, 2);
-
-    // Texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, bumpTexture_id);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, normalTexture_id);
-
-    // Options
-    glUniform1f(uScale, bumpy ? 0.125f : 0.05f);
-    glUniform1f(uParallax, parallaxEnabled ? 1.0f : 0.0f);
-}
-
-// Bind and set up uniforms & textures for steep‐parallax
-static void bindSteep(GLuint prog) {
-    glUseProgram(prog);
-    GLint uMVP = glGetUniformLocation(prog, "ModelViewProj");
-    GLint uMVI = glGetUniformLocation(prog, "ModelViewI");
-    GLint uLight = glGetUniformLocation(prog, "lightPosition");
-    GLint uDiffuse = glGetUniformLocation(prog, "diffuseTexture");
-    GLint uHeight = glGetUniformLocation(prog, "heightMap");
-    GLint uNormal = glGetUniformLocation(prog, "normalMap");
-    GLint uScale = glGetUniformLocation(prog, "bumpScale");
-    GLint uSelfShadow = glGetUniformLocation(prog, "selfShadowTest");
-
-    debugUniform(prog, "ModelViewProj", uMVP);
-    debugUniform(prog, "ModelViewI", uMVI);
-    debugUniform(prog, "lightPosition", uLight);
-    debugUniform(prog, "diffuseTexture", uDiffuse);
-    debugUniform(prog, "heightMap", uHeight);
-    debugUniform(prog, "normalMap", uNormal);
-    debugUniform(prog, "bumpScale", uScale);
-    debugUniform(prog, "selfShadowTest", uSelfShadow);
-
-    // Sampler bindings
-    glUniform1i(uDiffuse, 0);
-    glUniform1i(uHeight, 1);
-    glUniform1i(uNormal, 2);
-
-    // Texture units
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glActiveTexture(GL_TEXTURE1);
-    glBindTexture(GL_TEXTURE_2D, bumpTexture_id);
-    glActiveTexture(GL_TEXTURE2);
-    glBindTexture(GL_TEXTURE_2D, normalTexture_id);
-
-    glUniform1f(uScale, bumpy ? 0.125f : 0.05f);
-    glUniform1f(uSelfShadow, selfShadowing ? 1.0f : 0.0f);
-}
-
-// Display callback
-static void Handle_Display() {
-    // Clamp light so it can't wander off
-    lightPosition[0] = clamp(lightPosition[0], -10.0f, 10.0f);
-    lightPosition[1] = clamp(lightPosition[1], -10.0f, 10.0f);
-    lightPosition[2] = clamp(lightPosition[2], 2.0f, 20.0f);
-
-    // Multisample
-    if (multisampling) glEnable(GLUT_MULTISAMPLE);
-    else               glDisable(GLUT_MULTISAMPLE);
-
-    // Clear
-    glClearColor(0, 0, 0, 1);
-    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-
-    // Enable scissor to clip at center line
-    glEnable(GL_SCISSOR_TEST);
-
-    // Compute half‐width and square size
-    int halfW = screenWidth / 2;
-    int squareW = (screenHeight < halfW ? screenHeight : halfW);
-
-    // ---- LEFT SQUARE: basic parallax ----
-    int leftX = halfW - squareW;
-    glViewport(leftX, 0, squareW, squareW);
-    glScissor(leftX, 0, squareW, squareW);
-
-    // Setup camera
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(0, 0, 35, 0, 0, 0, 0, 1, 0);
-
-    // Light in eye space
-    float MV0[16];
-    glGetFloatv(GL_MODELVIEW_MATRIX, MV0);
-    float lightEye[3] = {
-        MV0[0] * lightPosition[0] + MV0[4] * lightPosition[1] + MV0[8] * lightPosition[2] + MV0[12],
-        MV0[1] * lightPosition[0] + MV0[5] * lightPosition[1] + MV0[9] * lightPosition[2] + MV0[13],
-        MV0[2] * lightPosition[0] + MV0[6] * lightPosition[1] + MV0[10] * lightPosition[2] + MV0[14]
-    };
-
-    // Draw light‐marker on left side only
-    glUseProgram(0);
-    glPushMatrix();
-    glTranslatef(lightPosition[0], lightPosition[1], lightPosition[2]);
-    glColor3f(1, 1, 0);
-    glutSolidSphere(0.5f, 16, 16);
-    glPopMatrix();
-
-    // Rotate quad
-    glLoadMatrixf(MV0);
-    glRotatef(camera_elevate_angle, 1, 0, 0);
-    glRotatef(camera_rotate_angle, 0, 1, 0);
-
-    // Build MVP + inverse MV
-    float MV[16], PM[16], MVP[16], invMV[16];
-    glGetFloatv(GL_MODELVIEW_MATRIX, MV);
-    glGetFloatv(GL_PROJECTION_MATRIX, PM);
-    multiply4x4(PM, MV, MVP);
-    invertRigid(MV, invMV);
-
-    // Render left quad
-    glUseProgram(psProg);
-    glUniformMatrix4fv(glGetUniformLocation(psProg, "ModelViewProj"), 1, GL_FALSE, MVP);
-    glUniformMatrix4fv(glGetUniformLocation(psProg, "ModelViewI"), 1, GL_FALSE, invMV);
-    glUniform3fv(glGetUniformLocation(psProg, "lightPosition"), 1, lightEye);
-    bindParallax(psProg);
-    glBindVertexArray(VAO);
-    glDrawArrays(GL_QUADS, 0, 4);
-
-    // ---- RIGHT SQUARE: steep parallax ----
-    glClear(GL_DEPTH_BUFFER_BIT);
-    int rightX = halfW;
-    glViewport(rightX, 0, squareW, squareW);
-    glScissor(rightX, 0, squareW, squareW);
-
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    gluLookAt(0, 0, 35, 0, 0, 0, 0, 1, 0);
-
-    // Recompute lightEye for steep side
-    glGetFloatv(GL_MODELVIEW_MATRIX, MV0);
-    lightEye[0] = MV0[0] * lightPosition[0] + MV0[4] * lightPosition[1] + MV0[8] * lightPosition[2] + MV0[12];
-    lightEye[1] = MV0[1] * lightPosition[0] + MV0[5] * lightPosition[1] + MV0[9] * lightPosition[2] + MV0[13];
-    lightEye[2] = MV0[2] * lightPosition[0] + MV0[6] * lightPosition[1] + MV0[10] * lightPosition[2] + MV0[14];
-
-    // **Removed** the fixed‐pipeline light marker on steep side
-
-    // Rotate quad
-    glLoadMatrixf(MV0);
-    glRotatef(camera_elevate_angle, 1, 0, 0);
-    glRotatef(camera_rotate_angle, 0, 1, 0);
-
-    // Rebuild MVP + inverse MV
-    glGetFloatv(GL_MODELVIEW_MATRIX, MV);
-    glGetFloatv(GL_PROJECTION_MATRIX, PM);
-    multiply4x4(PM, MV, MVP);
-    invertRigid(MV, invMV);
-
-    // Render right quad
-    glUseProgram(psSteepProg);
-    glUniformMatrix4fv(glGetUniformLocation(psSteepProg, "ModelViewProj"), 1, GL_FALSE, MVP);
-    glUniformMatrix4fv(glGetUniformLocation(psSteepProg, "ModelViewI"), 1, GL_FALSE, invMV);
-    glUniform3fv(glGetUniformLocation(psSteepProg, "lightPosition"), 1, lightEye);
-    bindSteep(psSteepProg);
-    glDrawArrays(GL_QUADS, 0, 4);
-
-    // Cleanup
-    glDisable(GL_SCISSOR_TEST);
-    glBindVertexArray(0);
-    glutSwapBuffers();
-}
-
-// Keyboard handler
-static void Handle_Keyboard(unsigned char key, int, int) {
-    if (key == 'q' || key == 'Q' || key == 27) exit(0);
-    if (key == 'm' || key == 'M') multisampling = !multisampling;
-    if (key == 'b' || key == 'B') bumpy = !bumpy;
-    if (key == 's' || key == 'S') selfShadowing = !selfShadowing;
-    if (key == 'p' || key == 'P') parallaxEnabled = !parallaxEnabled;
-}
-
-// Reshape handler
-static void Handle_Reshape(int w, int h) {
-    screenWidth = w;
-    screenHeight = h;
-    glViewport(0, 0, w, h);
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-    gluPerspective(25.0, (double)w * 0.5 / h, 0.1, 1000.0);
-    glMatrixMode(GL_MODELVIEW);
-}
-
-// Mouse down/up
-static void Handle_Mouse(int button, int state, int x, int y) {
-    if (state == GLUT_DOWN) {
-        mouseButton = button;
-        mouseX = x; mouseY = y;
-    }
-    else {
-        mouseButton = -1;
-    }
-}
-
-// Mouse drag
-static void Handle_Motion(int x, int y) {
-    if (mouseButton == GLUT_LEFT_BUTTON) {
-        camera_elevate_angle += (y - mouseY);
-        camera_rotate_angle += (x - mouseX);
-    }
-    else if (mouseButton == GLUT_RIGHT_BUTTON) {
-        float s = 0.1f;
-        lightPosition[0] += (x - mouseX) * s;
-        lightPosition[1] -= (y - mouseY) * s;
-    }
-    mouseX = x; mouseY = y;
-    glutPostRedisplay();
-}
-
-// Compile/link shaders
-static void initPrograms() {
-    fprintf(stdout, "DEBUG: Compiling/linking GLSL shaders...\n");
-    vsProg = createShaderProgram("vsParallax.glsl", "psParallax.glsl");
-    psProg = createShaderProgram("vsParallax.glsl", "psParallax.glsl");
-    psSteepProg = createShaderProgram("vsParallax.glsl", "psSteepParallax.glsl");
-    if (!vsProg || !psProg || !psSteepProg) {
-        fprintf(stderr, "ERROR: Shader setup failed\n");
-        exit(1);
-    }
-}
-
-// Prepare VBO & VAO for a single quad
-static void initGeometry() {
-    float verts[] = {
-        -7,-7,4,  0,0,  0,0,1,  1,0,0,1,
-        -7, 7,4,  1,0,  0,0,1,  1,0,0,1,
-         7, 7,4,  1,1,  0,0,1,  1,0,0,1,
-         7,-7,4,  0,1,  0,0,1,  1,0,0,1
-    };
-    glGenVertexArrays(1, &VAO);
-    glGenBuffers(1, &VBO);
-    glBindVertexArray(VAO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(verts), verts, GL_STATIC_DRAW);
-    // layout(location = 0) Position
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)0);
-    glEnableVertexAttribArray(0);
-    // layout(location = 1) UV
-    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)(3 * sizeof(float)));
-    glEnableVertexAttribArray(1);
-    // layout(location = 2) Normal
-    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)(5 * sizeof(float)));
-    glEnableVertexAttribArray(2);
-    // layout(location = 3) Tangent
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)(8 * sizeof(float)));
-    glEnableVertexAttribArray(3);
-    glBindVertexArray(0);
-}
-
-// Entry point
-int main(int argc, char* argv[]) {
-    // Print working directory
-    char cwd[MAX_PATH];
-    if (GetCurrentDirectoryA(MAX_PATH, cwd))
-        fprintf(stdout, "Working directory: %s\n", cwd);
-
-    // Init GLUT + window
-    glutInit(&argc, argv);
-    glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH | GLUT_MULTISAMPLE);
-    glutInitWindowSize(screenWidth, screenHeight);
-    glutCreateWindow("Parallax Mapping GLSL");
-
-    // Init GLEW
-    glewExperimental = GL_TRUE;
-    if (glewInit() != GLEW_OK) {
-        fprintf(stderr, "ERROR: glewInit failed\n");
-        return 1;
-    }
-
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-
-    // Load and upload lion.bmp
-    BMP_Read("lion.bmp", &image_data, image_width, image_height);
-    glGenTextures(1, &texture_id);
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image_width, image_height, 0, GL_RGB, GL_UNSIGNED_BYTE, image_data);
-
-    // Load and upload lion-bump.bmp
-    BMP_Read("lion-bump.bmp", &image_data, image_width, image_height);
-    glGenTextures(1, &bumpTexture_id);
-    glBindTexture(GL_TEXTURE_2D, bumpTexture_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image_width, image_height, 0, GL_RGB, GL_UNSIGNED_BYTE, image_data);
-
-    // Load and upload lion-normal.bmp
-    BMP_Read("lion-normal.bmp", &image_data, image_width, image_height);
-    glGenTextures(1, &normalTexture_id);
-    glBindTexture(GL_TEXTURE_2D, normalTexture_id);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, image_width, image_height, 0, GL_RGB, GL_UNSIGNED_BYTE, image_data);
-
-    initPrograms();
-    initGeometry();
-
-    glutMouseFunc(Handle_Mouse);
-    glutMotionFunc(Handle_Motion);
-    glutKeyboardFunc(Handle_Keyboard);
-    glutReshapeFunc(Handle_Reshape);
-    glutDisplayFunc(Handle_Display);
-    glutIdleFunc(Handle_Display);
-
-    glutMainLoop();
-    return 0;
+﻿// Port of Cg prototype to GLSL with debug logging.
+// Author: Morgan McGuire, updated by Dayuppy
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <unistd.h>
+#include <limits.h>
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+#ifdef _WIN32
+#pragma comment(lib, "glew32.lib")
+#pragma comment(lib, "freeglut.lib")
+#include "GL/glew.h"
+#include "GL/glut.h"
+#include "GL/freeglut_ext.h"
+#else
+// Linux: entry points come straight from libOpenGL, no loader needed
+#define GL_GLEXT_PROTOTYPES
+#include <GL/gl.h>
+#include <GL/glext.h>
+#include <GL/glu.h>
+#include <GL/glut.h>
+#include <GL/freeglut_ext.h>
+#endif
+#include "READ_BMP.h"
+#include "GL_DEBUG.h"
+#include "GPU_MEMORY.h"
+#include "HEADLESS.h"
+#include "CAPTURE.h"
+#include "GPU_TIMER.h"
+#include "PIPELINE_STATS.h"
+#include "PERF_COUNTERS.h"
+#include "PROFILER.h"
+#include "BENCHMARK.h"
+#include "CPU_REFERENCE.h"
+#include "IMAGE_METRICS.h"
+#include "HISTORY.h"
+#include "SWEEP.h"
+#include "PRESETS.h"
+#include "GOLDEN.h"
+#include "INPUT_LOG.h"
+#include "STARTUP.h"
+#include "HUD.h"
+#include "MESH.h"
+#include "MESH_CACHE.h"
+#include "METRICS_EXPORT.h"
+#include "TERRAIN.h"
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+// Camera and window
+static float camera_rotate_angle = 0.0f;
+static float camera_elevate_angle = -20.0f;
+static int   screenWidth = 1400;
+static int   screenHeight = 700;
+
+// Mouse state
+static int mouseButton = -1, mouseX = 0, mouseY = 0;
+
+// Quality toggles
+static bool multisampling = true;
+static bool bumpy = false;
+static bool selfShadowing = true;
+static bool parallaxEnabled = true;
+
+// Light
+static float lightPosition[3] = { 0.0f, 0.0f, 8.0f };
+static float lightModelViewMat[16];
+
+// Textures
+static GLuint  texture_id;
+static GLuint  bumpTexture_id;
+static GLuint  normalTexture_id;
+static BYTE* image_data = nullptr;
+static int     image_width = 0;
+static int     image_height = 0;
+
+// CPU copies of the textures for the reference renderer
+static CpuTexture cpuDiffuse;
+static CpuTexture cpuHeight;
+static CpuTexture cpuNormal;
+
+// Shader programs
+static GLuint psProg = 0;
+static GLuint psSteepProg = 0;
+static GLuint terrainFeedbackProg = 0;  // terrain mode: virtual-texture page requests
+
+// Steep-parallax permutation of every quality preset, compiled on first use;
+// psSteepProg is the one in use. tuner.preset is the current preset, whether
+// or not automatic tuning is on.
+static GLuint    presetPrograms[PRESET_COUNT];
+static AutoTuner tuner;
+static int       tunerResolved = 0;
+
+// Default geometry: one quad, interleaved position(3) uv(2) normal(3) tangent(4).
+// u runs along +y and v along +x, so dP/du = +y with a negative bitangent sign.
+static const float quadVertices[] = {
+    -7,-7,4,  0,0,  0,0,1,  0,1,0,-1,
+    -7, 7,4,  1,0,  0,0,1,  0,1,0,-1,
+     7, 7,4,  1,1,  0,0,1,  0,1,0,-1,
+     7,-7,4,  0,1,  0,0,1,  0,1,0,-1
+};
+// The quad as triangles. The diagonal matters because the tangent-space vectors
+// are not affine across the quad; this is Mesa's split of GL_QUADS.
+static const unsigned quadIndices[] = { 0, 1, 3, 1, 2, 3 };
+
+// What both viewports draw: the quad, or the --mesh OBJ fitted into MESH_RADIUS.
+// A mesh cache stays mapped; sceneMesh is decoded from it for the CPU reference.
+#define MESH_RADIUS 6.0f    // keeps the light (z = 8) outside
+static Mesh        sceneMesh;
+static MeshCache   sceneCache;
+static GLsizei     sceneIndexCount = 0;
+static GLenum      sceneIndexType = GL_UNSIGNED_INT;
+static float       scenePositionScale = 1.0f;
+static float       sceneUVScaleBias[4] = { 1.0f, 1.0f, 0.0f, 0.0f };
+static const char* meshFile = nullptr;
+static const char* meshConvertFile = nullptr;  // --mesh-convert: write --mesh as a cache, no GL
+static MeshOrder   meshOrder = MESH_ORDER_OVERDRAW;    // index order the converter writes
+static size_t      meshBenchTriangles = 0;     // --mesh-bench: load/tangent timing, no GL
+static GLuint VBO = 0;
+static GLuint EBO = 0;
+static GLuint VAO = 0;
+static GLUquadric* lightMarker = nullptr;
+static bool showLightMarker = true;
+
+// Headless (offscreen) run settings, see --help
+static bool        headlessMode = false;
+static int         headlessFrames = 100;
+static int         headlessDumpEvery = 0;
+static const char* headlessImagePrefix = "frame";
+static CaptureFormat captureFormat = CAPTURE_PPM;
+static const char* headlessTimingsFile = nullptr;
+static const char* gpuTimingsFile = nullptr;
+static int         headlessSamples = 4;
+
+// Benchmark mode (implies headless): --frames measured frames per configuration
+static const char* benchmarkFile = nullptr;
+static int         benchWarmupFrames = 10;
+
+// Performance history: benchmark runs are appended to historyFile; --perf-diff
+// compares a stored run with a baseline and needs no GL context
+static const char* historyFile = "perf_history.jsonl";
+static const char* historyCommit = nullptr;
+static const char* perfDiffFile = nullptr;
+static const char* perfDiffRun = nullptr;
+static const char* perfDiffAgainst = nullptr;
+static int         perfDiffBaselineRuns = 5;
+static double      perfDiffAlpha = 0.01;
+static double      perfDiffMinChange = 2.0;
+
+// A/B comparison mode (implies headless)
+static const char* compareFile = nullptr;
+static int         compareTrials = 40;
+static unsigned    compareSeed = 12345;
+static int         qualityViews = 4;
+static int         qualitySize = 256;
+static const char* diffMapPrefix = nullptr;    // FLIP-style error maps of the quality views
+
+// Standalone image comparison (no GL): --image-diff A.ppm B.ppm
+static const char* imageDiffA = nullptr;
+static const char* imageDiffB = nullptr;
+
+// Parameter sweep mode (implies headless), on the quality views of --compare
+static const char* sweepFile = nullptr;
+static bool        sweepOnGL = false;
+static int         sweepRepeats = 5;
+
+// CPU kernels timed with hardware counters after the benchmark's GL configurations (0 = skip)
+static int kernelRuns = 5;
+
+// Fetch accounting mode (implies headless): CPU reference fetches per stage on the quality views
+static const char* fetchReportFile = nullptr;
+
+// Index order report (implies headless): every MeshOrder of the scene mesh, orbiting it
+#define MESH_ORDER_VIEWS 12     // 6 directions around the mesh, above and below
+static const char* meshOrderReportFile = nullptr;
+static const char* terrainFile = nullptr;      // --terrain: steep pass over a streamed world height field
+static int         terrainGenerateSize = 0;    // --terrain-gen: write a world of N^2 texels, no GL
+static int         terrainBudgetKB = TERRAIN_BUDGET_KB;    // --terrain-budget: page bytes queued per frame
+static int         terrainSlots = TERRAIN_ATLAS_SLOTS * TERRAIN_ATLAS_SLOTS;    // --terrain-slots: atlas slots in use
+
+// Golden-image regression mode (implies headless): GL frames against the CPU reference
+static const char*  goldenFile = nullptr;
+static GoldenBudget goldenBudget;
+
+// Input record/replay: --record logs the window's input, --replay plays a log back
+// frame-exact, in the window or headless for as many frames as were recorded
+static const char*   recordFile = nullptr;
+static const char*   replayFile = nullptr;
+static InputRecorder inputRecorder;
+static InputReplay   inputReplay;
+static uint32_t      inputFrame = 0;    // frames shown in the window so far
+
+// Startup: --startup-report prints the time of every phase; --fast-start presents plain
+// normal mapping on placeholder textures while the assets and shaders stream in
+static bool         startupReport = false;
+static bool         fastStart = false;
+static bool         fullQuality = true;     // false while fast start is still loading
+static StartupImage startupImages[3];
+static std::thread  startupLoader;
+
+// GPU memory: --gpu-budget caps what the registry may hold, in MB (0 = no cap)
+static double gpuBudgetMB = 0.0;
+
+// Performance overlay: 'H' or --hud shows it
+static bool hudAtStart = false;
+
+// Soak-test metrics: --metrics-file rewrites a Prometheus text file every
+// --metrics-interval seconds, --metrics-socket serves scrapes on a Unix socket
+static const char* metricsFile = nullptr;
+static const char* metricsSocket = nullptr;
+static double      metricsIntervalS = 10.0;
+
+// KHR_debug: groups, labels and the rate-limited message log are always on when the
+// context supports them; --gl-debug asks for a debug context and logs notifications too
+static bool glDebugContext = false;
+
+// CPU profiler: recording is on by default; 'T' writes the trace, as does the end
+// of a headless run when --trace was given
+static bool        profileEnabled = true;
+static const char* traceFile = nullptr;
+
+// Windowed capture ('C'): every frame until pressed again, one numbered take per press
+static int windowCaptureTake = 0;
+static int windowCaptureFrame = 0;
+
+// Forward declarations
+static void initTextures();
+static void initPrograms();
+static void initGeometry();
+static void renderScene();
+static void Handle_Display();
+static void Handle_Keyboard(unsigned char key, int x, int y);
+static void Handle_Reshape(int w, int h);
+static void Handle_Mouse(int button, int state, int x, int y);
+static void Handle_Motion(int x, int y);
+static void replayInput(uint32_t frame);
+static void updateFastStart();
+static void joinFastStart();
+static void notePresentedFrame();
+static CpuShading currentCpuShading(ShadingTechnique tech);
+static void renderReference(const CpuShading& shading, const float MVP[16], const float invMV[16],
+                            const float lightEye[3], int size, CpuFrame& out);
+
+template<typename T>
+constexpr T clamp(T v, T lo, T hi) {
+    return (v < lo) ? lo : (v > hi) ? hi : v;
+}
+
+// Helper: multiply two 4×4 matrices (column-major) ⇒ out = A * B
+static void multiply4x4(const float A[16], const float B[16], float out[16]) {
+    for (int r = 0; r < 4; ++r) {
+        for (int c = 0; c < 4; ++c) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; ++k) {
+                sum += A[k * 4 + r] * B[c * 4 + k];
+            }
+            out[c * 4 + r] = sum;
+        }
+    }
+}
+
+// Helper: invert an affine rigid‐body transform M (rotation + translation only)
+static void invertRigid(const float M[16], float out[16]) {
+    // Transpose the 3×3 rotation
+    out[0] = M[0];  out[1] = M[4];  out[2] = M[8];   out[3] = 0.0f;
+    out[4] = M[1];  out[5] = M[5];  out[6] = M[9];   out[7] = 0.0f;
+    out[8] = M[2];  out[9] = M[6];  out[10] = M[10];  out[11] = 0.0f;
+    // Compute -Rᵀ * T
+    out[12] = -(out[0] * M[12] + out[4] * M[13] + out[8] * M[14]);
+    out[13] = -(out[1] * M[12] + out[5] * M[13] + out[9] * M[14]);
+    out[14] = -(out[2] * M[12] + out[6] * M[13] + out[10] * M[14]);
+    out[15] = 1.0f;
+}
+
+// Utility: read entire file into string
+static std::string readFile(const char* path) {
+    std::ifstream f(path, std::ios::binary);
+    if (!f.is_open()) {
+        fprintf(stderr, "ERROR: cannot open '%s'\n", path);
+        return "";
+    }
+    std::ostringstream ss;
+    ss << f.rdbuf();
+    return ss.str();
+}
+
+// Compile a shader and print any errors
+static GLuint compileShader(GLenum type, const std::string& src) {
+    GLuint s = glCreateShader(type);
+    const char* c = src.c_str();
+    glShaderSource(s, 1, &c, nullptr);
+    glCompileShader(s);
+    GLint status = GL_FALSE;
+    glGetShaderiv(s, GL_COMPILE_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512];
+        glGetShaderInfoLog(s, 512, nullptr, log);
+        fprintf(stderr, "Shader compile error (%s):\n%s\n",
+            type == GL_VERTEX_SHADER ? "VERT" : "FRAG", log);
+        glDeleteShader(s);
+        return 0;
+    }
+    return s;
+}
+
+// Link program, bind attributes and fragment output
+static GLuint linkProgram(GLuint vs, GLuint fs) {
+    GLuint p = glCreateProgram();
+    // Attribute locations must match VAO layout:
+    glBindAttribLocation(p, 0, "Position");
+    glBindAttribLocation(p, 1, "UV");
+    glBindAttribLocation(p, 2, "Normal");
+    glBindAttribLocation(p, 3, "Tangent");
+    glAttachShader(p, vs);
+    glAttachShader(p, fs);
+    glBindFragDataLocation(p, 0, "fragColor");
+    glLinkProgram(p);
+    GLint status = GL_FALSE;
+    glGetProgramiv(p, GL_LINK_STATUS, &status);
+    if (status != GL_TRUE) {
+        char log[512];
+        glGetProgramInfoLog(p, 512, nullptr, log);
+        fprintf(stderr, "Program link error:\n%s\n", log);
+        glDeleteProgram(p);
+        return 0;
+    }
+    return p;
+}
+
+// Build a complete shader program from two GLSL files; defines go right after
+// the fragment shader's #version line
+static GLuint createShaderProgram(const char* vsFile, const char* fsFile, const std::string& defines = std::string()) {
+    std::string vsSrc = readFile(vsFile);
+    std::string fsSrc = readFile(fsFile);
+    if (vsSrc.empty() || fsSrc.empty()) return 0;
+    if (!defines.empty()) {
+        size_t eol = fsSrc.compare(0, 8, "#version") ? std::string::npos : fsSrc.find('\n');
+        fsSrc.insert(eol == std::string::npos ? 0 : eol + 1, defines);
+    }
+    GLuint vs = compileShader(GL_VERTEX_SHADER, vsSrc);
+    GLuint fs = compileShader(GL_FRAGMENT_SHADER, fsSrc);
+    if (!vs || !fs) return 0;
+    GLuint prog = linkProgram(vs, fs);
+    glDeleteShader(vs);
+    glDeleteShader(fs);
+    return prog;
+}
+
+// Debug helper for uniform locations; runs on every bind, so the log is rate limited
+static void debugUniform(GLuint prog, const char* name, GLint loc) {
+    if (loc < 0) GLDebug_Log(GL_DEBUG_TYPE_OTHER, "uniform '%s' not found in program %u", name, prog);
+}
+
+// Bind and set up uniforms & textures for basic parallax
+static void bindParallax(GLuint prog) {
+    glUseProgram(prog);
+    GLint uMVP = glGetUniformLocation(prog, "ModelViewProj");
+    GLint uMVI = glGetUniformLocation(prog, "ModelViewI");
+    GLint uLight = glGetUniformLocation(prog, "lightPosition");
+    GLint uDiffuse = glGetUniformLocation(prog, "diffuseTexture");
+    GLint uHeight = glGetUniformLocation(prog, "heightMap");
+    GLint uNormal = glGetUniformLocation(prog, "normalMap");
+    GLint uScale = glGetUniformLocation(prog, "bumpScale");
+    GLint uParallax = glGetUniformLocation(prog, "parralax");
+
+    debugUniform(prog, "ModelViewProj", uMVP);
+    debugUniform(prog, "ModelViewI", uMVI);
+    debugUniform(prog, "lightPosition", uLight);
+    debugUniform(prog, "diffuseTexture", uDiffuse);
+    debugUniform(prog, "heightMap", uHeight);
+    debugUniform(prog, "normalMap", uNormal);
+    debugUniform(prog, "bumpScale", uScale);
+    debugUniform(prog, "parralax", uParallax);
+
+    // Sampler bindings
+    glUniform1i(uDiffuse, 0);
+    glUniform1i(uHeight, 1);
+    glUniform1i(uNormal, 2);
+
+    // Texture units
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, bumpTexture_id);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, normalTexture_id);
+
+    // Options
+    glUniform1f(uScale, bumpy ? 0.125f : 0.05f);
+    glUniform1f(uParallax, parallaxEnabled && fullQuality ? 1.0f : 0.0f);
+}
+
+// Bind and set up uniforms & textures for steep‐parallax
+static void bindSteep(GLuint prog) {
+    glUseProgram(prog);
+    GLint uMVP = glGetUniformLocation(prog, "ModelViewProj");
+    GLint uMVI = glGetUniformLocation(prog, "ModelViewI");
+    GLint uLight = glGetUniformLocation(prog, "lightPosition");
+    GLint uDiffuse = glGetUniformLocation(prog, "diffuseTexture");
+    GLint uHeight = glGetUniformLocation(prog, "heightMap");
+    GLint uNormal = glGetUniformLocation(prog, "normalMap");
+    GLint uScale = glGetUniformLocation(prog, "bumpScale");
+    GLint uSelfShadow = glGetUniformLocation(prog, "selfShadowTest");
+
+    debugUniform(prog, "ModelViewProj", uMVP);
+    debugUniform(prog, "ModelViewI", uMVI);
+    debugUniform(prog, "lightPosition", uLight);
+    if (!terrain.active) {      // the terrain build reads none of the material maps
+        debugUniform(prog, "diffuseTexture", uDiffuse);
+        debugUniform(prog, "heightMap", uHeight);
+        debugUniform(prog, "normalMap", uNormal);
+    }
+    debugUniform(prog, "bumpScale", uScale);
+    debugUniform(prog, "selfShadowTest", uSelfShadow);
+
+    // Sampler bindings
+    glUniform1i(uDiffuse, 0);
+    glUniform1i(uHeight, 1);
+    glUniform1i(uNormal, 2);
+
+    // Texture units
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_2D, bumpTexture_id);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, normalTexture_id);
+
+    glUniform1f(uScale, bumpy ? 0.125f : 0.05f);
+    glUniform1f(uSelfShadow, selfShadowing ? 1.0f : 0.0f);
+    if (terrain.active) Terrain_Bind(terrain, prog);
+}
+
+// Shading techniques by ShadingTechnique; adding one means a program, a bind function
+// and a CPU_REFERENCE.h shading function
+struct TechniqueInfo {
+    const char* name;
+    GLuint*     program;
+    void      (*bind)(GLuint);
+};
+static const TechniqueInfo techniques[TECH_COUNT] = {
+    { "parallax", &psProg,      bindParallax },
+    { "steep",    &psSteepProg, bindSteep },
+};
+
+// Camera for one viewport: loads the look-at modelview and returns it with the eye-space light
+static void setupCamera(float MV0[16], float lightEye[3]) {
+    glMatrixMode(GL_MODELVIEW);
+    glLoadIdentity();
+    gluLookAt(0, 0, 35, 0, 0, 0, 0, 1, 0);
+
+    // Light in eye space
+    glGetFloatv(GL_MODELVIEW_MATRIX, MV0);
+    lightEye[0] = MV0[0] * lightPosition[0] + MV0[4] * lightPosition[1] + MV0[8] * lightPosition[2] + MV0[12];
+    lightEye[1] = MV0[1] * lightPosition[0] + MV0[5] * lightPosition[1] + MV0[9] * lightPosition[2] + MV0[13];
+    lightEye[2] = MV0[2] * lightPosition[0] + MV0[6] * lightPosition[1] + MV0[10] * lightPosition[2] + MV0[14];
+}
+
+// Rotate the quad by the camera angles and build MVP + inverse MV
+static void buildQuadMatrices(const float MV0[16], float MVP[16], float invMV[16]) {
+    float MV[16], PM[16];
+    glLoadMatrixf(MV0);
+    glRotatef(camera_elevate_angle, 1, 0, 0);
+    glRotatef(camera_rotate_angle, 0, 1, 0);
+    glGetFloatv(GL_MODELVIEW_MATRIX, MV);
+    glGetFloatv(GL_PROJECTION_MATRIX, PM);
+    multiply4x4(PM, MV, MVP);
+    invertRigid(MV, invMV);
+}
+
+// Light marker at lightPosition; expects the camera modelview to be loaded.
+// (GLU rather than glutSolidSphere so headless runs need no GLUT state)
+static void drawLightMarker() {
+    glUseProgram(0);
+    glPushMatrix();
+    glTranslatef(lightPosition[0], lightPosition[1], lightPosition[2]);
+    glColor3f(1, 1, 0);
+    gluSphere(lightMarker, 0.5, 16, 16);
+    glPopMatrix();
+}
+
+// Set uniforms and draw the quad with one shading technique
+static void drawTechnique(ShadingTechnique tech, const float MVP[16], const float invMV[16], const float lightEye[3]) {
+    if (!fullQuality) tech = TECH_PARALLAX;    // fast start: plain normal mapping until everything is in
+    GLuint prog = *techniques[tech].program;
+    {
+        PROFILE_SCOPE("uniforms");
+        glUseProgram(prog);
+        glUniformMatrix4fv(glGetUniformLocation(prog, "ModelViewProj"), 1, GL_FALSE, MVP);
+        glUniformMatrix4fv(glGetUniformLocation(prog, "ModelViewI"), 1, GL_FALSE, invMV);
+        glUniform3fv(glGetUniformLocation(prog, "lightPosition"), 1, lightEye);
+        glUniform1f(glGetUniformLocation(prog, "PositionScale"), scenePositionScale);
+        glUniform4fv(glGetUniformLocation(prog, "UVScaleBias"), 1, sceneUVScaleBias);
+        techniques[tech].bind(prog);
+    }
+    {
+        PROFILE_SCOPE("draw");
+        glBindVertexArray(VAO);
+        glDrawElements(GL_TRIANGLES, sceneIndexCount, sceneIndexType, (void*)0);
+    }
+}
+
+// Terrain mode: the steep view again into the virtual-texture feedback target
+static void drawTerrainFeedback(const float MVP[16], const float invMV[16]) {
+    glUseProgram(terrainFeedbackProg);
+    glUniformMatrix4fv(glGetUniformLocation(terrainFeedbackProg, "ModelViewProj"), 1, GL_FALSE, MVP);
+    glUniformMatrix4fv(glGetUniformLocation(terrainFeedbackProg, "ModelViewI"), 1, GL_FALSE, invMV);
+    glUniform1f(glGetUniformLocation(terrainFeedbackProg, "PositionScale"), scenePositionScale);
+    glUniform4fv(glGetUniformLocation(terrainFeedbackProg, "UVScaleBias"), 1, sceneUVScaleBias);
+    Terrain_BindFeedback(terrain, terrainFeedbackProg);
+    glBindVertexArray(VAO);
+    glDrawElements(GL_TRIANGLES, sceneIndexCount, sceneIndexType, (void*)0);
+}
+
+// Fragment defines of a steep-parallax build: the knobs, plus TERRAIN in terrain mode
+static std::string steepDefines(const std::string& knobs = std::string()) {
+    return terrain.active ? Terrain_ShaderDefines() + knobs : knobs;
+}
+
+// Switch the steep pass to the shader permutation of a quality preset
+static bool selectPreset(int preset) {
+    if (!presetPrograms[preset]) {
+        presetPrograms[preset] = createShaderProgram("vsParallax.glsl", "psSteepParallax.glsl",
+                                                     steepDefines(Sweep_ShaderDefines(qualityPresets[preset].steep)));
+        if (!presetPrograms[preset]) {
+            fprintf(stderr, "ERROR: cannot build the '%s' preset\n", qualityPresets[preset].name);
+            return false;
+        }
+    }
+    psSteepProg = presetPrograms[preset];
+    tuner.preset = preset;
+    char label[64];
+    snprintf(label, sizeof(label), "psSteepProg (%s)", qualityPresets[preset].name);
+    GLDebug_Label(GL_PROGRAM, psSteepProg, label);
+    return true;
+}
+
+// Feed newly resolved GPU pass times to the tuner and follow its decision
+static void updateAutoTuner() {
+    if (!tuner.enabled || gpuPasses[PASS_STEEP].resolved == tunerResolved) return;
+    tunerResolved = gpuPasses[PASS_STEEP].resolved;
+    int before = tuner.preset;
+    int preset = Tuner_Update(tuner, gpuPasses[PASS_PARALLAX].window.last(), gpuPasses[PASS_STEEP].window.last());
+    if (preset == before) return;
+    if (!selectPreset(preset)) {
+        tuner.preset = before;
+        tuner.enabled = false;
+        return;
+    }
+    Input_Record(inputRecorder, inputFrame, INPUT_PRESET, preset, 0, 0, 0);
+    fprintf(stdout, "Auto-tune: %s -> %s (GPU median %.2f ms, target %.2f ms)\n",
+        qualityPresets[before].name, qualityPresets[preset].name, tuner.lastMedianMs, tuner.targetMs);
+}
+
+// Draw both viewports into the currently bound framebuffer
+static void renderScene() {
+    PROFILE_SCOPE("renderScene");
+    GL_DEBUG_GROUP("renderScene");
+    if (terrain.active) Terrain_Update(terrain);
+
+    // Clamp light so it can't wander off
+    lightPosition[0] = clamp(lightPosition[0], -10.0f, 10.0f);
+    lightPosition[1] = clamp(lightPosition[1], -10.0f, 10.0f);
+    lightPosition[2] = clamp(lightPosition[2], 2.0f, 20.0f);
+
+    // Multisample (GL_MULTISAMPLE is the capability; GLUT_MULTISAMPLE is only a display-mode bit)
+    if (multisampling) glEnable(GL_MULTISAMPLE);
+    else               glDisable(GL_MULTISAMPLE);
+
+    // Clear
+    {
+        PROFILE_SCOPE("clear");
+        GL_DEBUG_GROUP("clear");
+        glClearColor(0, 0, 0, 1);
+        glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    }
+
+    // Enable scissor to clip at center line
+    glEnable(GL_SCISSOR_TEST);
+
+    // Compute half‐width and square size
+    int halfW = screenWidth / 2;
+    int squareW = (screenHeight < halfW ? screenHeight : halfW);
+
+    float MV0[16], MVP[16], invMV[16];
+    float lightEye[3];
+
+    // ---- LEFT SQUARE: basic parallax ----
+    int leftX = halfW - squareW;
+    glViewport(leftX, 0, squareW, squareW);
+    glScissor(leftX, 0, squareW, squareW);
+
+    {
+        PROFILE_SCOPE("matrices (parallax)");
+        setupCamera(MV0, lightEye);
+    }
+
+    // Draw light‐marker on left side only
+    if (showLightMarker) {
+        PROFILE_SCOPE("draw light marker");
+        GL_DEBUG_GROUP("light marker");
+        drawLightMarker();
+    }
+
+    {
+        PROFILE_SCOPE("matrices (parallax)");
+        buildQuadMatrices(MV0, MVP, invMV);
+    }
+
+    // Render left quad
+    {
+        PROFILE_SCOPE("pass (parallax)");
+        GL_DEBUG_GROUP("pass (parallax)");
+        GpuTimer_BeginPass(PASS_PARALLAX);
+        PipeStats_BeginPass(PASS_PARALLAX, (double)squareW * squareW);
+        drawTechnique(TECH_PARALLAX, MVP, invMV, lightEye);
+        PipeStats_EndPass(PASS_PARALLAX);
+        GpuTimer_EndPass(PASS_PARALLAX);
+    }
+
+    // ---- RIGHT SQUARE: steep parallax ----
+    glClear(GL_DEPTH_BUFFER_BIT);
+    int rightX = halfW;
+    glViewport(rightX, 0, squareW, squareW);
+    glScissor(rightX, 0, squareW, squareW);
+
+    // **Removed** the fixed‐pipeline light marker on steep side
+    {
+        PROFILE_SCOPE("matrices (steep)");
+        setupCamera(MV0, lightEye);
+        buildQuadMatrices(MV0, MVP, invMV);
+    }
+
+    // Render right quad
+    {
+        PROFILE_SCOPE("pass (steep)");
+        GL_DEBUG_GROUP("pass (steep)");
+        GpuTimer_BeginPass(PASS_STEEP);
+        PipeStats_BeginPass(PASS_STEEP, (double)squareW * squareW);
+        drawTechnique(TECH_STEEP, MVP, invMV, lightEye);
+        PipeStats_EndPass(PASS_STEEP);
+        GpuTimer_EndPass(PASS_STEEP);
+    }
+    if (terrain.active && VtFeedback_Begin(terrain.feedback, squareW, squareW)) {
+        PROFILE_SCOPE("pass (terrain feedback)");
+        GL_DEBUG_GROUP("pass (terrain feedback)");
+        drawTerrainFeedback(MVP, invMV);
+        VtFeedback_End(terrain.feedback);
+    }
+
+    // Cleanup
+    glDisable(GL_SCISSOR_TEST);
+    glBindVertexArray(0);
+    GpuTimer_EndFrame();
+    PipeStats_EndFrame();
+    updateAutoTuner();
+}
+
+// Compose the overlay: timings, counters, permutation, memory, toggles and the frame graph
+static void drawHud() {
+    if (!hud.visible || !hud.ready) return;
+    PROFILE_SCOPE("hud");
+    Hud_Begin();
+    const unsigned int white = 0xFFFFFFFF, grey = 0xB0B0B0FF, on = 0x60FF60FF, off = 0xFF6060FF;
+    float x = 10.0f, y = 10.0f, line = Hud_LineHeight();
+
+    double frameMs = hud.frameMs.last();
+    Hud_Text(x, y, white, "frame %.2f ms (%.0f fps)  hud cpu %.3f (submit %.3f) gpu %.3f ms",
+        frameMs, frameMs > 0.0 ? 1000.0 / frameMs : 0.0, hud.cpuMs, hud.submitMs, hud.gpuMs);
+    y += line;
+    Hud_Text(x, y, white, "gpu parallax %.2f ms  steep %.2f ms",
+        gpuPasses[PASS_PARALLAX].window.last(), gpuPasses[PASS_STEEP].window.last());
+    y += line;
+    Hud_Text(x, y, white, "fragments/pixel parallax %.2f steep %.2f  samples/pixel %.2f",
+        PipeStats_LastPerPixel(PASS_PARALLAX, PIPE_FRAGMENT_INVOCATIONS),
+        PipeStats_LastPerPixel(PASS_STEEP, PIPE_FRAGMENT_INVOCATIONS),
+        PipeStats_LastPerPixel(PASS_STEEP, PIPE_SAMPLES_PASSED));
+    y += line;
+    const SteepSettings& st = qualityPresets[tuner.preset].steep;
+    if (fullQuality)
+        Hud_Text(x, y, white, "preset %s%s  steps %.0f/%.0f shadow %.0f/%.0f ao %d pcf %d",
+            qualityPresets[tuner.preset].name, tuner.enabled ? " (auto)" : "", st.traceStepsGrazing, st.traceStepsFacing,
+            st.shadowStepsGrazing, st.shadowStepsFacing, st.aoSamples, st.pcfRings);
+    else
+        Hud_Text(x, y, grey, "fast start: loading, parallax only");
+    y += line;
+    char mem[64];
+    GpuMem_Format(mem, sizeof(mem));
+    Hud_Text(x, y, white, "%s  textures %.1f mb", mem, GpuMem_Total(GPUMEM_MATERIAL) / 1048576.0);
+    y += line;
+    float tx = Hud_Text(x, y, multisampling ? on : off, "[m] msaa  ");
+    tx = Hud_Text(tx, y, bumpy ? on : off, "[b] bumpy  ");
+    tx = Hud_Text(tx, y, selfShadowing ? on : off, "[s] shadow  ");
+    Hud_Text(tx, y, parallaxEnabled ? on : off, "[p] parallax");
+    y += line + 4.0f * HUD_SCALE + 4.0f;
+
+    int stutters = Hud_Graph(x, y, 3.0f * HUD_GRAPH_FRAMES, 80.0f);
+    y += 84.0f;
+    Hud_Text(x, y, stutters ? off : grey, "last %d frames, %d over %.0fx median", hud.frameMs.count, stutters, HUD_STUTTER_FACTOR);
+    Hud_Backdrop(6.0f, 0x000000C0);
+    Hud_End(screenWidth, screenHeight);
+}
+
+// Display callback
+static void Handle_Display() {
+    PROFILE_SCOPE("frame");
+    replayInput(inputFrame);
+    {
+        GL_DEBUG_GROUP("fast start");
+        updateFastStart();
+    }
+    renderScene();
+    {
+        // Interval between presented frames, swap and vsync included
+        static auto lastDisplay = std::chrono::steady_clock::now();
+        auto now = std::chrono::steady_clock::now();
+        double frameMs = std::chrono::duration<double, std::milli>(now - lastDisplay).count();
+        Hud_AddFrame(frameMs);
+        Metrics_Frame(frameMs, qualityPresets[tuner.preset].name);
+        lastDisplay = now;
+    }
+    if (capture.active) {
+        GL_DEBUG_GROUP("capture");
+        glReadBuffer(GL_BACK);
+        Capture_Frame(windowCaptureFrame++);
+    }
+    drawHud();      // after the capture, so recordings are of the scene alone
+    {
+        PROFILE_SCOPE("swap");
+        GL_DEBUG_GROUP("swap");
+        glutSwapBuffers();
+    }
+    notePresentedFrame();
+    ++inputFrame;
+
+    // Show the rolling per-pass GPU times in the title, once a second
+    static auto lastTitle = std::chrono::steady_clock::now();
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastTitle > std::chrono::seconds(1)) {
+        char title[320];
+        int n = snprintf(title, sizeof(title), "[%s%s] ", qualityPresets[tuner.preset].name, tuner.enabled ? " auto" : "");
+        GpuTimer_Format(title + n, sizeof(title) - n);
+        n = (int)strlen(title);
+        n += snprintf(title + n, sizeof(title) - n, ", ");
+        GpuMem_Format(title + n, sizeof(title) - n);
+        glutSetWindowTitle(title);
+        lastTitle = now;
+    }
+}
+
+// 'C': start or stop capturing every frame of the window
+static void toggleWindowCapture() {
+    if (capture.active) {
+        Capture_Shutdown();
+        return;
+    }
+    char prefix[512];
+    snprintf(prefix, sizeof(prefix), "%s_%d", headlessImagePrefix, ++windowCaptureTake);
+    windowCaptureFrame = 0;
+    if (Capture_Init(screenWidth, screenHeight, captureFormat, prefix))
+        fprintf(stdout, "Capturing to %s*\n", prefix);
+}
+
+// Release resources that need a live context, then quit
+static void shutdownApp() {
+    joinFastStart();
+    Input_EndRecord(inputRecorder, inputFrame);
+    Capture_Shutdown();
+    Metrics_Stop();
+    MeshCache_Close(sceneCache);
+    PipeStats_Flush();
+    PipeStats_Print(stdout);
+    if (terrain.active) Terrain_Print(terrain, stdout);
+    Terrain_Close(terrain);
+    PipeStats_Shutdown();
+    GpuTimer_Shutdown();
+    Hud_Shutdown();
+    GLDebug_Shutdown();
+    exit(0);
+}
+
+// Apply a key; live or replayed
+static void applyKey(unsigned char key) {
+    if (key == 'm' || key == 'M') multisampling = !multisampling;
+    if (key == 'b' || key == 'B') bumpy = !bumpy;
+    if (key == 's' || key == 'S') selfShadowing = !selfShadowing;
+    if (key == 'p' || key == 'P') parallaxEnabled = !parallaxEnabled;
+    if (key == 't' || key == 'T') Profiler_WriteTrace(traceFile ? traceFile : "trace.json");
+    if (key == 'c' || key == 'C') toggleWindowCapture();
+    if (key == 'h' || key == 'H') hud.visible = !hud.visible;
+    if (key >= '1' && key < '1' + PRESET_COUNT) {
+        tuner.enabled = false;
+        selectPreset(key - '1');
+    }
+    if (key == 'a' || key == 'A') {
+        tuner.enabled = !tuner.enabled;
+        Tuner_Switch(tuner, tuner.preset);
+    }
+}
+
+// Keyboard handler
+static void Handle_Keyboard(unsigned char key, int x, int y) {
+    if (key == 'q' || key == 'Q' || key == 27) shutdownApp();
+    if (inputReplay.active) return;     // the log drives the session until it ends
+    Input_Record(inputRecorder, inputFrame, INPUT_KEY, key, 0, x, y);
+    applyKey(key);
+}
+
+// Reshape handler
+static void Handle_Reshape(int w, int h) {
+    Input_Record(inputRecorder, inputFrame, INPUT_RESHAPE, 0, 0, w, h);
+    screenWidth = w;
+    screenHeight = h;
+    glViewport(0, 0, w, h);
+    glMatrixMode(GL_PROJECTION);
+    glLoadIdentity();
+    gluPerspective(25.0, (double)w * 0.5 / h, 0.1, 1000.0);
+    glMatrixMode(GL_MODELVIEW);
+}
+
+// Mouse down/up; live or replayed
+static void applyMouse(int button, int state, int x, int y) {
+    if (state == GLUT_DOWN) {
+        mouseButton = button;
+        mouseX = x; mouseY = y;
+    }
+    else {
+        mouseButton = -1;
+    }
+}
+
+// Mouse drag; live or replayed
+static void applyMotion(int x, int y) {
+    if (mouseButton == GLUT_LEFT_BUTTON) {
+        camera_elevate_angle += (y - mouseY);
+        camera_rotate_angle += (x - mouseX);
+    }
+    else if (mouseButton == GLUT_RIGHT_BUTTON) {
+        float s = 0.1f;
+        lightPosition[0] += (x - mouseX) * s;
+        lightPosition[1] -= (y - mouseY) * s;
+    }
+    mouseX = x; mouseY = y;
+}
+
+static void Handle_Mouse(int button, int state, int x, int y) {
+    if (inputReplay.active) return;
+    Input_Record(inputRecorder, inputFrame, INPUT_MOUSE, button, state, x, y);
+    applyMouse(button, state, x, y);
+}
+
+static void Handle_Motion(int x, int y) {
+    if (inputReplay.active) return;
+    Input_Record(inputRecorder, inputFrame, INPUT_MOTION, 0, 0, x, y);
+    applyMotion(x, y);
+    glutPostRedisplay();
+}
+
+// Scene state written at the start of an input log
+static InputLogHeader currentInputState() {
+    InputLogHeader h = {};
+    h.width = screenWidth;
+    h.height = screenHeight;
+    h.rotate = camera_rotate_angle;
+    h.elevate = camera_elevate_angle;
+    memcpy(h.light, lightPosition, sizeof(h.light));
+    h.toggles = (bumpy ? 1 : 0) | (selfShadowing ? 2 : 0) | (multisampling ? 4 : 0) | (parallaxEnabled ? 8 : 0);
+    h.preset = (uint8_t)tuner.preset;
+    h.autoTune = tuner.enabled ? 1 : 0;
+    h.autoTuneMs = (float)tuner.targetMs;
+    return h;
+}
+
+// Restore the state of a log's header; the tuner stays off, its switches are in the log
+static void applyInputState(const InputLogHeader& h) {
+    camera_rotate_angle = h.rotate;
+    camera_elevate_angle = h.elevate;
+    memcpy(lightPosition, h.light, sizeof(h.light));
+    BenchToggles t = Bench_Toggles(h.toggles);
+    bumpy = t.bumpy;
+    selfShadowing = t.selfShadowing;
+    multisampling = t.multisampling;
+    parallaxEnabled = t.parallaxEnabled;
+    tuner.enabled = false;
+    if (h.preset < PRESET_COUNT) selectPreset(h.preset);
+}
+
+// Dispatch the logged events due before this frame
+static void replayInput(uint32_t frame) {
+    if (!inputReplay.active) return;
+    while (const InputEvent* e = Input_Next(inputReplay, frame)) {
+        switch (e->type) {
+        case INPUT_KEY:     applyKey(e->a); break;
+        case INPUT_MOUSE:   applyMouse(e->a, e->b, e->x, e->y); break;
+        case INPUT_MOTION:  applyMotion(e->x, e->y); break;
+        case INPUT_RESHAPE: if (!headlessMode) glutReshapeWindow(e->x, e->y); break;
+        case INPUT_PRESET:  selectPreset(e->a); break;
+        }
+    }
+    tuner.enabled = false;
+    if (frame + 1 >= inputReplay.frames) {
+        inputReplay.active = false;
+        fprintf(stdout, "Replay finished: %u frames, %.1f s when recorded\n",
+            inputReplay.frames, inputReplay.durationUs * 1e-6);
+    }
+}
+
+// Compile/link shaders
+static void initPrograms() {
+    PROFILE_SCOPE("initPrograms");
+    fprintf(stdout, "DEBUG: Compiling/linking GLSL shaders...\n");
+    {
+        STARTUP_PHASE("shader", "parallax");
+        psProg = createShaderProgram("vsParallax.glsl", "psParallax.glsl");
+        GLDebug_Label(GL_PROGRAM, psProg, "psProg");
+    }
+    {
+        STARTUP_PHASE("shader", "steep");
+        psSteepProg = createShaderProgram("vsParallax.glsl", "psSteepParallax.glsl", steepDefines());
+    }
+    presetPrograms[PRESET_HIGH] = psSteepProg;
+    if (!psProg || !psSteepProg) {
+        fprintf(stderr, "ERROR: Shader setup failed\n");
+        exit(1);
+    }
+}
+
+// Map a mesh cache and upload its buffers as they are, with quantized attributes
+static void initCachedGeometry() {
+    {
+        STARTUP_PHASE("mesh cache", meshFile);
+        auto t0 = std::chrono::steady_clock::now();
+        if (!MeshCache_Open(meshFile, sceneCache)) exit(1);
+        const MeshCacheHeader& h = *sceneCache.header;
+        size_t vertexBytes = (size_t)h.vertexCount * sizeof(MeshCacheVertex);
+        size_t indexBytes = (size_t)h.indexCount * h.indexSize;
+        glGenVertexArrays(1, &VAO);
+        glGenBuffers(1, &VBO);
+        glGenBuffers(1, &EBO);
+        glBindVertexArray(VAO);
+        glBindBuffer(GL_ARRAY_BUFFER, VBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexBytes, sceneCache.vertices, GL_STATIC_DRAW);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, sceneCache.indices, GL_STATIC_DRAW);
+        GpuMem_Track(GPUMEM_BUFFER, VBO, GPUMEM_GEOMETRY, meshFile, vertexBytes);
+        GpuMem_Track(GPUMEM_BUFFER, EBO, GPUMEM_GEOMETRY, meshFile, indexBytes);
+        GLDebug_Label(GL_VERTEX_ARRAY, VAO, "VAO (scene mesh)");
+        GLDebug_Label(GL_BUFFER, VBO, "VBO (scene mesh cache)");
+        GLDebug_Label(GL_BUFFER, EBO, "EBO (scene mesh cache)");
+        const GLsizei stride = sizeof(MeshCacheVertex);
+        // layout(location = 0) Position: integers, scaled by PositionScale
+        glVertexAttribPointer(0, 3, GL_SHORT, GL_FALSE, stride, (void*)offsetof(MeshCacheVertex, position));
+        glEnableVertexAttribArray(0);
+        // layout(location = 1) UV: integers, scaled by UVScaleBias
+        glVertexAttribPointer(1, 2, GL_UNSIGNED_SHORT, GL_FALSE, stride, (void*)offsetof(MeshCacheVertex, uv));
+        glEnableVertexAttribArray(1);
+        // layout(location = 2) Normal
+        glVertexAttribPointer(2, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(MeshCacheVertex, normal));
+        glEnableVertexAttribArray(2);
+        // layout(location = 3) Tangent
+        glVertexAttribPointer(3, 4, GL_INT_2_10_10_10_REV, GL_TRUE, stride, (void*)offsetof(MeshCacheVertex, tangent));
+        glEnableVertexAttribArray(3);
+        glBindVertexArray(0);
+        sceneIndexCount = (GLsizei)h.indexCount;
+        sceneIndexType = h.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+        scenePositionScale = h.positionScale;
+        memcpy(sceneUVScaleBias, h.uvScaleBias, sizeof(sceneUVScaleBias));
+        fprintf(stdout, "Mesh cache %s: %u triangles, %u vertices, %zu KB, ACMR %.3f (mapped and uploaded in %.1f ms)\n",
+            meshFile, h.indexCount / 3, h.vertexCount, (vertexBytes + indexBytes) / 1024, h.acmr, Mesh_Ms(t0));
+    }
+    lightMarker = gluNewQuadric();
+}
+
+// Upload sceneMesh as floats into VBO & EBO and point the VAO at them (created on first use)
+static void uploadSceneMesh(const char* name) {
+    size_t vertexBytes = sceneMesh.vertices.size() * sizeof(float);
+    size_t indexBytes = sceneMesh.indices.size() * sizeof(unsigned);
+    if (!VAO) glGenVertexArrays(1, &VAO);
+    if (!VBO) glGenBuffers(1, &VBO);
+    if (!EBO) glGenBuffers(1, &EBO);
+    glBindVertexArray(VAO);
+    glBindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexBytes, sceneMesh.vertices.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexBytes, sceneMesh.indices.data(), GL_STATIC_DRAW);
+    GpuMem_Track(GPUMEM_BUFFER, VBO, GPUMEM_GEOMETRY, name, vertexBytes);
+    GpuMem_Track(GPUMEM_BUFFER, EBO, GPUMEM_GEOMETRY, name, indexBytes);
+    GLDebug_Label(GL_VERTEX_ARRAY, VAO, "VAO (scene mesh)");
+    GLDebug_Label(GL_BUFFER, VBO, "VBO (scene mesh)");
+    GLDebug_Label(GL_BUFFER, EBO, "EBO (scene mesh)");
+    // layout(location = 0) Position
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)0);
+    glEnableVertexAttribArray(0);
+    // layout(location = 1) UV
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)(3 * sizeof(float)));
+    glEnableVertexAttribArray(1);
+    // layout(location = 2) Normal
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)(5 * sizeof(float)));
+    glEnableVertexAttribArray(2);
+    // layout(location = 3) Tangent
+    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, 12 * sizeof(float), (void*)(8 * sizeof(float)));
+    glEnableVertexAttribArray(3);
+    glBindVertexArray(0);
+    sceneIndexCount = (GLsizei)sceneMesh.indices.size();
+    sceneIndexType = GL_UNSIGNED_INT;
+    scenePositionScale = 1.0f;
+    const float identity[4] = { 1.0f, 1.0f, 0.0f, 0.0f };
+    memcpy(sceneUVScaleBias, identity, sizeof(sceneUVScaleBias));
+}
+
+// Load the scene mesh (or take the quad) and prepare VBO, EBO & VAO
+static void initGeometry() {
+    if (meshFile && MeshCache_Is(meshFile)) {
+        initCachedGeometry();
+        return;
+    }
+    if (meshFile) {
+        STARTUP_PHASE("mesh", meshFile);
+        MeshLoadStats st;
+        if (!Mesh_LoadObj(meshFile, sceneMesh, &st)) exit(1);
+        Mesh_Fit(sceneMesh, MESH_RADIUS);
+        fprintf(stdout, "Mesh %s: %zu triangles, %zu vertices (parse %.1f ms, weld %.1f ms, tangents %.1f ms)\n",
+            meshFile, st.triangles, st.vertices, st.parseMs, st.weldMs, st.tangentMs);
+    }
+    else {
+        sceneMesh.vertices.assign(quadVertices, quadVertices + sizeof(quadVertices) / sizeof(float));
+        sceneMesh.indices.assign(quadIndices, quadIndices + sizeof(quadIndices) / sizeof(unsigned));
+    }
+    uploadSceneMesh(meshFile ? meshFile : "quad");
+
+    lightMarker = gluNewQuadric();
+}
+
+// Scene textures: GL object, CPU reference copy and a 1x1 placeholder for fast start
+struct SceneTexture {
+    const char*   path;
+    const char*   label;    // debug label: the variable holding the id
+    GLuint*       id;
+    CpuTexture*   cpu;
+    unsigned char placeholder[3];
+};
+static const SceneTexture sceneTextures[] = {
+    { "lion.bmp",        "texture_id",       &texture_id,       &cpuDiffuse, { 128, 128, 128 } },
+    { "lion-bump.bmp",   "bumpTexture_id",   &bumpTexture_id,   &cpuHeight,  { 128, 128, 128 } },   // mid height: no offset
+    { "lion-normal.bmp", "normalTexture_id", &normalTexture_id, &cpuNormal,  { 128, 128, 255 } },   // flat normal
+};
+static const int sceneTextureCount = sizeof(sceneTextures) / sizeof(sceneTextures[0]);
+
+// (Re)specify a repeating, linearly filtered RGB texture
+static void uploadTexture(GLuint id, const char* name, const unsigned char* rgb, int width, int height) {
+    PROFILE_SCOPE("texture upload");
+    glBindTexture(GL_TEXTURE_2D, id);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, rgb);
+    GpuMem_Track(GPUMEM_TEXTURE, id, GPUMEM_MATERIAL, name, GpuMem_TextureBytes(width, height, 4));
+}
+
+// Once a texture is at full size, let the memory budget shrink it: each dropped level
+// halves both dimensions of the upload (the CPU reference keeps the full image)
+static void allowTextureReduce(const SceneTexture& t) {
+    GpuMem_SetReducer(GPUMEM_TEXTURE, *t.id, [&t](int drop) {
+        std::vector<unsigned char> low;
+        int w = 0, h = 0;
+        Startup_Downsample(t.cpu->rgb, t.cpu->width, t.cpu->height, drop, low, w, h);
+        uploadTexture(*t.id, t.path, low.data(), w, h);
+        return GpuMem_TextureBytes(w, h, 4);
+    });
+}
+
+// Load a 24-bit BMP and upload it
+static void loadTexture(const SceneTexture& t) {
+    {
+        STARTUP_PHASE("BMP_Read", t.path);
+        PROFILE_SCOPE("BMP_Read");
+        if (!BMP_Read(t.path, &image_data, image_width, image_height)) {
+            fprintf(stderr, "ERROR: cannot load texture '%s'\n", t.path);
+            exit(1);
+        }
+    }
+    t.cpu->width = image_width;
+    t.cpu->height = image_height;
+    t.cpu->rgb.assign(image_data, image_data + (size_t)image_width * image_height * 3);
+
+    STARTUP_PHASE("upload", t.path);
+    glGenTextures(1, t.id);
+    uploadTexture(*t.id, t.path, image_data, image_width, image_height);
+    GLDebug_Label(GL_TEXTURE, *t.id, t.label);
+    allowTextureReduce(t);
+}
+
+// Load diffuse, bump and normal maps
+static void initTextures() {
+    for (int k = 0; k < sceneTextureCount; ++k) loadTexture(sceneTextures[k]);
+}
+
+// Fast start: placeholder textures and the plain normal-mapping program only; the
+// loader thread reads the BMPs and updateFastStart() brings in the rest
+static void initFastStart() {
+    for (int k = 0; k < sceneTextureCount; ++k) {
+        glGenTextures(1, sceneTextures[k].id);
+        uploadTexture(*sceneTextures[k].id, sceneTextures[k].path, sceneTextures[k].placeholder, 1, 1);
+        GLDebug_Label(GL_TEXTURE, *sceneTextures[k].id, sceneTextures[k].label);
+        startupImages[k].path = sceneTextures[k].path;
+    }
+    startupLoader = Startup_LoadImages(startupImages, sceneTextureCount);
+    {
+        STARTUP_PHASE("shader", "parallax");
+        psProg = createShaderProgram("vsParallax.glsl", "psParallax.glsl");
+        GLDebug_Label(GL_PROGRAM, psProg, "psProg");
+    }
+    if (!psProg) {
+        fprintf(stderr, "ERROR: Shader setup failed\n");
+        exit(1);
+    }
+    fullQuality = false;
+}
+
+// One fast-start step per frame: the low copies of every image read so far, else one
+// full-size texture, else the steep-parallax program, after which the frame is complete
+static void updateFastStart() {
+    if (fullQuality) return;
+    PROFILE_SCOPE("fast start");
+    bool lows = false, pending = false;
+    for (int k = 0; k < sceneTextureCount; ++k) {
+        StartupImage& img = startupImages[k];
+        int state = img.state.load(std::memory_order_acquire);
+        if (state < 0) {
+            fprintf(stderr, "ERROR: cannot load texture '%s'\n", img.path);
+            exit(1);
+        }
+        if (state == 0) pending = true;
+        if (state == 1 && img.uploaded == 0) {
+            uploadTexture(*sceneTextures[k].id, img.path, img.low.data(), img.lowWidth, img.lowHeight);
+            img.uploaded = 1;
+            lows = true;
+        }
+    }
+    if (lows) return;
+    for (int k = 0; k < sceneTextureCount; ++k) {
+        StartupImage& img = startupImages[k];
+        if (img.uploaded != 1) continue;
+        STARTUP_PHASE("upload", img.path);
+        uploadTexture(*sceneTextures[k].id, img.path, img.rgb.data(), img.width, img.height);
+        CpuTexture* cpu = sceneTextures[k].cpu;
+        cpu->width = img.width;
+        cpu->height = img.height;
+        cpu->rgb.swap(img.rgb);
+        allowTextureReduce(sceneTextures[k]);
+        img.uploaded = 2;
+        return;
+    }
+    if (pending) return;
+    startupLoader.join();
+    if (!presetPrograms[PRESET_HIGH]) {     // a preset key during the fast start may have built it
+        STARTUP_PHASE("shader", "steep");
+        presetPrograms[PRESET_HIGH] = createShaderProgram("vsParallax.glsl", "psSteepParallax.glsl", steepDefines());
+    }
+    psSteepProg = presetPrograms[PRESET_HIGH];
+    if (!psSteepProg || !selectPreset(tuner.preset)) {
+        fprintf(stderr, "ERROR: Shader setup failed\n");
+        exit(1);
+    }
+    fullQuality = true;
+}
+
+// Modes that measure or compare need every asset: finish a fast start right away
+static void finishFastStart() {
+    while (!fullQuality) {
+        updateFastStart();
+        if (!fullQuality) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+}
+
+// Exiting before the fast start is complete: wait for the loader thread
+static void joinFastStart() {
+    if (startupLoader.joinable()) startupLoader.join();
+}
+
+// Startup latencies, taken once the frame has really been drawn; the report follows
+// the first frame, or the first full-quality one with --fast-start
+static void notePresentedFrame() {
+    bool first = startup.firstFrameMs < 0.0;
+    bool full = fastStart && fullQuality && startup.fullQualityMs < 0.0;
+    if (!first && !full) return;
+    glFinish();
+    if (first) startup.firstFrameMs = Startup_Now();
+    if (full) startup.fullQualityMs = Startup_Now();
+    if (!fullQuality) return;
+    if (fastStart)
+        fprintf(stdout, "Startup: first frame after %.1f ms, full quality after %.1f ms\n",
+            startup.firstFrameMs, startup.fullQualityMs);
+    else
+        fprintf(stdout, "Startup: first frame after %.1f ms\n", startup.firstFrameMs);
+    if (startupReport) {
+        Startup_Print(stdout);
+        GpuMem_Print(stdout);
+    }
+}
+
+// GL state, assets and shaders shared by the windowed and headless paths
+static void initScene() {
+    Profiler_SetEnabled(profileEnabled);
+    Profiler_SetThreadName("main");
+    PROFILE_SCOPE("initScene");
+
+    glEnable(GL_DEPTH_TEST);
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GpuMem_SetBudget((size_t)(gpuBudgetMB * 1048576.0));
+    if (terrainFile) {
+        STARTUP_PHASE("terrain");
+        terrain.budgetBytes = (size_t)terrainBudgetKB * 1024;
+        terrain.slotLimit = terrainSlots;
+        if (!Terrain_Open(terrain, terrainFile)) exit(1);
+        terrainFeedbackProg = createShaderProgram("vsParallax.glsl", "psTerrainFeedback.glsl", Terrain_ShaderDefines());
+        if (!terrainFeedbackProg) exit(1);
+        GLDebug_Label(GL_PROGRAM, terrainFeedbackProg, "terrainFeedbackProg");
+    }
+
+    if (fastStart) {
+        initFastStart();
+    }
+    else {
+        initTextures();
+        initPrograms();
+        STARTUP_PHASE("shader", "preset");
+        if (!selectPreset(tuner.preset)) exit(1);
+    }
+    STARTUP_PHASE("geometry + GPU timers");
+    initGeometry();
+    GpuTimer_Init(gpuTimingsFile);
+    PipeStats_Init();
+    {
+        STARTUP_PHASE("shader", "hud");
+        GLuint hudProg = createShaderProgram("vsHud.glsl", "psHud.glsl");
+        GLDebug_Label(GL_PROGRAM, hudProg, "hud");
+        if (!Hud_Init(hudProg)) fprintf(stderr, "WARNING: HUD shader setup failed, no overlay\n");
+        hud.visible = hudAtStart;
+    }
+    if ((metricsFile || metricsSocket) && !Metrics_Start(metricsFile, metricsSocket, metricsIntervalS))
+        fprintf(stderr, "WARNING: metrics export is off\n");
+}
+
+// Render one frame and wait for it, so the wall time covers the GPU work too
+static double renderTimedFrame() {
+    auto t0 = std::chrono::steady_clock::now();
+    {
+        PROFILE_SCOPE("frame");
+        renderScene();
+        PROFILE_SCOPE("glFinish");
+        glFinish();
+    }
+    auto t1 = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(t1 - t0).count();
+}
+
+// Render headlessFrames frames, optionally dumping images and per-frame timings
+static int renderFrames() {
+    FILE* timings = nullptr;
+    if (headlessTimingsFile) {
+        timings = fopen(headlessTimingsFile, "w");
+        if (!timings) {
+            fprintf(stderr, "ERROR: cannot write '%s'\n", headlessTimingsFile);
+            return 1;
+        }
+        fprintf(timings, "frame,ms\n");
+    }
+
+    // Dumps go through the PBO ring, so they do not stall the next frame
+    if (!Capture_Init(screenWidth, screenHeight, captureFormat, headlessImagePrefix)) {
+        if (timings) fclose(timings);
+        return 1;
+    }
+
+    double totalMs = 0.0, minMs = 1e30, maxMs = 0.0;
+    for (int frame = 0; frame < headlessFrames; ++frame) {
+        replayInput(frame);
+        updateFastStart();
+        double ms = renderTimedFrame();
+        Hud_AddFrame(ms);
+        Metrics_Frame(ms, qualityPresets[tuner.preset].name);
+        notePresentedFrame();
+        totalMs += ms;
+        if (ms < minMs) minMs = ms;
+        if (ms > maxMs) maxMs = ms;
+        if (timings) fprintf(timings, "%d,%.4f\n", frame, ms);
+
+        bool lastFrame = (frame == headlessFrames - 1);
+        if ((headlessDumpEvery > 0 && frame % headlessDumpEvery == 0) || (headlessDumpEvery == 0 && lastFrame)) {
+            Headless_BindForRead();
+            Capture_Frame(frame);
+            glBindFramebuffer(GL_FRAMEBUFFER, headlessTarget.fbo);
+        }
+        drawHud();      // after the capture: dumped frames stay comparable with and without --hud
+    }
+    finishFastStart();      // a run shorter than the fast start still ends with every asset in
+    if (timings) fclose(timings);
+    Capture_Shutdown();
+
+    if (headlessFrames > 0) {
+        char gpu[256];
+        GpuTimer_Format(gpu, sizeof(gpu));
+        fprintf(stdout, "Rendered %d frames at %dx%d: avg %.3f ms, min %.3f ms, max %.3f ms\n",
+            headlessFrames, screenWidth, screenHeight, totalMs / headlessFrames, minMs, maxMs);
+        fprintf(stdout, "GPU: %s\n", gpu);
+        PipeStats_Flush();
+        PipeStats_Print(stdout);
+        if (terrain.active) Terrain_Print(terrain, stdout);
+        Hud_Print(stdout);
+    }
+    GpuMem_Print(stdout);
+    return 0;
+}
+
+// Put the camera and light where a benchmark path says
+static void applyBenchView(const BenchView& v) {
+    camera_rotate_angle = v.rotate;
+    camera_elevate_angle = v.elevate;
+    lightPosition[0] = v.light[0];
+    lightPosition[1] = v.light[1];
+    lightPosition[2] = v.light[2];
+}
+
+// The CPU kernels under hardware counters: the reference sampler on a coherent and on a
+// scattered walk, both reference shaders, the image metrics and the asset kernels
+static std::vector<PerfKernelResult> runCpuKernels() {
+    std::vector<PerfKernelResult> results;
+    if (kernelRuns <= 0) return results;
+    float MV0[16], MVP[16], invMV[16], lightEye[3];
+    bumpy = false;
+    selfShadowing = true;
+    parallaxEnabled = true;
+    BenchView view;
+    benchPaths[0].eval(0.5f, view);
+    applyBenchView(view);
+    setupCamera(MV0, lightEye);
+    buildQuadMatrices(MV0, MVP, invMV);
+
+    PerfCounters pc;
+    PerfCounters_Open(pc);
+    const int sampleCount = 1 << 20;
+    volatile float sink = 0.0f;     // keeps the sampler loops alive
+    results.push_back(PerfKernel_Run(pc, "sampler_coherent", kernelRuns, [&]() {
+        float sum = 0.0f;
+        Vec2 uv = v2(0.1f, 0.2f);
+        for (int i = 0; i < sampleCount; ++i, uv = uv + v2(0.00037f, 0.00011f)) sum += CpuRef_SampleR(cpuHeight, uv);
+        sink = sum;
+    }));
+    results.push_back(PerfKernel_Run(pc, "sampler_scattered", kernelRuns, [&]() {
+        float sum = 0.0f;
+        unsigned h = 12345u;
+        for (int i = 0; i < sampleCount; ++i) {
+            h = h * 1664525u + 1013904223u;
+            sum += CpuRef_SampleR(cpuHeight, v2((h >> 16) * (1.0f / 65536.0f), (h & 0xFFFF) * (1.0f / 65536.0f)));
+        }
+        sink = sum;
+    }));
+    CpuFrame frames[TECH_COUNT];
+    for (int t = 0; t < TECH_COUNT; ++t) {
+        std::string name = std::string("reference_") + techniques[t].name;
+        results.push_back(PerfKernel_Run(pc, name.c_str(), kernelRuns, [&]() {
+            renderReference(currentCpuShading((ShadingTechnique)t), MVP, invMV, lightEye, qualitySize, frames[t]);
+        }));
+    }
+    std::vector<float> errorMap;
+    results.push_back(PerfKernel_Run(pc, "image_ssim", kernelRuns, [&]() {
+        sink = (float)Image_SSIM(frames[0].rgb.data(), frames[1].rgb.data(), qualitySize, qualitySize);
+    }));
+    results.push_back(PerfKernel_Run(pc, "image_flip", kernelRuns, [&]() {
+        sink = (float)Image_PerceptualDiff(frames[0].rgb.data(), frames[1].rgb.data(), qualitySize, qualitySize, errorMap);
+    }));
+    results.push_back(PerfKernel_Run(pc, "bmp_decode", kernelRuns, [&]() {
+        BYTE* pixels = nullptr;
+        int w = 0, h = 0;
+        if (BMP_Read(sceneTextures[0].path, &pixels, w, h)) delete[] pixels;
+    }));
+    std::vector<unsigned char> low;
+    results.push_back(PerfKernel_Run(pc, "texture_downsample", kernelRuns, [&]() {
+        int w = 0, h = 0;
+        Startup_Downsample(cpuDiffuse.rgb, cpuDiffuse.width, cpuDiffuse.height, 1, low, w, h);
+    }));
+    PerfCounters_Close(pc);
+    PerfKernel_Print(stdout, results);
+    return results;
+}
+
+// Play every camera/light path under every toggle combination and write the JSON report
+static int runBenchmark() {
+    std::vector<BenchResult> results;
+    for (int p = 0; p < benchPathCount; ++p) {
+        const BenchPath& path = benchPaths[p];
+        for (int c = 0; c < benchToggleCount; ++c) {
+            BenchToggles toggles = Bench_Toggles(c);
+            bumpy = toggles.bumpy;
+            selfShadowing = toggles.selfShadowing;
+            multisampling = toggles.multisampling;
+            parallaxEnabled = toggles.parallaxEnabled;
+
+            // Warm up on the first view of the path (shader caches, texture residency)
+            BenchView view;
+            path.eval(0.0f, view);
+            applyBenchView(view);
+            for (int i = 0; i < benchWarmupFrames; ++i) renderTimedFrame();
+
+            std::vector<double> frameMs;
+            std::vector<double> gpuMs[PASS_COUNT];
+            GpuTimer_BeginCapture();
+            PipeStats_Flush();
+            PipeStats_Reset();
+            for (int f = 0; f < headlessFrames; ++f) {
+                path.eval((float)f / (float)headlessFrames, view);
+                applyBenchView(view);
+                frameMs.push_back(renderTimedFrame());
+            }
+            GpuTimer_EndCapture(gpuMs);
+            PipeStats_Flush();
+
+            BenchResult r;
+            r.path = path.name;
+            r.toggles = toggles;
+            r.frameMs = summarize(frameMs);
+            r.parallaxMs = summarize(gpuMs[PASS_PARALLAX]);
+            r.steepMs = summarize(gpuMs[PASS_STEEP]);
+            r.counters = PipeStats_Json(PASS_PARALLAX, "parallax");
+            std::string steep = PipeStats_Json(PASS_STEEP, "steep");
+            if (!r.counters.empty() && !steep.empty()) r.counters += ",";
+            r.counters += steep;
+
+            // Texture fetches per pixel of the CPU reference on the path's middle view
+            if (!terrain.active) {
+                float MV0[16], MVP[16], invMV[16], lightEye[3];
+                path.eval(0.5f, view);
+                applyBenchView(view);
+                setupCamera(MV0, lightEye);
+                buildQuadMatrices(MV0, MVP, invMV);
+                CpuFrame frame;
+                renderReference(currentCpuShading(TECH_PARALLAX), MVP, invMV, lightEye, qualitySize, frame);
+                r.parallaxFetches = CpuRef_FetchDistribution(frame, -1);
+                renderReference(currentCpuShading(TECH_STEEP), MVP, invMV, lightEye, qualitySize, frame);
+                r.steepFetches = CpuRef_FetchDistribution(frame, -1);
+            }
+            results.push_back(r);
+
+            fprintf(stdout, "%-12s bumpy=%d shadow=%d msaa=%d parallax=%d  frame p50 %.3f p95 %.3f | parallax %.3f | steep %.3f ms\n",
+                path.name, toggles.bumpy, toggles.selfShadowing, toggles.multisampling, toggles.parallaxEnabled,
+                r.frameMs.p50, r.frameMs.p95, r.parallaxMs.p50, r.steepMs.p50);
+        }
+    }
+    std::vector<PerfKernelResult> kernels = runCpuKernels();
+    const char* renderer = (const char*)glGetString(GL_RENDERER);
+    if (historyFile) {
+        HistoryRunInfo info;
+        History_Fingerprint(renderer, (const char*)glGetString(GL_VERSION), info);
+        History_Now(info);
+        info.commit = History_Commit(historyCommit);
+        info.width = screenWidth;
+        info.height = screenHeight;
+        History_Append(historyFile, info, results);
+    }
+    GpuMem_Print(stdout);
+    std::string extra = GpuMem_Json();
+    if (!kernels.empty()) extra += ",\n  " + PerfKernel_Json(kernels);
+    return Bench_WriteJson(benchmarkFile, renderer, screenWidth, screenHeight,
+                           benchWarmupFrames, headlessFrames, results, extra.c_str()) ? 0 : 1;
+}
+
+// Render one technique alone into a size x size square at the origin of the target
+static void renderTechniqueView(ShadingTechnique tech, int size, float MVP[16], float invMV[16], float lightEye[3]) {
+    float MV0[16];
+    glEnable(GL_SCISSOR_TEST);
+    glViewport(0, 0, size, size);
+    glScissor(0, 0, size, size);
+    glClearColor(0, 0, 0, 1);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    setupCamera(MV0, lightEye);
+    buildQuadMatrices(MV0, MVP, invMV);
+    drawTechnique(tech, MVP, invMV, lightEye);
+    glDisable(GL_SCISSOR_TEST);
+    glBindVertexArray(0);
+}
+
+// Blocking readback of the size x size square at the origin (rows bottom-up)
+static void readViewport(int size, std::vector<unsigned char>& rgb) {
+    rgb.resize((size_t)size * size * 3);
+    Headless_BindForRead();
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, size, size, GL_RGB, GL_UNSIGNED_BYTE, rgb.data());
+    glBindFramebuffer(GL_FRAMEBUFFER, headlessTarget.fbo);
+}
+
+// CPU reference settings matching the current toggles
+static CpuShading currentCpuShading(ShadingTechnique tech) {
+    CpuShading s;
+    s.technique = tech;
+    s.bumpScale = bumpy ? 0.125f : 0.05f;
+    s.parallax = parallaxEnabled;
+    s.selfShadow = selfShadowing;
+    s.steep = qualityPresets[tuner.preset].steep;
+    return s;
+}
+
+// CPU reference render of the scene mesh into a size x size viewport
+static void renderReference(const CpuShading& shading, const float MVP[16], const float invMV[16],
+                            const float lightEye[3], int size, CpuFrame& out) {
+    const CpuMaterial material = { &cpuDiffuse, &cpuHeight, &cpuNormal };
+    if (sceneCache.header && sceneMesh.indices.empty()) MeshCache_Decode(sceneCache, sceneMesh);
+    CpuRef_Render(shading, material, sceneMesh.vertices.data(), sceneMesh.indices.data(), (int)sceneMesh.indices.size(),
+                  MVP, invMV, lightEye, size, out);
+}
+
+// A/B comparison of all techniques: interleaved trials in random order on identical views
+// for cost, plus PSNR against the high-sample CPU reference for quality
+static int runCompare() {
+    int size = (screenWidth < screenHeight ? screenWidth : screenHeight);
+    float MVP[16], invMV[16], lightEye[3];
+    std::mt19937 rng(compareSeed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+
+    if (multisampling) glEnable(GL_MULTISAMPLE);
+    else               glDisable(GL_MULTISAMPLE);
+
+    // Warm up every technique before anything is measured
+    for (int i = 0; i < benchWarmupFrames; ++i)
+        for (int t = 0; t < TECH_COUNT; ++t) {
+            renderTechniqueView((ShadingTechnique)t, size, MVP, invMV, lightEye);
+            glFinish();
+        }
+
+    // Cost: each trial picks a random view, then runs the techniques in shuffled order
+    std::vector<double> cost[TECH_COUNT];
+    for (int trial = 0; trial < compareTrials; ++trial) {
+        BenchView view;
+        benchPaths[rng() % benchPathCount].eval(uniform(rng), view);
+        applyBenchView(view);
+
+        int order[TECH_COUNT];
+        for (int t = 0; t < TECH_COUNT; ++t) order[t] = t;
+        std::shuffle(order, order + TECH_COUNT, rng);
+        for (int k = 0; k < TECH_COUNT; ++k) {
+            glFinish();
+            auto t0 = std::chrono::steady_clock::now();
+            renderTechniqueView((ShadingTechnique)order[k], size, MVP, invMV, lightEye);
+            glFinish();
+            auto t1 = std::chrono::steady_clock::now();
+            cost[order[k]].push_back(std::chrono::duration<double, std::milli>(t1 - t0).count());
+        }
+    }
+
+    // Quality: fixed views, single-sampled, against the CPU ground truth
+    std::vector<double> psnr[TECH_COUNT], ssim[TECH_COUNT], flip[TECH_COUNT];
+    std::vector<unsigned char> gl;
+    std::vector<float> errorMap;
+    glDisable(GL_MULTISAMPLE);
+    for (int q = 0; q < qualityViews; ++q) {
+        BenchView view;
+        benchPaths[q % benchPathCount].eval((q + 0.5f) / qualityViews, view);
+        applyBenchView(view);
+
+        CpuFrame truth;
+        CpuShading ref = currentCpuShading(TECH_STEEP);
+        ref.steep = SteepSettings_Reference();
+        for (int t = 0; t < TECH_COUNT; ++t) {
+            renderTechniqueView((ShadingTechnique)t, qualitySize, MVP, invMV, lightEye);
+            readViewport(qualitySize, gl);
+            if (t == 0)
+                renderReference(ref, MVP, invMV, lightEye, qualitySize, truth);
+            psnr[t].push_back(Image_PSNR(gl.data(), truth.rgb.data(), truth.coverage.size(), truth.coverage.data()));
+            ssim[t].push_back(Image_SSIM(gl.data(), truth.rgb.data(), qualitySize, qualitySize, truth.coverage.data()));
+            flip[t].push_back(Image_PerceptualDiff(gl.data(), truth.rgb.data(), qualitySize, qualitySize,
+                                                   errorMap, truth.coverage.data()));
+            if (diffMapPrefix) {
+                char path[512];
+                snprintf(path, sizeof(path), "%s_%s_%d.ppm", diffMapPrefix, techniques[t].name, q);
+                Image_WriteHeatmap(path, errorMap, qualitySize, qualitySize, true);
+            }
+        }
+    }
+
+    FILE* f = fopen(compareFile, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", compareFile);
+        return 1;
+    }
+    fprintf(f, "{\n  \"renderer\": \"%s\",\n  \"size\": %d,\n  \"trials\": %d,\n  \"seed\": %u,\n"
+               "  \"quality_size\": %d,\n  \"quality_views\": %d,\n  \"baseline\": \"%s\",\n  \"techniques\": [\n",
+        Json_Escape((const char*)glGetString(GL_RENDERER)).c_str(), size, compareTrials, compareSeed,
+        qualitySize, qualityViews, techniques[0].name);
+    fprintf(stdout, "%-10s %10s %10s %20s %10s %8s %8s\n", "technique", "mean ms", "ratio", "95% CI", "PSNR dB", "SSIM", "FLIP");
+    for (int t = 0; t < TECH_COUNT; ++t) {
+        double lo = 1.0, hi = 1.0;
+        double ratio = mean(cost[t]) / mean(cost[0]);
+        if (t != 0) bootstrapRatioCI(cost[0], cost[t], 2000, compareSeed, 0.95, &lo, &hi);
+        double quality = mean(psnr[t]);
+
+        fprintf(f, "    {\"name\":\"%s\",", techniques[t].name);
+        Json_WriteStats(f, "cost_ms", summarize(cost[t]));
+        fprintf(f, ",\"cost_ratio\":%.4f,\"ratio_ci95\":[%.4f,%.4f],\"psnr_db\":%.3f,\"ssim\":%.5f,\"flip\":%.5f}%s\n",
+            ratio, lo, hi, quality, mean(ssim[t]), mean(flip[t]), t + 1 < TECH_COUNT ? "," : "");
+        fprintf(stdout, "%-10s %10.3f %10.3f %9.3f - %-8.3f %10.2f %8.4f %8.4f\n",
+            techniques[t].name, mean(cost[t]), ratio, lo, hi, quality, mean(ssim[t]), mean(flip[t]));
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+// Count the texture fetches of both shaders on the quality views with the current
+// preset and toggles, by stage and map, and write every frame's totals and
+// per-pixel distributions as JSON
+static int runFetchReport() {
+    float MV0[16], MVP[16], invMV[16], lightEye[3];
+    FILE* f = fopen(fetchReportFile, "w");
+    if (!f) {
+        fprintf(stderr, "ERROR: cannot write '%s'\n", fetchReportFile);
+        return 1;
+    }
+    fprintf(f, "{\n  \"preset\": \"%s\",\n  \"size\": %d,\n  \"bumpy\": %s,\n  \"self_shadowing\": %s,\n  \"frames\": [\n",
+        qualityPresets[tuner.preset].name, qualitySize, bumpy ? "true" : "false", selfShadowing ? "true" : "false");
+    for (int q = 0; q < qualityViews; ++q) {
+        const BenchPath& path = benchPaths[q % benchPathCount];
+        float t = (q + 0.5f) / qualityViews;
+        BenchView view;
+        path.eval(t, view);
+        applyBenchView(view);
+        setupCamera(MV0, lightEye);
+        buildQuadMatrices(MV0, MVP, invMV);
+        for (int k = 0; k < TECH_COUNT; ++k) {
+            CpuFrame frame;
+            renderReference(currentCpuShading((ShadingTechnique)k), MVP, invMV, lightEye, qualitySize, frame);
+            StatSummary all = CpuRef_FetchDistribution(frame, -1);
+            fprintf(stdout, "view %d (%s %.2f) %s: %llu fetches, %.1f per pixel (p95 %.0f, max %.0f)\n",
+                q, path.name, t, techniques[k].name, frame.fetches, all.avg, all.p95, all.max);
+            CpuRef_PrintFetches(stdout, frame);
+            fprintf(f, "    {\"view\":%d,\"path\":\"%s\",\"t\":%.3f,\"technique\":\"%s\",\"fetches\":%s}%s\n",
+                q, path.name, t, techniques[k].name, CpuRef_FetchJson(frame).c_str(),
+                q + 1 < qualityViews || k + 1 < TECH_COUNT ? "," : "");
+        }
+    }
+    fprintf(f, "  ]\n}\n");
+    fclose(f);
+    return 0;
+}
+
+// Score every point of the steep-parallax parameter grid on the quality views, either
+// with the CPU reference (cost = texture fetches) or with GL (cost = time), against
+// the high-sample reference; report the Pareto frontier and recommended presets
+static int runSweep() {
+    float MV0[16], MVP[16], invMV[16], lightEye[3];
+    glDisable(GL_MULTISAMPLE);
+
+    // Views and their ground truth, shared by every point
+    std::vector<BenchView> views(qualityViews);
+    std::vector<CpuFrame> truth(qualityViews);
+    std::vector<double> covered(qualityViews);
+    CpuShading shading = currentCpuShading(TECH_STEEP);
+    CpuShading ref = shading;
+    ref.steep = SteepSettings_Reference();
+    for (int q = 0; q < qualityViews; ++q) {
+        benchPaths[q % benchPathCount].eval((q + 0.5f) / qualityViews, views[q]);
+        applyBenchView(views[q]);
+        setupCamera(MV0, lightEye);
+        buildQuadMatrices(MV0, MVP, invMV);
+        renderReference(ref, MVP, invMV, lightEye, qualitySize, truth[q]);
+        covered[q] = 0.0;
+        for (unsigned char c : truth[q].coverage) covered[q] += c;
+    }
+
+    std::vector<SteepSettings> grid = Sweep_Grid();
+    fprintf(stdout, "Sweeping %zu settings on %d views at %dx%d (%s)\n",
+        grid.size(), qualityViews, qualitySize, qualitySize, sweepOnGL ? "GL" : "CPU reference");
+    std::vector<SweepPoint> points;
+    std::vector<unsigned char> gl;
+    GLuint defaultProgram = psSteepProg;
+    for (size_t g = 0; g < grid.size(); ++g) {
+        SweepPoint p;
+        p.settings = grid[g];
+        if (sweepOnGL) {
+            psSteepProg = createShaderProgram("vsParallax.glsl", "psSteepParallax.glsl", steepDefines(Sweep_ShaderDefines(p.settings)));
+            if (!psSteepProg) {
+                psSteepProg = defaultProgram;
+                return 1;
+            }
+        }
+        for (int q = 0; q < qualityViews; ++q) {
+            applyBenchView(views[q]);
+            const unsigned char* image = nullptr;
+            CpuFrame frame;
+            if (sweepOnGL) {
+                std::vector<double> ms;
+                renderTechniqueView(TECH_STEEP, qualitySize, MVP, invMV, lightEye);
+                for (int r = 0; r < sweepRepeats; ++r) {
+                    glFinish();
+                    auto t0 = std::chrono::steady_clock::now();
+                    renderTechniqueView(TECH_STEEP, qualitySize, MVP, invMV, lightEye);
+                    glFinish();
+                    ms.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+                }
+                p.ms += summarize(ms).p50;
+                readViewport(qualitySize, gl);
+                image = gl.data();
+            }
+            else {
+                shading.steep = p.settings;
+                setupCamera(MV0, lightEye);
+                buildQuadMatrices(MV0, MVP, invMV);
+                auto t0 = std::chrono::steady_clock::now();
+                renderReference(shading, MVP, invMV, lightEye, qualitySize, frame);
+                p.ms += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+                p.fetchesPerPixel += covered[q] > 0.0 ? frame.fetches / covered[q] : 0.0;
+                image = frame.rgb.data();
+            }
+            p.psnr += Image_PSNR(image, truth[q].rgb.data(), truth[q].coverage.size(), truth[q].coverage.data());
+            p.ssim += Image_SSIM(image, truth[q].rgb.data(), qualitySize, qualitySize, truth[q].coverage.data());
+        }
+        if (sweepOnGL) {
+            glDeleteProgram(psSteepProg);
+            psSteepProg = defaultProgram;
+        }
+        p.ms /= qualityViews;
+        p.fetchesPerPixel /= qualityViews;
+        p.psnr /= qualityViews;
+        p.ssim /= qualityViews;
+        points.push_back(p);
+        fprintf(stdout, "[%zu/%zu] trace %3.0f ao %2d/%.3f pcf %d shadow %3.0f  %9.3f ms %8.1f fetch/px  %6.2f dB  ssim %.4f\n",
+            g + 1, grid.size(), p.settings.traceStepsGrazing, p.settings.aoSamples, p.settings.aoRadius,
+            p.settings.pcfRings, p.settings.shadowStepsGrazing, p.ms, p.fetchesPerPixel, p.psnr, p.ssim);
+    }
+
+    bool byFetches = !sweepOnGL;
+    Sweep_MarkPareto(points, byFetches);
+    for (int k = 0; k < sweepPresetCount; ++k) {
+        int i = Sweep_Recommend(points, byFetches, sweepPresets[k].budget);
+        if (i < 0) {
+            fprintf(stdout, "%-7s no frontier point within %.0f%% of the default cost\n", sweepPresets[k].name, sweepPresets[k].budget * 100.0);
+            continue;
+        }
+        const SweepPoint& p = points[i];
+        fprintf(stdout, "%-7s trace %3.0f ao %2d pcf %d shadow %3.0f  cost %5.1f%% of default  %6.2f dB (default %6.2f)  ssim %.4f\n",
+            sweepPresets[k].name, p.settings.traceStepsGrazing, p.settings.aoSamples, p.settings.pcfRings,
+            p.settings.shadowStepsGrazing, 100.0 * Sweep_Cost(p, byFetches) / Sweep_Cost(points[0], byFetches),
+            p.psnr, points[0].psnr, p.ssim);
+    }
+    return Sweep_WriteJson(sweepFile, sweepOnGL ? "gl" : "cpu", (const char*)glGetString(GL_RENDERER),
+                           qualitySize, qualityViews, points, byFetches) ? 0 : 1;
+}
+
+// Write a torus of about meshBenchTriangles triangles as OBJ and time loading it: parse,
+// weld and tangents, the tangents once on the calling thread and once on all threads
+static int runMeshBench() {
+    const char* path = "mesh_bench.obj";
+    auto t0 = std::chrono::steady_clock::now();
+    if (!Mesh_WriteTorusObj(path, meshBenchTriangles)) return 1;
+    fprintf(stdout, "Wrote %s in %.0f ms; %u hardware threads\n", path, Mesh_Ms(t0), std::thread::hardware_concurrency());
+    const int chunkCounts[2] = { 1, 64 };
+    for (int chunks : chunkCounts) {
+        Mesh mesh;
+        MeshLoadStats st;
+        t0 = std::chrono::steady_clock::now();
+        if (!Mesh_LoadObj(path, mesh, &st, chunks)) return 1;
+        double totalMs = Mesh_Ms(t0);
+        float worst = 0.0f;     // |dot(N, T)|: the frame must be orthogonal
+        for (size_t v = 0; v < mesh.vertices.size(); v += MESH_STRIDE) {
+            const float* n = &mesh.vertices[v + 5];
+            float d = fabsf(n[0] * mesh.vertices[v + 8] + n[1] * mesh.vertices[v + 9] + n[2] * mesh.vertices[v + 10]);
+            worst = d > worst ? d : worst;
+        }
+        fprintf(stdout, "%-10s %zu triangles, %zu positions, %zu welded, %zu vertices: parse %.1f ms, weld %.1f ms, "
+                        "tangents %.1f ms, total %.1f ms (max |N.T| %.1e)\n",
+            chunks == 1 ? "1 thread" : "parallel", st.triangles, st.positions, st.welded, st.vertices,
+            st.parseMs, st.weldMs, st.tangentMs, totalMs, worst);
+    }
+
+    // The same torus through the binary cache: map, read every byte as the upload
+    // would, and decode floats as a CPU reference render would
+    const char* cachePath = "mesh_bench.smesh";
+    Mesh mesh;
+    MeshCacheStats cs;
+    if (!Mesh_LoadObj(path, mesh)) return 1;
+    Mesh_Fit(mesh, MESH_RADIUS);
+    t0 = std::chrono::steady_clock::now();
+    if (!MeshCache_Write(cachePath, mesh, meshOrder, &cs)) return 1;
+    fprintf(stdout, "Wrote %s in %.0f ms (optimize %.0f ms, ACMR %.3f -> %.3f): %zu KB vs %zu KB as floats\n",
+        cachePath, Mesh_Ms(t0), cs.optimizeMs, cs.acmrBefore, cs.acmrAfter, cs.bytes / 1024,
+        (mesh.vertices.size() * sizeof(float) + mesh.indices.size() * sizeof(unsigned)) / 1024);
+    std::vector<double> mapMs, readMs, decodeMs;
+    std::vector<unsigned char> upload;
+    for (int run = 0; run < 5; ++run) {
+        MeshCache cache;
+        t0 = std::chrono::steady_clock::now();
+        if (!MeshCache_Open(cachePath, cache)) return 1;
+        mapMs.push_back(Mesh_Ms(t0));
+        t0 = std::chrono::steady_clock::now();
+        upload.assign(cache.data + cache.header->vertexOffset, cache.data + cache.size);
+        readMs.push_back(Mesh_Ms(t0));
+        Mesh decoded;
+        t0 = std::chrono::steady_clock::now();
+        MeshCache_Decode(cache, decoded);
+        decodeMs.push_back(Mesh_Ms(t0));
+        MeshCache_Close(cache);
+    }
+    fprintf(stdout, "%-10s map+validate %.2f ms, read for upload %.2f ms, decode for CPU %.2f ms (median of 5, warm page cache)\n",
+        "cache", summarize(mapMs).p50, summarize(readMs).p50, summarize(decodeMs).p50);
+    return 0;
+}
+
+// Every index order of the scene mesh, drawn from MESH_ORDER_VIEWS directions around it:
+// ACMR from the order itself; fragment invocations, samples passed (per pixel, samples
+// that passed the depth test: overdraw even where the driver counts fragments before
+// early-z) and time measured on the GL. Back faces are culled, as the overdraw order
+// assumes: with both sides drawn, an order and its reverse only trade places between
+// opposite views.
+static int runMeshOrderReport() {
+    if (sceneCache.header) MeshCache_Decode(sceneCache, sceneMesh);
+    const Mesh source = sceneMesh;
+    const char* name = meshFile ? meshFile : "quad";
+    int framesPerView = headlessFrames / MESH_ORDER_VIEWS > 0 ? headlessFrames / MESH_ORDER_VIEWS : 1;
+    std::vector<MeshOrderResult> results;
+    fprintf(stdout, "%-9s %7s %8s %6s %7s  %-21s %-21s %9s\n", "order", "ACMR", "FIFO 32", "ATVR", "opt ms",
+        "parallax frags  samp", "steep frags  samp", "frame ms");
+    glEnable(GL_CULL_FACE);
+    for (int o = 0; o < MESH_ORDER_COUNT; ++o) {
+        MeshOrderResult r;
+        r.order = (MeshOrder)o;
+        sceneMesh = source;
+        auto t0 = std::chrono::steady_clock::now();
+        Mesh_Order(sceneMesh, r.order);
+        r.optimizeMs = Mesh_Ms(t0);
+        size_t vertexCount = sceneMesh.vertices.size() / MESH_STRIDE;
+        r.acmr[0] = Mesh_ACMR(sceneMesh.indices, vertexCount);
+        r.acmr[1] = Mesh_ACMR(sceneMesh.indices, vertexCount, 32);
+        r.atvr = vertexCount ? r.acmr[0] * (double)(sceneMesh.indices.size() / 3) / (double)vertexCount : 0.0;
+        uploadSceneMesh(name);
+
+        camera_rotate_angle = 0.0f;
+        camera_elevate_angle = 30.0f;
+        renderTimedFrame();
+        std::vector<double> frameMs;
+        std::vector<double> gpuMs[PASS_COUNT];
+        GpuTimer_BeginCapture();
+        PipeStats_Flush();
+        PipeStats_Reset();
+        for (int v = 0; v < MESH_ORDER_VIEWS; ++v) {
+            camera_rotate_angle = 360.0f * (float)(v / 2) / (float)(MESH_ORDER_VIEWS / 2);
+            camera_elevate_angle = v % 2 ? -30.0f : 30.0f;
+            for (int f = 0; f < framesPerView; ++f) frameMs.push_back(renderTimedFrame());
+        }
+        GpuTimer_EndCapture(gpuMs);
+        PipeStats_Flush();
+        r.frameMs = summarize(frameMs);
+        r.parallaxMs = summarize(gpuMs[PASS_PARALLAX]);
+        r.steepMs = summarize(gpuMs[PASS_STEEP]);
+        r.counters = PipeStats_Json(PASS_PARALLAX, "parallax");
+        std::string steep = PipeStats_Json(PASS_STEEP, "steep");
+        if (!r.counters.empty() && !steep.empty()) r.counters += ",";
+        r.counters += steep;
+        results.push_back(r);
+        fprintf(stdout, "%-9s %7.3f %8.3f %6.3f %7.1f  %14.3f %6.3f %11.3f %6.3f %12.3f\n", meshOrderNames[o], r.acmr[0],
+            r.acmr[1], r.atvr, r.optimizeMs, PipeStats_PerPixel(PASS_PARALLAX, PIPE_FRAGMENT_INVOCATIONS),
+            PipeStats_PerPixel(PASS_PARALLAX, PIPE_SAMPLES_PASSED), PipeStats_PerPixel(PASS_STEEP, PIPE_FRAGMENT_INVOCATIONS),
+            PipeStats_PerPixel(PASS_STEEP, PIPE_SAMPLES_PASSED), r.frameMs.p50);
+    }
+    glDisable(GL_CULL_FACE);
+    return Mesh_WriteOrderJson(meshOrderReportFile, name, (const char*)glGetString(GL_RENDERER), MESH_ORDER_VIEWS,
+                               framesPerView, source.indices.size() / 3, source.vertices.size() / MESH_STRIDE, results) ? 0 : 1;
+}
+
+// Convert the --mesh OBJ into a mesh cache: fitted, cache-optimized, quantized
+static int runMeshConvert() {
+    if (!meshFile) {
+        fprintf(stderr, "ERROR: --mesh-convert needs --mesh FILE\n");
+        return 1;
+    }
+    Mesh mesh;
+    MeshLoadStats st;
+    MeshCacheStats cs;
+    auto t0 = std::chrono::steady_clock::now();
+    if (!Mesh_LoadObj(meshFile, mesh, &st)) return 1;
+    double loadMs = Mesh_Ms(t0);
+    Mesh_Fit(mesh, MESH_RADIUS);
+    if (!MeshCache_Write(meshConvertFile, mesh, meshOrder, &cs)) return 1;
+    fprintf(stdout, "%s -> %s: %zu triangles, %zu vertices, %zu KB; %s order, ACMR %.3f -> %.3f (FIFO %d); "
+                    "OBJ load %.0f ms, optimize %.0f ms\n",
+        meshFile, meshConvertFile, st.triangles, st.vertices, cs.bytes / 1024, meshOrderNames[meshOrder],
+        cs.acmrBefore, cs.acmrAfter, MESH_ACMR_FIFO, loadMs, cs.optimizeMs);
+    return 0;
+}
+
+// --terrain-gen: write the --terrain world file
+static int runTerrainGenerate() {
+    if (!terrainFile) {
+        fprintf(stderr, "ERROR: --terrain-gen needs --terrain FILE\n");
+        return 1;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    if (!Terrain_Generate(terrainFile, terrainGenerateSize)) return 1;
+    fprintf(stdout, "Wrote %s: %dx%d texels in %dx%d level 0 pages, %.1f s\n", terrainFile, terrainGenerateSize, terrainGenerateSize,
+        terrainGenerateSize / TERRAIN_TILE, terrainGenerateSize / TERRAIN_TILE, Mesh_Ms(t0) / 1000.0);
+    return 0;
+}
+
+// Compare two PPM files with every metric; no GL context needed
+static int runImageDiff() {
+    std::vector<unsigned char> a, b;
+    int wa = 0, ha = 0, wb = 0, hb = 0;
+    if (!Image_ReadPPM(imageDiffA, a, wa, ha) || !Image_ReadPPM(imageDiffB, b, wb, hb)) return 1;
+    if (wa != wb || ha != hb) {
+        fprintf(stderr, "ERROR: image sizes differ (%dx%d vs %dx%d)\n", wa, ha, wb, hb);
+        return 1;
+    }
+    std::vector<float> errorMap;
+    auto t0 = std::chrono::steady_clock::now();
+    double psnr = Image_PSNR(a.data(), b.data(), (size_t)wa * ha);
+    auto t1 = std::chrono::steady_clock::now();
+    double ssim = Image_SSIM(a.data(), b.data(), wa, ha);
+    auto t2 = std::chrono::steady_clock::now();
+    double flip = Image_PerceptualDiff(a.data(), b.data(), wa, ha, errorMap);
+    auto t3 = std::chrono::steady_clock::now();
+    typedef std::chrono::duration<double, std::milli> ms;
+    fprintf(stdout, "%dx%d  PSNR %.3f dB (%.1f ms)  SSIM %.5f (%.1f ms)  FLIP %.5f (%.1f ms)\n", wa, ha,
+        psnr, ms(t1 - t0).count(), ssim, ms(t2 - t1).count(), flip, ms(t3 - t2).count());
+    if (diffMapPrefix) {
+        std::string path = std::string(diffMapPrefix) + ".ppm";
+        if (!Image_WriteHeatmap(path.c_str(), errorMap, wa, ha, false)) return 1;
+    }
+    return 0;
+}
+
+// Render every golden case through renderScene and check both viewports against the CPU
+// reference at the same settings; returns 2 if any viewport is over the error budget
+static int runGolden() {
+    int halfW = screenWidth / 2;
+    int squareW = (screenHeight < halfW ? screenHeight : halfW);
+    const int viewX[TECH_COUNT] = { halfW - squareW, halfW };   // renderScene's layout
+    const char* names[TECH_COUNT];
+    for (int t = 0; t < TECH_COUNT; ++t) names[t] = techniques[t].name;
+    bool marker = showLightMarker;
+    showLightMarker = false;
+
+    // GL: the frames come back through the capture ring
+    std::vector<std::vector<unsigned char>> frames(goldenCaseCount);
+    std::vector<GoldenResult> results(goldenCaseCount);
+    if (!Capture_Init(screenWidth, screenHeight, CAPTURE_NONE, "golden",
+            [&](int frame, const unsigned char* rgb, int w, int h) { frames[frame].assign(rgb, rgb + (size_t)w * h * 3); }))
+        return 1;
+    for (int i = 0; i < goldenCaseCount; ++i) {
+        const GoldenCase& c = goldenCases[i];
+        BenchToggles toggles = Bench_Toggles(c.toggles);
+        bumpy = toggles.bumpy;
+        selfShadowing = toggles.selfShadowing;
+        multisampling = toggles.multisampling;
+        parallaxEnabled = toggles.parallaxEnabled;
+        BenchView view;
+        benchPaths[c.path].eval(c.t, view);
+        applyBenchView(view);
+
+        results[i].c = &c;
+        results[i].glMs = 1e30;
+        for (int k = 0; k < 3; ++k) {
+            double ms = renderTimedFrame();
+            if (ms < results[i].glMs) results[i].glMs = ms;
+        }
+        Headless_BindForRead();
+        Capture_Frame(i);
+        glBindFramebuffer(GL_FRAMEBUFFER, headlessTarget.fbo);
+    }
+    Capture_Shutdown();
+
+    // CPU reference of each viewport with the same matrices, then the budget
+    int failed = 0;
+    std::vector<unsigned char> view((size_t)squareW * squareW * 3);
+    std::vector<float> errorMap;
+    fprintf(stdout, "%-24s %-9s %9s %8s %8s %10s %10s\n", "case", "viewport", "PSNR dB", "SSIM", "FLIP", "GL ms", "CPU ms");
+    for (int i = 0; i < goldenCaseCount; ++i) {
+        GoldenResult& r = results[i];
+        BenchToggles toggles = Bench_Toggles(r.c->toggles);
+        bumpy = toggles.bumpy;
+        selfShadowing = toggles.selfShadowing;
+        parallaxEnabled = toggles.parallaxEnabled;
+        BenchView bv;
+        benchPaths[r.c->path].eval(r.c->t, bv);
+        applyBenchView(bv);
+
+        r.pass = true;
+        for (int t = 0; t < TECH_COUNT; ++t) {
+            float MV0[16], MVP[16], invMV[16], lightEye[3];
+            setupCamera(MV0, lightEye);
+            buildQuadMatrices(MV0, MVP, invMV);
+            CpuFrame ref;
+            auto t0 = std::chrono::steady_clock::now();
+            renderReference(currentCpuShading((ShadingTechnique)t), MVP, invMV, lightEye, squareW, ref);
+            double cpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+            r.cpuMs += cpuMs;
+
+            for (int y = 0; y < squareW; ++y)
+                memcpy(&view[(size_t)y * squareW * 3], &frames[i][((size_t)y * screenWidth + viewX[t]) * 3], (size_t)squareW * 3);
+            GoldenScore& s = r.score[t];
+            s.psnr = Image_PSNR(view.data(), ref.rgb.data(), ref.coverage.size(), ref.coverage.data());
+            s.ssim = Image_SSIM(view.data(), ref.rgb.data(), squareW, squareW, ref.coverage.data());
+            s.flip = Image_PerceptualDiff(view.data(), ref.rgb.data(), squareW, squareW, errorMap, ref.coverage.data());
+            if (!Golden_Check(s, goldenBudget)) r.pass = false;
+            if (diffMapPrefix) {
+                char path[512];
+                snprintf(path, sizeof(path), "%s_%s_%s.ppm", diffMapPrefix, r.c->name, names[t]);
+                Image_WriteHeatmap(path, errorMap, squareW, squareW, true);
+            }
+            char glMs[32] = "";
+            if (t == 0) snprintf(glMs, sizeof(glMs), "%.3f", r.glMs);
+            fprintf(stdout, "%-24s %-9s %9.2f %8.4f %8.4f %10s %10.1f%s\n", t ? "" : r.c->name, names[t],
+                s.psnr, s.ssim, s.flip, glMs, cpuMs, s.pass ? "" : "  FAIL");
+        }
+        failed += r.pass ? 0 : 1;
+    }
+    showLightMarker = marker;
+    fprintf(stdout, "%d of %d cases within the budget (PSNR >= %.1f dB, FLIP <= %.3f)\n",
+        goldenCaseCount - failed, goldenCaseCount, goldenBudget.minPsnr, goldenBudget.maxFlip);
+
+    if (!Golden_WriteJson(goldenFile, (const char*)glGetString(GL_RENDERER), screenWidth, screenHeight,
+                          qualityPresets[tuner.preset].name, goldenBudget, names, results)) return 1;
+    return failed ? 2 : 0;
+}
+
+// Offscreen entry: set up the context and target, then render frames or run the benchmark
+static int runHeadless(int* argc, char* argv[]) {
+    {
+        STARTUP_PHASE("context");
+        if (!Headless_CreateContext(argc, argv, glDebugContext)) return 1;
+    }
+#ifdef _WIN32
+    {
+        STARTUP_PHASE("glewInit");
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK) {
+            fprintf(stderr, "ERROR: glewInit failed\n");
+            return 1;
+        }
+    }
+#endif
+    GLDebug_Init(glDebugContext);
+    {
+        STARTUP_PHASE("render target");
+        if (!Headless_CreateTarget(screenWidth, screenHeight, headlessSamples)) return 1;
+    }
+
+    initScene();
+    Handle_Reshape(screenWidth, screenHeight);
+    if (goldenFile || sweepFile || compareFile || benchmarkFile || fetchReportFile || meshOrderReportFile) finishFastStart();
+    if (inputReplay.active) applyInputState(inputReplay.header);
+
+    int rc = goldenFile ? runGolden() : sweepFile ? runSweep() : fetchReportFile ? runFetchReport()
+           : meshOrderReportFile ? runMeshOrderReport() : compareFile ? runCompare() : benchmarkFile ? runBenchmark()
+           : renderFrames();
+
+    if (profileEnabled && traceFile) Profiler_WriteTrace(traceFile);
+    joinFastStart();
+    Metrics_Stop();
+    Terrain_Close(terrain);
+    PipeStats_Shutdown();
+    GpuTimer_Shutdown();
+    Hud_Shutdown();
+    Headless_Destroy();
+    GLDebug_Shutdown();
+    return rc;
+}
+
+// Parse command-line options; returns false if the program should exit
+static bool parseArgs(int argc, char* argv[]) {
+    for (int i = 1; i < argc; ++i) {
+        const char* a = argv[i];
+        bool hasValue = (i + 1 < argc);
+        if (!strcmp(a, "--headless")) {
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--frames") && hasValue) {
+            headlessFrames = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--size") && hasValue) {
+            int w = 0, h = 0;
+            if (sscanf(argv[++i], "%dx%d", &w, &h) == 2 && w > 0 && h > 0) {
+                screenWidth = w;
+                screenHeight = h;
+            }
+        }
+        else if (!strcmp(a, "--dump-every") && hasValue) {
+            headlessDumpEvery = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--image-prefix") && hasValue) {
+            headlessImagePrefix = argv[++i];
+        }
+        else if (!strcmp(a, "--capture-format") && hasValue) {
+            if (!Capture_ParseFormat(argv[++i], &captureFormat))
+                fprintf(stderr, "WARNING: unknown capture format '%s'\n", argv[i]);
+        }
+        else if (!strcmp(a, "--timings") && hasValue) {
+            headlessTimingsFile = argv[++i];
+        }
+        else if (!strcmp(a, "--gpu-csv") && hasValue) {
+            gpuTimingsFile = argv[++i];
+        }
+        else if (!strcmp(a, "--trace") && hasValue) {
+            traceFile = argv[++i];
+        }
+        else if (!strcmp(a, "--no-profile")) {
+            profileEnabled = false;
+        }
+        else if (!strcmp(a, "--hud")) {
+            hudAtStart = true;
+        }
+        else if (!strcmp(a, "--metrics-file") && hasValue) {
+            metricsFile = argv[++i];
+        }
+        else if (!strcmp(a, "--metrics-socket") && hasValue) {
+            metricsSocket = argv[++i];
+        }
+        else if (!strcmp(a, "--metrics-interval") && hasValue) {
+            metricsIntervalS = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--gl-debug")) {
+            glDebugContext = true;
+        }
+        else if (!strcmp(a, "--samples") && hasValue) {
+            headlessSamples = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--benchmark") && hasValue) {
+            benchmarkFile = argv[++i];
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--warmup") && hasValue) {
+            benchWarmupFrames = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--kernel-runs") && hasValue) {
+            kernelRuns = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--compare") && hasValue) {
+            compareFile = argv[++i];
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--trials") && hasValue) {
+            compareTrials = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--seed") && hasValue) {
+            compareSeed = (unsigned)strtoul(argv[++i], nullptr, 10);
+        }
+        else if (!strcmp(a, "--quality-views") && hasValue) {
+            qualityViews = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--quality-size") && hasValue) {
+            qualitySize = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--preset") && hasValue) {
+            int preset = Preset_Find(argv[++i]);
+            if (preset >= 0) tuner.preset = preset;
+            else fprintf(stderr, "WARNING: unknown preset '%s'\n", argv[i]);
+        }
+        else if (!strcmp(a, "--auto-tune") && hasValue) {
+            tuner.enabled = true;
+            tuner.targetMs = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--diff-maps") && hasValue) {
+            diffMapPrefix = argv[++i];
+        }
+        else if (!strcmp(a, "--image-diff") && i + 2 < argc) {
+            imageDiffA = argv[++i];
+            imageDiffB = argv[++i];
+        }
+        else if (!strcmp(a, "--startup-report")) {
+            startupReport = true;
+        }
+        else if (!strcmp(a, "--fast-start")) {
+            fastStart = true;
+        }
+        else if (!strcmp(a, "--gpu-budget") && hasValue) {
+            gpuBudgetMB = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--record") && hasValue) {
+            recordFile = argv[++i];
+        }
+        else if (!strcmp(a, "--replay") && hasValue) {
+            replayFile = argv[++i];
+        }
+        else if (!strcmp(a, "--golden") && hasValue) {
+            goldenFile = argv[++i];
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--golden-psnr") && hasValue) {
+            goldenBudget.minPsnr = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--golden-flip") && hasValue) {
+            goldenBudget.maxFlip = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--mesh") && hasValue) {
+            meshFile = argv[++i];
+        }
+        else if (!strcmp(a, "--mesh-convert") && hasValue) {
+            meshConvertFile = argv[++i];
+        }
+        else if (!strcmp(a, "--mesh-order") && hasValue) {
+            if (!Mesh_ParseOrder(argv[++i], meshOrder)) return false;
+        }
+        else if (!strcmp(a, "--order-report") && hasValue) {
+            meshOrderReportFile = argv[++i];
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--terrain") && hasValue) {
+            terrainFile = argv[++i];
+        }
+        else if (!strcmp(a, "--terrain-gen") && hasValue) {
+            terrainGenerateSize = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--terrain-budget") && hasValue) {
+            terrainBudgetKB = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--terrain-slots") && hasValue) {
+            terrainSlots = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--mesh-bench") && hasValue) {
+            meshBenchTriangles = (size_t)atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--fetch-report") && hasValue) {
+            fetchReportFile = argv[++i];
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--sweep") && hasValue) {
+            sweepFile = argv[++i];
+            headlessMode = true;
+        }
+        else if (!strcmp(a, "--sweep-gl")) {
+            sweepOnGL = true;
+        }
+        else if (!strcmp(a, "--sweep-repeats") && hasValue) {
+            sweepRepeats = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--sweep-axis") && hasValue) {
+            if (!Sweep_SetAxis(argv[++i])) fprintf(stderr, "WARNING: bad --sweep-axis '%s'\n", argv[i]);
+        }
+        else if (!strcmp(a, "--history") && hasValue) {
+            historyFile = argv[++i];
+        }
+        else if (!strcmp(a, "--no-history")) {
+            historyFile = nullptr;
+        }
+        else if (!strcmp(a, "--commit") && hasValue) {
+            historyCommit = argv[++i];
+        }
+        else if (!strcmp(a, "--perf-diff") && hasValue) {
+            perfDiffFile = argv[++i];
+        }
+        else if (!strcmp(a, "--run") && hasValue) {
+            perfDiffRun = argv[++i];
+        }
+        else if (!strcmp(a, "--against") && hasValue) {
+            perfDiffAgainst = argv[++i];
+        }
+        else if (!strcmp(a, "--baseline-runs") && hasValue) {
+            perfDiffBaselineRuns = atoi(argv[++i]);
+        }
+        else if (!strcmp(a, "--alpha") && hasValue) {
+            perfDiffAlpha = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--min-change") && hasValue) {
+            perfDiffMinChange = atof(argv[++i]);
+        }
+        else if (!strcmp(a, "--help") || !strcmp(a, "-h")) {
+            fprintf(stdout,
+                "Usage: %s [options]\n"
+                "  --headless           render offscreen (EGL / hidden window) instead of a GLUT window\n"
+                "  --frames N           number of frames to render in headless mode (default 100)\n"
+                "  --size WxH           framebuffer size (default 1400x700)\n"
+                "  --dump-every K       write every K-th frame (default: last frame only)\n"
+                "  --image-prefix P     image file prefix (default 'frame')\n"
+                "  --capture-format F   ppm, png, raw (one RGB24 stream) or none (default ppm)\n"
+                "  --timings FILE       write per-frame times as CSV\n"
+                "  --gpu-csv FILE       write per-pass GPU times and rolling stats as CSV\n"
+                "  --trace FILE         Chrome trace output (default trace.json; 'T' writes it in windowed mode)\n"
+                "  --no-profile         do not record CPU profiler scopes\n"
+                "  --hud                start with the performance overlay shown ('H' toggles it)\n"
+                "  --metrics-file FILE  rewrite FILE with Prometheus metrics (frame/GPU times, memory, drops)\n"
+                "  --metrics-socket P   serve the metrics over HTTP on the Unix socket P (not on Windows)\n"
+                "  --metrics-interval S seconds between --metrics-file rewrites (default 10)\n"
+                "  --gl-debug           debug GL context: synchronous KHR_debug output, notifications included\n"
+                "  --samples N          MSAA samples of the headless target (default 4, 0 = off)\n"
+                "  --benchmark FILE     run the scripted benchmark (paths x toggles) headless, write JSON\n"
+                "  --warmup N           benchmark warm-up frames per configuration (default 10)\n"
+                "  --kernel-runs N      runs of each CPU kernel under hardware counters after --benchmark (default 5, 0 = skip)\n"
+                "  --compare FILE       A/B compare all techniques headless (cost ratio, PSNR/SSIM/FLIP), write JSON\n"
+                "  --trials N           randomized interleaved trials for --compare (default 40)\n"
+                "  --seed S             random seed for --compare (default 12345)\n"
+                "  --quality-views N    views scored against the CPU reference (default 4)\n"
+                "  --quality-size N     size of the quality renders (default 256)\n"
+                "  --diff-maps PREFIX   write FLIP-style error heat maps (--compare, --golden, --image-diff) as PPM\n"
+                "  --image-diff A B     compare two PPM images (PSNR, SSIM, FLIP) without a GL context\n"
+                "  --preset NAME        steep-parallax quality: low, medium, high (default) or ultra\n"
+                "  --auto-tune MS       pick the highest preset whose GPU time stays under MS per frame\n"
+                "  --startup-report     print the time of every startup phase after the first frame\n"
+                "  --fast-start         show plain normal mapping at once, stream textures and shaders in\n"
+                "  --gpu-budget MB      cap the tracked GPU memory; textures lose top levels to fit\n"
+                "  --record FILE        log the window's input (keys, mouse, tuner switches) to FILE\n"
+                "  --replay FILE        play an input log back frame-exact, in the window or with --headless\n"
+                "  --golden FILE        check fixed views against the CPU reference, write JSON; exit code 2 on failure\n"
+                "  --golden-psnr DB     smallest PSNR a golden viewport may have (default 30)\n"
+                "  --golden-flip F      largest mean FLIP error of a golden viewport (default 0.05)\n"
+                "  --mesh FILE          draw an OBJ mesh (needs texture coordinates) or a mesh cache instead of the quad\n"
+                "  --mesh-convert OUT   write the --mesh OBJ as a binary mesh cache (cache-optimized, quantized)\n"
+                "  --mesh-order O       index order --mesh-convert writes: none, forsyth, tipsify, overdraw (default)\n"
+                "  --order-report FILE  ACMR, fragment invocations and GPU time of every index order, write JSON\n"
+                "  --terrain FILE       steep pass over a world streamed as a virtual texture from FILE\n"
+                "  --terrain-gen N      write an N x N texel world (power of two, 4096 to 524288) to --terrain FILE\n"
+                "  --terrain-budget KB  terrain pages queued per frame, in KB (default 2048)\n"
+                "  --terrain-slots N    terrain atlas slots in use, 32 to 256 (default 256; fewer forces evictions)\n"
+                "  --mesh-bench N       write a torus of about N triangles as OBJ and time loading it, its tangents and its cache\n"
+                "  --fetch-report FILE  CPU reference texture fetches per stage and map on the quality views, write JSON\n"
+                "  --sweep FILE         sweep the steep-parallax quality knobs, write the Pareto frontier as JSON\n"
+                "  --sweep-gl           sweep on GL (cost = time) instead of the CPU reference (cost = fetches)\n"
+                "  --sweep-repeats N    timed renders per view and point with --sweep-gl (default 5)\n"
+                "  --sweep-axis A=V,..  values of one axis: trace_steps, ao_samples, ao_radius, pcf_rings, shadow_steps\n"
+                "  --history FILE       performance history the benchmark appends to (default perf_history.jsonl)\n"
+                "  --no-history         do not append the benchmark run to the history\n"
+                "  --commit SHA         commit recorded in the history (default $GIT_COMMIT or git rev-parse)\n"
+                "  --perf-diff FILE     compare a run of the history with its baseline; exit code 2 on regression\n"
+                "  --run ID             run to check with --perf-diff (default: latest)\n"
+                "  --against ID         baseline run (default: pool of the previous runs on this machine)\n"
+                "  --baseline-runs N    runs in the rolling baseline (default 5)\n"
+                "  --alpha A            significance level of the Welch t-test (default 0.01)\n"
+                "  --min-change PCT     smallest change reported, in percent (default 2)\n",
+                argv[0]);
+            return false;
+        }
+        else {
+            fprintf(stderr, "WARNING: ignoring unknown option '%s'\n", a);
+        }
+    }
+    if (compareFile && compareTrials < 1) {
+        fprintf(stderr, "ERROR: --trials must be at least 1\n");
+        exit(1);
+    }
+    if (qualitySize < 1 || (compareFile && qualitySize > std::min(screenWidth, screenHeight))) {
+        fprintf(stderr, "ERROR: --quality-size must be from 1 to the smaller side of --size (%d)\n",
+            std::min(screenWidth, screenHeight));
+        exit(1);
+    }
+    return true;
+}
+
+// Entry point
+int main(int argc, char* argv[]) {
+    Startup_Begin();
+
+    // Print working directory
+#ifdef _WIN32
+    char cwd[MAX_PATH];
+    if (GetCurrentDirectoryA(MAX_PATH, cwd))
+        fprintf(stdout, "Working directory: %s\n", cwd);
+#else
+    char cwd[PATH_MAX];
+    if (getcwd(cwd, sizeof(cwd)))
+        fprintf(stdout, "Working directory: %s\n", cwd);
+#endif
+
+    if (!parseArgs(argc, argv)) return 0;
+    if (imageDiffA) return runImageDiff();
+    if (meshBenchTriangles) return runMeshBench();
+    if (meshConvertFile) return runMeshConvert();
+    if (terrainGenerateSize) return runTerrainGenerate();
+    if (terrainBudgetKB * 1024 < TERRAIN_PAGE_BYTES) {
+        fprintf(stderr, "ERROR: --terrain-budget must be at least one page (%d KB)\n", (TERRAIN_PAGE_BYTES + 1023) / 1024);
+        return 1;
+    }
+    if (terrainSlots < TERRAIN_MIN_SLOTS || terrainSlots > TERRAIN_ATLAS_SLOTS * TERRAIN_ATLAS_SLOTS) {
+        fprintf(stderr, "ERROR: --terrain-slots must be from %d to %d\n", TERRAIN_MIN_SLOTS, TERRAIN_ATLAS_SLOTS * TERRAIN_ATLAS_SLOTS);
+        return 1;
+    }
+    if (terrainFile && (goldenFile || sweepFile || compareFile || fetchReportFile)) {
+        fprintf(stderr, "ERROR: --terrain has no CPU reference; it does not combine with --golden, --sweep, --compare or --fetch-report\n");
+        return 1;
+    }
+    if (perfDiffFile) {
+        int regressions = History_Diff(perfDiffFile, perfDiffRun, perfDiffAgainst,
+                                       perfDiffBaselineRuns, perfDiffAlpha, perfDiffMinChange);
+        return regressions < 0 ? 1 : regressions > 0 ? 2 : 0;
+    }
+    if (replayFile) {
+        if (!Input_Load(inputReplay, replayFile)) return 1;
+        screenWidth = inputReplay.header.width;
+        screenHeight = inputReplay.header.height;
+        headlessFrames = (int)inputReplay.frames;
+        fprintf(stdout, "Replaying %zu input events over %u frames from %s\n",
+            inputReplay.events.size(), inputReplay.frames, replayFile);
+    }
+    if (headlessMode) return runHeadless(&argc, argv);
+
+    // Init GLUT + window
+    {
+        STARTUP_PHASE("glutInit + window");
+        glutInit(&argc, argv);
+        glutInitDisplayMode(GLUT_DOUBLE | GLUT_RGBA | GLUT_DEPTH | GLUT_MULTISAMPLE);
+        if (glDebugContext) glutInitContextFlags(GLUT_DEBUG);
+        glutInitWindowSize(screenWidth, screenHeight);
+        glutCreateWindow("Parallax Mapping GLSL");
+    }
+
+#ifdef _WIN32
+    // Init GLEW
+    {
+        STARTUP_PHASE("glewInit");
+        glewExperimental = GL_TRUE;
+        if (glewInit() != GLEW_OK) {
+            fprintf(stderr, "ERROR: glewInit failed\n");
+            return 1;
+        }
+    }
+#endif
+    GLDebug_Init(glDebugContext);
+
+    initScene();
+    if (inputReplay.active) applyInputState(inputReplay.header);
+    if (recordFile && !inputReplay.active) Input_BeginRecord(inputRecorder, recordFile, currentInputState());
+
+    glutMouseFunc(Handle_Mouse);
+    glutMotionFunc(Handle_Motion);
+    glutKeyboardFunc(Handle_Keyboard);
+    glutReshapeFunc(Handle_Reshape);
+    glutDisplayFunc(Handle_Display);
+    glutIdleFunc(Handle_Display);
+
+    glutMainLoop();
+    return 0;
 }
\ No newline at end of file
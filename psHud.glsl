@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec2 FragUV;
+in vec4 FragColor;
+
+out vec4 fragColor;
+
+uniform sampler2D fontTexture;  // glyph coverage in red; cell 0 is solid for rectangles
+
+void main()
+{
+    fragColor = vec4(FragColor.rgb, FragColor.a * texture(fontTexture, FragUV).r);
+}
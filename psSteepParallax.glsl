@@ -53,11 +53,93 @@ const float baseSpecularCoeff = 0.6;
 const float aoMin     = 0.08;
 const float shadowMin = 0.1;
 
-// SSAO sampling parameters:
+// Quality/cost knobs. Each one can be overridden with a #define injected
+// right after the #version line (the --sweep tool does this):
 //  • AO_SAMPLES: number of directions to sample around the fragment.
 //  • AO_RADIUS: maximum UV offset in each direction for occlusion sampling.
-const int   AO_SAMPLES = 8;
-const float AO_RADIUS  = 0.012;
+//  • TRACE_STEPS_GRAZING / _FACING: parallax march steps edge‐on / face‐on.
+//  • PCF_RINGS: the shadow kernel is (2*PCF_RINGS+1)² rays.
+//  • SHADOW_STEPS_GRAZING / _FACING: shadow march steps for low / high light.
+#ifndef AO_SAMPLES
+#define AO_SAMPLES 8
+#endif
+#ifndef AO_RADIUS
+#define AO_RADIUS 0.012
+#endif
+#ifndef TRACE_STEPS_GRAZING
+#define TRACE_STEPS_GRAZING 72.0
+#endif
+#ifndef TRACE_STEPS_FACING
+#define TRACE_STEPS_FACING 36.0
+#endif
+#ifndef PCF_RINGS
+#define PCF_RINGS 3
+#endif
+#ifndef SHADOW_STEPS_GRAZING
+#define SHADOW_STEPS_GRAZING 48.0
+#endif
+#ifndef SHADOW_STEPS_FACING
+#define SHADOW_STEPS_FACING 12.0
+#endif
+
+// -----------------------------------------------------------------------------
+// Height, albedo and normal-map lookups. The default build reads heightMap,
+// diffuseTexture and normalMap at the UV. The TERRAIN build (large-terrain
+// mode, TERRAIN.h) reads a sparse virtual texture instead: the quad's UV
+// covers terrainWindow.zw world texels from terrainWindow.xy, terrainPages has
+// a mip level per pyramid level and a texel per page (rg = atlas slot, b =
+// level actually resident, this one or an ancestor) and the three atlases hold
+// the resident pages with a TERRAIN_BORDER apron. The level is chosen once
+// per pixel from the UV derivatives, before the march, the way
+// psTerrainFeedback.glsl requests it.
+// -----------------------------------------------------------------------------
+#ifdef TERRAIN
+uniform sampler2D terrainDiffuse;
+uniform sampler2D terrainHeight;
+uniform sampler2D terrainNormal;
+uniform sampler2D terrainPages;
+uniform vec4 terrainWindow;
+uniform int terrainLevels;
+
+int terrainLevel = 0;
+
+int terrainLevelOf(vec2 uv) {
+    vec2 texel = uv * terrainWindow.zw;
+    float rho = max(length(dFdx(texel)), length(dFdy(texel)));
+    return clamp(int(floor(log2(max(rho, 1e-6)))), 0, terrainLevels - 1);
+}
+
+vec2 terrainAtlasUV(vec2 uv) {
+    vec2 texel = terrainWindow.xy + uv * terrainWindow.zw;
+    ivec2 tile = clamp(ivec2(floor(texel / TERRAIN_TILE)), ivec2(0), textureSize(terrainPages, 0) - 1);
+    vec4 page = texelFetch(terrainPages, tile >> terrainLevel, terrainLevel);
+    int level = min(int(page.b * 255.0 + 0.5), terrainLevels - 1);
+    vec2 slot = floor(page.rg * 255.0 + 0.5);
+    vec2 local = texel / exp2(float(level)) - vec2(tile >> level) * TERRAIN_TILE;
+    return (slot * TERRAIN_SLOT + TERRAIN_BORDER + local) / vec2(textureSize(terrainHeight, 0));
+}
+
+float sampleHeight(sampler2D heightMap, vec2 uv) { return texture(terrainHeight, terrainAtlasUV(uv)).r; }
+
+vec2 heightTexelSize(sampler2D heightMap) { return exp2(float(terrainLevel)) / terrainWindow.zw; }
+
+vec3 sampleAlbedo(vec2 uv) { return texture(terrainDiffuse, terrainAtlasUV(uv)).rgb; }
+
+vec3 sampleDetailNormal(vec2 uv, vec3 heightNormal) {
+    vec2 xy = texture(terrainNormal, terrainAtlasUV(uv)).rg * 2.0 - 1.0;
+    return vec3(xy, sqrt(max(1.0 - dot(xy, xy), 0.0)));
+}
+#else
+float sampleHeight(sampler2D heightMap, vec2 uv) { return texture(heightMap, uv).r; }
+
+vec2 heightTexelSize(sampler2D heightMap) { return 1.0 / vec2(textureSize(heightMap, 0)); }
+
+vec3 sampleAlbedo(vec2 uv) { return texture(diffuseTexture, uv).rgb; }
+
+vec3 sampleDetailNormal(vec2 uv, vec3 heightNormal) {
+    return normalize(texture(normalMap, uv).rgb * 2.0 - 1.0);
+}
+#endif
 
 // -----------------------------------------------------------------------------
 // Parallax Occlusion Mapping function with continuous intersection interpolation.
@@ -75,8 +157,8 @@ vec2 parallaxTrace(
     //    We use more steps when the surface is nearly edge‐on (small viewDir.z)
     //    because parallax error is more obvious there.
     //    mix(72,36, |viewDir.z| ) smoothly blends between 72 steps (edge‐on)
-    //    and 36 (face‐on).
-    float numSteps = mix(72.0, 36.0, abs(viewDir.z));
+    //    and 36 (face‐on) with the default knobs.
+    float numSteps = mix(TRACE_STEPS_GRAZING, TRACE_STEPS_FACING, abs(viewDir.z));
 
     // 2) steepScale allows us to exaggerate or dampen the relief.
     //    A value >1 makes hills taller; =1 is a 1:1 mapping.
@@ -99,7 +181,7 @@ vec2 parallaxTrace(
     // 5) Initialize current UV, heightRemaining, and fetch the first sample.
     vec2  curUV      = uv;
     float heightRem  = 1.0;
-    float curSample  = texture(heightMap, curUV).r;
+    float curSample  = sampleHeight(heightMap, curUV);
 
     // 6) Store the previous sample and UV so we can interpolate later.
     vec2  prevUV;
@@ -113,7 +195,7 @@ vec2 parallaxTrace(
         prevUV       = curUV;     // store previous position
         prevSample   = curSample; // store previous sample value
         curUV       += deltaUV;   // advance UV
-        curSample    = texture(heightMap, curUV).r;  // sample height
+        curSample    = sampleHeight(heightMap, curUV);  // sample height
     }
 
     // 8) At this point, curSample >= heightRem, so we’ve gone one step too far.
@@ -142,9 +224,9 @@ vec3 computeHeightNormalTS(
     float bumpScale      // how strongly slopes are scaled
 ) {
     // Sample center, right, and up heights
-    float hc = texture(heightMap, uv).r;
-    float hr = texture(heightMap, uv + vec2(texelSize.x, 0.0)).r;
-    float hu = texture(heightMap, uv + vec2(0.0, texelSize.y)).r;
+    float hc = sampleHeight(heightMap, uv);
+    float hr = sampleHeight(heightMap, uv + vec2(texelSize.x, 0.0));
+    float hu = sampleHeight(heightMap, uv + vec2(0.0, texelSize.y));
 
     // Compute partial derivatives ∂h/∂x and ∂h/∂y
     float dx = (hr - hc) * bumpScale;
@@ -167,6 +249,10 @@ void main() {
     vec3 lightColor  = vec3(1.0, 1.0, 0.65);
     vec3 ambientBase = vec3(0.4, 0.4, 0.6) * 1.4; // boost ambient slightly
 
+#ifdef TERRAIN
+    terrainLevel = terrainLevelOf(FragUV);
+#endif
+
     // 2) Normalize the incoming view vector in tangent space.
     vec3 tanEyeN = normalize(tanEyeVec);
 
@@ -177,18 +263,16 @@ void main() {
     );
 
     // 4) Sample the albedo at the displaced UV.
-    vec3 albedo = texture(diffuseTexture, finalUV).rgb;
+    vec3 albedo = sampleAlbedo(finalUV);
 
     // 5) Build two tangent‐space normals:
     //    a) nH from the height map derivative for macro shape.
     //    b) nM from the normal map for micro detail.
-    vec2 texelSize = 1.0 / vec2(textureSize(heightMap, 0));
+    vec2 texelSize = heightTexelSize(heightMap);
     vec3 nH = computeHeightNormalTS(
         heightMap, finalUV, texelSize, bumpScale
     );
-    vec3 nM = normalize(
-        texture(normalMap, finalUV).rgb * 2.0 - 1.0
-    );
+    vec3 nM = sampleDetailNormal(finalUV, nH);
 
     // 6) Blend them 50/50 so neither macro nor micro detail is lost.
     vec3 N = normalize(mix(nM, nH, 0.5));
@@ -207,7 +291,7 @@ void main() {
     // 10) Height‐based specular boost:
     //     • Higher height (peaks) get sharper, stronger highlights.
     //     • We raise height to 2.5 so the boost is concentrated near peaks.
-    float hVal     = texture(heightMap, finalUV).r;
+    float hVal     = sampleHeight(heightMap, finalUV);
     float boost    = lerp(0.9, 2.5, pow(hVal, 2.5));
     float expo     = lerp(32.0, 96.0, hVal);
     float specular = pow(NdotH, expo) * baseSpecularCoeff * boost;
@@ -225,13 +309,11 @@ void main() {
             vec2 uvS = finalUV + dir * AO_RADIUS;
 
             // Compute raw occlusion by height difference
-            float neighborH = texture(heightMap, uvS).r;
+            float neighborH = sampleHeight(heightMap, uvS);
             float rawAO     = saturate(hVal - neighborH + 0.03);
 
             // Modulate by normal similarity for smoother transitions
-            vec3 nS = normalize(
-                texture(normalMap, uvS).rgb * 2.0 - 1.0
-            );
+            vec3 nS = sampleDetailNormal(uvS, N);
             rawAO *= (0.4 + 0.6 * max(dot(N, nS), 0.0));
 
             sumAO += rawAO;
@@ -252,23 +334,23 @@ void main() {
     // -------------------------------------------------------------------------
     float shadow = 1.0;
     if (selfShadowTest > 0.0 && NdotL > 0.0) {
-        int numShadowSteps = int(lerp(48.0, 12.0, abs(tanLightN.z)));
+        int numShadowSteps = int(lerp(SHADOW_STEPS_GRAZING, SHADOW_STEPS_FACING, abs(tanLightN.z)));
         float steepScale = 1.0; // MATCH parallax!
         float shadowDeltaH = 1.0 / float(numShadowSteps);
         vec2 shadowDeltaUV = tanLightN.yx * bumpScale * steepScale / (abs(tanLightN.z) * float(numShadowSteps));
 
         float shadowSum = 0.0;
-        int pcfRings = 3;
+        int pcfRings = PCF_RINGS;
         int pcfSamples = 4;
         for (int dx = -pcfRings; dx <= pcfRings; ++dx)
         for (int dy = -pcfRings; dy <= pcfRings; ++dy)
         {
             vec2 pcfOffset = vec2(dx, dy) * 0.0015;
             vec2 shadowUV = finalUV + pcfOffset;
-            float shadowHeight = texture(heightMap, finalUV).r + shadowDeltaH * 0.1;
+            float shadowHeight = sampleHeight(heightMap, finalUV) + shadowDeltaH * 0.1;
             bool inShadow = false;
             for (int i = 0; i < numShadowSteps && shadowHeight < 1.0; ++i) {
-                float testHeight = texture(heightMap, shadowUV).r;
+                float testHeight = sampleHeight(heightMap, shadowUV);
                 if (testHeight > shadowHeight) {
                     inShadow = true;
                     break;
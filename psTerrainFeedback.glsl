@@ -0,0 +1,27 @@
+#version 330 core
+
+// Virtual-texture feedback of the TERRAIN build (TERRAIN.h, VT_FEEDBACK.h):
+// drawn over the steep view at 1/VT_FEEDBACK_SCALE of its size, it writes the
+// page and pyramid level psSteepParallax.glsl would sample at each pixel,
+// packed as level << 24 | y << 12 | x. The parallax offset is ignored; it
+// stays within a page or two of the undisplaced UV.
+
+in vec2 FragUV;
+in vec3 tanEyeVec;
+in vec3 tanLightVec;
+
+layout(location = 0) out uint pageRequest;
+
+uniform vec4 terrainWindow;     // origin and size of the quad in world texels
+uniform int terrainLevels;
+uniform int terrainTiles;       // level 0 pages per side
+uniform float terrainLodBias;   // -log2(VT_FEEDBACK_SCALE): derivatives here are that much larger
+
+void main() {
+    vec2 local = FragUV * terrainWindow.zw;
+    float rho = max(length(dFdx(local)), length(dFdy(local)));
+    int level = clamp(int(floor(log2(max(rho, 1e-6)) + terrainLodBias)), 0, terrainLevels - 1);
+    vec2 texel = terrainWindow.xy + local;
+    ivec2 tile = clamp(ivec2(floor(texel / TERRAIN_TILE)), ivec2(0), ivec2(terrainTiles - 1)) >> level;
+    pageRequest = uint(level) << 24 | uint(tile.y) << 12 | uint(tile.x);
+}
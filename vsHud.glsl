@@ -0,0 +1,18 @@
+#version 330 core
+
+// HUD overlay: positions in window pixels, origin top left
+layout (location = 0) in vec2 Position;
+layout (location = 1) in vec2 UV;
+layout (location = 2) in vec4 Color;
+
+out vec2 FragUV;
+out vec4 FragColor;
+
+uniform vec2 viewportSize;
+
+void main()
+{
+    FragUV = UV;
+    FragColor = Color;
+    gl_Position = vec4(Position.x / viewportSize.x * 2.0 - 1.0, 1.0 - Position.y / viewportSize.y * 2.0, 0.0, 1.0);
+}
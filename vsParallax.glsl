@@ -3,7 +3,7 @@
 layout (location = 0) in vec4 Position;
 layout (location = 1) in vec2 UV;
 layout (location = 2) in vec3 Normal;
-//layout (location = 3) in vec4 Tangent; // No tangent in original Cg shader
+layout (location = 3) in vec4 Tangent;   // xyz = dP/du, w = sign of the bitangent
 
 out vec2 FragUV;
 out vec3 tanEyeVec;
@@ -12,10 +12,14 @@ out vec3 tanLightVec;
 uniform mat4 ModelViewProj;
 uniform mat4 ModelViewI;
 uniform vec3 lightPosition;
+// Quantized meshes (MESH_CACHE.h) carry integer positions and uvs
+uniform float PositionScale = 1.0;
+uniform vec4 UVScaleBias = vec4(1.0, 1.0, 0.0, 0.0);
 
 void main() {
-    FragUV = UV;
-    gl_Position = ModelViewProj * Position;
+    FragUV = UV * UVScaleBias.xy + UVScaleBias.zw;
+    vec4 position = vec4(Position.xyz * PositionScale, 1.0);
+    gl_Position = ModelViewProj * position;
 
     // Eye position in object space
     vec4 eyePosition = ModelViewI * vec4(0,0,0,1);
@@ -25,17 +29,18 @@ void main() {
     vec4 objectLightPosition = ModelViewI * vec4(lightPosition, 1.0f);
     objectLightPosition /= objectLightPosition.w;
 
-    // For simple quad, tangent is X, normal is Z, binormal is Y
-    vec3 tangent = vec3(1,0,0);
+    // Per-vertex tangent frame (MikkTSpace convention: bitangent = w * cross(N, T))
     vec3 normal = normalize(Normal);
-    vec3 binormal = cross(normal, tangent);
+    vec3 tangent = normalize(Tangent.xyz);
+    vec3 bitangent = cross(normal, tangent) * sign(Tangent.w);   // packed w may not come back as exactly 1
 
     // Eye vector and light vector in object space
-    vec3 eyeVec = normalize(eyePosition.xyz - Position.xyz);
-    vec3 lightVec = normalize(objectLightPosition.xyz - Position.xyz);
-
-    // Transform to tangent space
-    mat3 TBN = mat3(tangent, binormal, normal);
-    tanEyeVec = TBN * eyeVec;
-    tanLightVec = TBN * lightVec;
+    vec3 eyeVec = normalize(eyePosition.xyz - position.xyz);
+    vec3 lightVec = normalize(objectLightPosition.xyz - position.xyz);
+
+    // Into tangent space. The pixel shaders were written for the original quad,
+    // whose frame was x = dP/dv, y = dP/du: they read .x along v and .y along u
+    // (their offsets swap the two), so the components keep that order.
+    tanEyeVec = vec3(dot(eyeVec, bitangent), dot(eyeVec, tangent), dot(eyeVec, normal));
+    tanLightVec = vec3(dot(lightVec, bitangent), dot(lightVec, tangent), dot(lightVec, normal));
 }
\ No newline at end of file